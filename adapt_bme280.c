@@ -0,0 +1,198 @@
+/* ------------------------------------------------------------ *
+ * file:        adapt_bme280.c                                  *
+ * purpose:     Adaptive sampling for continuous mode "-c -A".  *
+ *              The controller watches the rate of change of    *
+ *              the recent samples and switches between:        *
+ *                                                              *
+ *              low-rate:  forced mode, one conversion per slow *
+ *                         interval, 1x oversampling, no filter *
+ *              high-rate: normal mode, fast interval, p/t/h    *
+ *                         16x/2x/1x oversampling, IIR filter 4 *
+ *                                                              *
+ *              The rate of change is the least-squares slope   *
+ *              over the last ADAPT_SPAN seconds, less two      *
+ *              standard errors, so that the higher noise of    *
+ *              low-rate 1x sampling does not cause switches.   *
+ *              High-rate mode is left again after the signal   *
+ *              stayed below half the threshold for ADAPT_HOLD. *
+ *                                                              *
+ * author:      10/18/2026 agent                                *
+ * ------------------------------------------------------------ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "getbme280.h"
+
+extern int verbose;
+
+/* ------------------------------------------------------------ *
+ * Standby times of the config register in ms, and their names  *
+ * as accepted by set_stby(), sorted by duration.               *
+ * ------------------------------------------------------------ */
+static const float stby_ms[]    = { 0.5, 10, 20, 62.5, 125, 250, 500, 1000 };
+static char *stby_names[]       = { "0.5", "10", "20", "62.5", "125", "250", "500", "1000" };
+
+/* ------------------------------------------------------------ *
+ * adapt_now() returns the monotonic clock in seconds           *
+ * ------------------------------------------------------------ */
+static double adapt_now() {
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* ------------------------------------------------------------ *
+ * adapt_apply() reconfigures the sensor for the given state.   *
+ * Config register writes are only reliable in sleep mode, so   *
+ * the sensor is put to sleep first. Returns 0 or -1 on errors. *
+ * ------------------------------------------------------------ */
+static int adapt_apply(struct bmeadapt *bmea, int state) {
+   int res = 0;
+
+   res |= set_power(psleep);
+   if(state == ADAPT_HIGH) {
+      /* ------------------------------------------------------- *
+       * Largest standby time that fits the fast interval after  *
+       * the ~40ms conversion at 16x pressure oversampling.      *
+       * ------------------------------------------------------- */
+      int i = 0;
+      while(i < 7 && stby_ms[i+1] + 40 <= bmea->fast_ms) i++;
+      if(bmep->humidity == 1) res |= set_h_osrs("1");
+      res |= set_p_osrs("16");
+      res |= set_t_osrs("2");
+      res |= set_filter("4");
+      res |= set_stby(stby_names[i]);
+      res |= set_power(normal);
+   }
+   else {
+      if(bmep->humidity == 1) res |= set_h_osrs("1");
+      res |= set_p_osrs("1");
+      res |= set_t_osrs("1");
+      res |= set_filter("off");
+   }
+   bmea->state = state;
+   if(verbose == 1) printf("Debug: Adaptive mode: [%s] interval [%dms]\n",
+                           state == ADAPT_HIGH ? "high-rate" : "low-rate",
+                           adapt_interval(bmea));
+   return(res == 0 ? 0 : -1);
+}
+
+/* ------------------------------------------------------------ *
+ * adapt_init() parses the -A argument "fast:slow[:dp]" with    *
+ * the sample intervals in ms and the optional pressure rate    *
+ * threshold in Pa/min, and starts in low-rate mode.            *
+ * ------------------------------------------------------------ */
+int adapt_init(struct bmeadapt *bmea, char *spec) {
+   memset(bmea, 0, sizeof(*bmea));
+   bmea->thres_p = ADAPT_THRES_P;
+   bmea->thres_t = ADAPT_THRES_T;
+   bmea->thres_h = ADAPT_THRES_H;
+
+   int n = sscanf(spec, "%d:%d:%f", &bmea->fast_ms, &bmea->slow_ms, &bmea->thres_p);
+   if(n < 2 || bmea->fast_ms < 10 || bmea->slow_ms < bmea->fast_ms || bmea->thres_p <= 0) {
+      printf("Error: invalid adaptive sampling setting %s.\n", spec);
+      return(-1);
+   }
+   bmea->calm_since = adapt_now();
+   return adapt_apply(bmea, ADAPT_LOW);
+}
+
+/* ------------------------------------------------------------ *
+ * adapt_trigger() starts a conversion in low-rate mode and     *
+ * waits until the status register reports it complete. In      *
+ * high-rate mode the sensor converts on its own.               *
+ * ------------------------------------------------------------ */
+int adapt_trigger(struct bmeadapt *bmea) {
+   if(bmea->state == ADAPT_HIGH) return(0);
+   if(set_power(forced) != 0) return(-1);
+
+   for(int i = 0; i < 50; i++) {
+      usleep(1000);
+      if((get_status() & 0x08) == 0) return(0);
+   }
+   if(verbose == 1) printf("Debug: Forced conversion timeout\n");
+   return(-1);
+}
+
+/* ------------------------------------------------------------ *
+ * adapt_rate() returns the least-squares slope per minute of   *
+ * one channel over the history, selected by its struct offset. *
+ * The slope is reduced by two standard errors, so sensor noise *
+ * on short or sparse histories does not count as activity.     *
+ * ------------------------------------------------------------ */
+static float adapt_rate(struct bmeadapt *bmea, size_t field) {
+   int n = bmea->fill;
+   if(n < 3) return 0;
+
+   double st = 0, sv = 0;
+   for(int i = 0; i < n; i++) {
+      st += bmea->hist[i].ts - bmea->hist[0].ts;
+      sv += *(float *) ((char *) &bmea->hist[i] + field);
+   }
+   double tm = st / n, vm = sv / n;
+   double sxx = 0, sxy = 0, syy = 0;
+   for(int i = 0; i < n; i++) {
+      double dt = bmea->hist[i].ts - bmea->hist[0].ts - tm;
+      double dv = *(float *) ((char *) &bmea->hist[i] + field) - vm;
+      sxx += dt * dt; sxy += dt * dv; syy += dv * dv;
+   }
+   if(sxx <= 0) return 0;
+
+   double slope = sxy / sxx;
+   double ssr = syy - slope * sxy;
+   double se = sqrt((ssr > 0 ? ssr : 0) / (n - 2) / sxx);
+   double rate = fabs(slope) - 2 * se;
+   return (float) (rate > 0 ? rate * 60.0 : 0);
+}
+
+/* ------------------------------------------------------------ *
+ * adapt_update() adds a sample to the history and switches the *
+ * sampling mode when the rate of change crosses the threshold. *
+ * ------------------------------------------------------------ */
+void adapt_update(struct bmeadapt *bmea, struct bmedata *bmed) {
+   double now = adapt_now();
+
+   /* ---------------------------------------------------------- *
+    * Drop samples older than ADAPT_SPAN, then append this one   *
+    * ---------------------------------------------------------- */
+   int keep = 0;
+   while(keep < bmea->fill && now - bmea->hist[keep].ts > ADAPT_SPAN) keep++;
+   if(bmea->fill - keep == ADAPT_HISTORY) keep++;
+   if(keep > 0) {
+      memmove(bmea->hist, bmea->hist + keep, (bmea->fill - keep) * sizeof(bmea->hist[0]));
+      bmea->fill -= keep;
+   }
+   bmea->hist[bmea->fill].ts = now;
+   bmea->hist[bmea->fill].t = bmed->temp_c;
+   bmea->hist[bmea->fill].p = isnan(bmed->pres_p) ? 0 : bmed->pres_p;
+   bmea->hist[bmea->fill].h = isnan(bmed->humi_p) ? 0 : bmed->humi_p;
+   bmea->fill++;
+
+   /* ---------------------------------------------------------- *
+    * Activity is the largest rate relative to its threshold     *
+    * ---------------------------------------------------------- */
+   float act_p = adapt_rate(bmea, offsetof(struct bmehist, p)) / bmea->thres_p;
+   float act_t = adapt_rate(bmea, offsetof(struct bmehist, t)) / bmea->thres_t;
+   float act_h = adapt_rate(bmea, offsetof(struct bmehist, h)) / bmea->thres_h;
+   float act = fmaxf(act_p, fmaxf(act_t, act_h));
+   if(verbose == 1) printf("Debug: Adaptive activity: [%.2f] p [%.2f] t [%.2f] h [%.2f]\n",
+                           act, act_p, act_t, act_h);
+
+   if(act >= 0.5) bmea->calm_since = now;
+   if(bmea->state == ADAPT_LOW && act >= 1.0)
+      adapt_apply(bmea, ADAPT_HIGH);
+   else if(bmea->state == ADAPT_HIGH && now - bmea->calm_since >= ADAPT_HOLD)
+      adapt_apply(bmea, ADAPT_LOW);
+}
+
+/* ------------------------------------------------------------ *
+ * adapt_interval() returns the current sample interval in ms   *
+ * ------------------------------------------------------------ */
+int adapt_interval(struct bmeadapt *bmea) {
+   return bmea->state == ADAPT_HIGH ? bmea->fast_ms : bmea->slow_ms;
+}
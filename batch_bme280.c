@@ -0,0 +1,113 @@
+/* ------------------------------------------------------------ *
+ * file:        batch_bme280.c                                  *
+ * purpose:     Pipelined forced mode reads of the "-b" sensor  *
+ *              list for "-t". Instead of trigger, wait 120ms   *
+ *              and read per sensor, a cycle runs in 3 passes:  *
+ *                                                              *
+ *              1. trigger all sleeping sensors back-to-back    *
+ *              2. wait for the slowest typical conversion time *
+ *                 from the timing model, then poll the status  *
+ *                 register until all conversions are done      *
+ *              3. burst-read the data of all sensors           *
+ *                                                              *
+ *              A cycle takes about one conversion time plus    *
+ *              the bus time, regardless of the sensor count.   *
+ *              Sensors in normal mode are read without waits.  *
+ *              Each pass walks the list in the opposite        *
+ *              direction of the one before, so it starts on    *
+ *              the mux channel where the last one ended.       *
+ *                                                              *
+ * author:      10/18/2026 agent                                *
+ * ------------------------------------------------------------ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include "getbme280.h"
+
+extern int verbose;
+
+/* ------------------------------------------------------------ *
+ * batch_now() returns the monotonic clock in ms                *
+ * ------------------------------------------------------------ */
+static double batch_now() {
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+/* ------------------------------------------------------------ *
+ * bme_batch() reads one sample of each of the n sensors into   *
+ * bmed, with their calibration in bmec. Returns 0, or -1 on    *
+ * errors.                                                      *
+ * ------------------------------------------------------------ */
+int bme_batch(struct bmesensor *bmes, int n, struct bmecal *bmec, struct bmedata *bmed) {
+   double ready[SENSOR_MAX];    // typical end of the conversion
+   double deadline[SENSOR_MAX]; // maximum end of the conversion, + margin
+   int pending = 0;
+   int back = 0;                // 1 = the last pass ended at sensor 0
+   double start = batch_now();
+
+   /* ---------------------------------------------------------- *
+    * Pass 1: calibration and trigger, no waits in between       *
+    * ---------------------------------------------------------- */
+   for(int i = 0; i < n; i++) {
+      struct bmeinf bmei;
+      struct bmetime bmet;
+      if(sensor_select(&bmes[i]) != 0) return(-1);
+      get_calib(&bmec[i]);
+      if(bme_snapshot(&bmei) != 0) return(-1);
+
+      ready[i] = 0;
+      if(bmei.power_mode == normal) continue;
+      if(bmei.power_mode == psleep && bme_trigger(&bmei) != 0) return(-1);
+      bme_timing(&bmei, 1.0, &bmet);
+      double now = batch_now();
+      ready[i] = now + bmet.meas_typ;
+      deadline[i] = now + 2 * bmet.meas_max;
+      pending++;
+   }
+
+   /* ---------------------------------------------------------- *
+    * Pass 2: sleep until the slowest typical end, then poll the *
+    * measuring bit of the sensors that are not done yet         *
+    * ---------------------------------------------------------- */
+   double wait = 0;
+   for(int i = 0; i < n; i++) if(ready[i] > wait) wait = ready[i];
+   wait -= batch_now();
+   if(pending > 0 && wait > 0) usleep(wait * 1000);
+
+   long polls = 0;
+   while(pending > 0) {
+      back = !back;
+      for(int j = 0; j < n; j++) {
+         int i = back ? n - 1 - j : j;
+         if(ready[i] == 0) continue;
+         if(sensor_select(&bmes[i]) != 0) return(-1);
+         polls++;
+         if((get_status() & 0x08) == 0) {
+            ready[i] = 0;
+            pending--;
+         }
+         else if(batch_now() > deadline[i]) {
+            printf("Error: sensor %s conversion timeout.\n", bmes[i].spec);
+            return(-1);
+         }
+      }
+      if(pending > 0) usleep(500);
+   }
+
+   /* ---------------------------------------------------------- *
+    * Pass 3: read the data blocks                               *
+    * ---------------------------------------------------------- */
+   for(int j = 0; j < n; j++) {
+      int i = back ? j : n - 1 - j;
+      if(sensor_select(&bmes[i]) != 0) return(-1);
+      get_data(&bmec[i], &bmed[i]);
+   }
+   if(verbose == 1) printf("Debug: Batch cycle: [%.1fms] sensors [%d] status polls [%ld]\n",
+                           batch_now() - start, n, polls);
+   return(0);
+}
@@ -0,0 +1,326 @@
+/* ------------------------------------------------------------ *
+ * file:        bench280.c                                      *
+ * purpose:     Accuracy and speed of the compensation versions *
+ *              (-K) without a sensor. For a set of calibration *
+ *              data from real sensors, it sweeps the full 20   *
+ *              bit adc_t and adc_p, and the 16 bit adc_h range *
+ *              through each version, and compares the results  *
+ *              against the datasheet formulas in long double.  *
+ *              Errors only count inside the sensor operating   *
+ *              range: -40..85*C, 300..1100hPa, 0..100%.        *
+ *              Pressure and humidity sweep at -40, 0, 25 and   *
+ *              85*C. The timing runs over in-range samples.    *
+ *                                                              *
+ * return:      0 on success, and -1 on errors.                 *
+ *                                                              *
+ * example:	./bench280 -s 16                                *
+ *                                                              *
+ * author:      10/18/2026 agent                                *
+ * ------------------------------------------------------------ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <math.h>
+#include "getbme280.h"
+
+/* ------------------------------------------------------------ *
+ * Global variables and defaults                                *
+ * ------------------------------------------------------------ */
+int verbose = 0;           // debug output of i2c_bme280.c, stays off
+int bverbose = 0;          // debug output of bench280, -v
+int step = 1;              // sweep step of the adc values
+int timing_n = 1 << 20;    // samples per timing run
+
+/* ------------------------------------------------------------ *
+ * Calibration data read from real sensors, and the example of  *
+ * the Bosch BMP280 datasheet with typical humidity values      *
+ * ------------------------------------------------------------ */
+struct bmecalset{
+   char *name;
+   struct bmecal bmec;
+};
+
+static struct bmecalset calsets[] = {
+   { "BME280 sensor A", { 28325, 26508, 50, 37483, -10626, 3024, 8942, -197,
+                          -7, 9900, -10230, 4285, 75, 367, 0, 308, 50, 30 } },
+   { "BME280 sensor B", { 28009, 25654, 50, 39145, -10750, 3024, 5667, -120,
+                          -7, 9900, -10230, 4285, 75, 370, 0, 292, 50, 30 } },
+   { "Bosch datasheet", { 27504, 26435, -1000, 36477, -10685, 3024, 2855, 140,
+                          -7, 15500, -14600, 6000, 75, 362, 0, 313, 50, 30 } },
+   { NULL }
+};
+
+static const float sweep_temps[] = { -40, 0, 25, 85 };
+#define SWEEP_TEMPS (sizeof(sweep_temps) / sizeof(sweep_temps[0]))
+
+/* ------------------------------------------------------------ *
+ * Error statistics of one version for one channel              *
+ * ------------------------------------------------------------ */
+struct errstat{
+   double max;       // max. absolute error
+   double sum2;      // sum of the squared errors
+   long n;           // number of compared values
+};
+
+struct compstat{
+   struct errstat t, p, h;
+   double ns;        // time per sample in ns
+};
+
+/* ------------------------------------------------------------ *
+ * print_usage() prints the programs commandline instructions.  *
+ * ------------------------------------------------------------ */
+void usage() {
+   static char const usage[] = "Usage: bench280 [-s step] [-n samples] [-v]\n\
+\n\
+Command line parameters have the following format:\n\
+   -s   sweep step of the adc values, 1 = full range (default)\n\
+   -n   samples per timing run, default 1048576\n\
+   -h   display this message\n\
+   -v   enable debug output\n\
+\n\
+Usage example:\n\
+./bench280 -s 16\n\n";
+   printf(usage);
+}
+
+/* ------------------------------------------------------------ *
+ * parseargs() checks the commandline arguments with C getopt   *
+ * ------------------------------------------------------------ */
+void parseargs(int argc, char* argv[]) {
+   int arg;
+   opterr = 0;
+
+   while ((arg = (int) getopt (argc, argv, "s:n:hv")) != -1) {
+      switch (arg) {
+         // arg -s sweep step, type: int
+         case 's':
+            step = atoi(optarg);
+            if(step < 1 || step > 65536) {
+               printf("Error: invalid sweep step %s.\n", optarg);
+               exit(-1);
+            }
+            break;
+
+         // arg -n timing samples, type: int
+         case 'n':
+            timing_n = atoi(optarg);
+            if(timing_n < 1) {
+               printf("Error: invalid sample count %s.\n", optarg);
+               exit(-1);
+            }
+            break;
+
+         // arg -v verbose, type: flag, optional
+         case 'v':
+            bverbose = 1; break;
+
+         // arg -h usage, type: flag, optional
+         case 'h':
+            usage(); exit(0);
+
+         case '?':
+            printf("Error: Unknown option `-%c'.\n", optopt);
+            usage();
+            exit(-1);
+      }
+   }
+}
+
+/* ------------------------------------------------------------ *
+ * ref_t_fine() is the datasheet t_fine in long double. For the *
+ * pressure and humidity it is truncated to int, like all do.   *
+ * ------------------------------------------------------------ */
+static long double ref_t_fine(struct bmecal *bmec, int32_t adc_t) {
+   long double x1 = adc_t / 16384.0L - bmec->dig_T1 / 1024.0L;
+   long double x2 = adc_t / 131072.0L - bmec->dig_T1 / 8192.0L;
+   return x1 * bmec->dig_T2 + x2 * x2 * bmec->dig_T3;
+}
+
+/* ------------------------------------------------------------ *
+ * ref_pres() is the datasheet pressure in Pa in long double    *
+ * ------------------------------------------------------------ */
+static long double ref_pres(struct bmecal *bmec, int32_t t_fine, int32_t adc_p) {
+   long double var1 = t_fine / 2.0L - 64000.0L;
+   long double var2 = var1 * var1 * bmec->dig_P6 / 32768.0L;
+   var2 = var2 + var1 * bmec->dig_P5 * 2.0L;
+   var2 = var2 / 4.0L + bmec->dig_P4 * 65536.0L;
+   var1 = (bmec->dig_P3 * var1 * var1 / 524288.0L + bmec->dig_P2 * var1) / 524288.0L;
+   var1 = (1.0L + var1 / 32768.0L) * bmec->dig_P1;
+   long double p = 1048576.0L - adc_p;
+   p = (p - var2 / 4096.0L) * 6250.0L / var1;
+   var1 = bmec->dig_P9 * p * p / 2147483648.0L;
+   var2 = p * bmec->dig_P8 / 32768.0L;
+   return p + (var1 + var2 + bmec->dig_P7) / 16.0L;
+}
+
+/* ------------------------------------------------------------ *
+ * ref_humi() is the datasheet humidity in %, not clamped       *
+ * ------------------------------------------------------------ */
+static long double ref_humi(struct bmecal *bmec, int32_t t_fine, int32_t adc_h) {
+   long double h = t_fine - 76800.0L;
+   h = (adc_h - (bmec->dig_H4 * 64.0L + bmec->dig_H5 / 16384.0L * h)) *
+       (bmec->dig_H2 / 65536.0L * (1.0L + bmec->dig_H6 / 67108864.0L * h *
+       (1.0L + bmec->dig_H3 / 67108864.0L * h)));
+   return h * (1.0L - bmec->dig_H1 * h / 524288.0L);
+}
+
+/* ------------------------------------------------------------ *
+ * adc_for_temp() finds the adc_t value for a temperature, by   *
+ * binary search. The temperature rises with adc_t.             *
+ * ------------------------------------------------------------ */
+static int32_t adc_for_temp(struct bmecal *bmec, float temp) {
+   int32_t lo = 0, hi = (1 << 20) - 1;
+   while(lo < hi) {
+      int32_t mid = (lo + hi) / 2;
+      if(ref_t_fine(bmec, mid) / 5120.0L < temp) lo = mid + 1;
+      else hi = mid;
+   }
+   return lo;
+}
+
+/* ------------------------------------------------------------ *
+ * err_add() adds one compared value to the statistics          *
+ * ------------------------------------------------------------ */
+static void err_add(struct errstat *e, double val, long double ref) {
+   double err = fabs((double) (val - ref));
+   if(err > e->max) e->max = err;
+   e->sum2 += err * err;
+   e->n++;
+}
+
+static double err_rms(struct errstat *e) {
+   return e->n > 0 ? sqrt(e->sum2 / e->n) : 0;
+}
+
+/* ------------------------------------------------------------ *
+ * sweep() runs the adc sweeps of one calibration through all   *
+ * versions, and collects their errors                          *
+ * ------------------------------------------------------------ */
+static void sweep(struct bmecal *bmec, struct bmecomp *comps, struct compstat *cs) {
+   struct bmedata bmed = {0};
+
+   /* ---------------------------------------------------------- *
+    * Temperature over the full 20 bit adc_t range               *
+    * ---------------------------------------------------------- */
+   for(int32_t adc_t = 0; adc_t < (1 << 20); adc_t += step) {
+      long double ref = ref_t_fine(bmec, adc_t) / 5120.0L;
+      if(ref < -40 || ref > 85) continue;
+      for(int v = 0; comps[v].name != NULL; v++) {
+         bmed.adc_t = adc_t;
+         bmed.adc_p = 1 << 19;
+         bmed.adc_h = 1 << 15;
+         comps[v].func(bmec, &bmed);
+         err_add(&cs[v].t, bmed.temp_c, ref);
+      }
+   }
+
+   /* ---------------------------------------------------------- *
+    * Pressure over the full 20 bit adc_p range, and humidity    *
+    * over the full 16 bit adc_h range, at each sweep temperature*
+    * ---------------------------------------------------------- */
+   for(size_t i = 0; i < SWEEP_TEMPS; i++) {
+      int32_t adc_t = adc_for_temp(bmec, sweep_temps[i]);
+      int32_t t_fine = (int32_t) ref_t_fine(bmec, adc_t);
+      if(bverbose == 1) printf("Debug: Sweep at %.0f*C: adc_t [%d] t_fine [%d]\n",
+                              sweep_temps[i], adc_t, t_fine);
+
+      for(int32_t adc_p = 0; adc_p < (1 << 20); adc_p += step) {
+         long double ref = ref_pres(bmec, t_fine, adc_p);
+         if(ref < 30000 || ref > 110000) continue;
+         for(int v = 0; comps[v].name != NULL; v++) {
+            bmed.adc_t = adc_t;
+            bmed.adc_p = adc_p;
+            bmed.adc_h = 1 << 15;
+            comps[v].func(bmec, &bmed);
+            err_add(&cs[v].p, bmed.pres_p, ref);
+         }
+      }
+
+      for(int32_t adc_h = 0; adc_h < (1 << 16); adc_h += (step < 16 ? 1 : step / 16)) {
+         long double ref = ref_humi(bmec, t_fine, adc_h);
+         if(ref <= 0 || ref >= 100) continue;
+         for(int v = 0; comps[v].name != NULL; v++) {
+            bmed.adc_t = adc_t;
+            bmed.adc_p = 1 << 19;
+            bmed.adc_h = adc_h;
+            comps[v].func(bmec, &bmed);
+            err_add(&cs[v].h, bmed.humi_p, ref);
+         }
+      }
+   }
+}
+
+/* ------------------------------------------------------------ *
+ * timing() measures the time per sample of all versions over   *
+ * timing_n in-range samples. The adc values come from a simple *
+ * LCG, so all versions see the same data.                      *
+ * ------------------------------------------------------------ */
+static void timing(struct bmecal *bmec, struct bmecomp *comps, struct compstat *cs) {
+   struct bmedata *bmed = malloc(timing_n * sizeof(struct bmedata));
+   if(bmed == NULL) {
+      printf("Error: cannot allocate %d timing samples.\n", timing_n);
+      exit(-1);
+   }
+   int32_t adc_t0 = adc_for_temp(bmec, -40), adc_t1 = adc_for_temp(bmec, 85);
+   uint32_t seed = 280;
+   for(int i = 0; i < timing_n; i++) {
+      seed = seed * 1664525 + 1013904223;
+      bmed[i].adc_t = adc_t0 + (seed >> 8) % (adc_t1 - adc_t0);
+      seed = seed * 1664525 + 1013904223;
+      bmed[i].adc_p = 250000 + (seed >> 8) % 400000;
+      seed = seed * 1664525 + 1013904223;
+      bmed[i].adc_h = 20000 + (seed >> 8) % 20000;
+   }
+
+   for(int v = 0; comps[v].name != NULL; v++) {
+      struct timespec t0, t1;
+      float sum = 0;
+      clock_gettime(CLOCK_MONOTONIC, &t0);
+      for(int i = 0; i < timing_n; i++) {
+         comps[v].func(bmec, &bmed[i]);
+         sum += bmed[i].pres_p;
+      }
+      clock_gettime(CLOCK_MONOTONIC, &t1);
+      cs[v].ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / timing_n;
+      if(bverbose == 1) printf("Debug: Timing %s: checksum [%.0f]\n", comps[v].name, sum);
+   }
+   free(bmed);
+}
+
+int main(int argc, char *argv[]) {
+   struct bmecomp *comps = get_comp(NULL);
+   int ncomps = 0;
+   while(comps[ncomps].name != NULL) ncomps++;
+
+   parseargs(argc, argv);
+   struct compstat *cs = malloc(ncomps * sizeof(struct compstat));
+   if(cs == NULL) {
+      printf("Error: cannot allocate the statistics.\n");
+      exit(-1);
+   }
+
+   for(struct bmecalset *set = calsets; set->name != NULL; set++) {
+      memset(cs, 0, ncomps * sizeof(struct compstat));
+      sweep(&set->bmec, comps, cs);
+      timing(&set->bmec, comps, cs);
+
+      printf("%s: T1=%u T2=%d T3=%d P1=%u\n", set->name, set->bmec.dig_T1,
+             set->bmec.dig_T2, set->bmec.dig_T3, set->bmec.dig_P1);
+      printf("Version    T max*C  T rms*C    P max Pa  P rms Pa     H max %%  H rms %%   ns/sample\n");
+      for(int v = 0; v < ncomps; v++) {
+         printf("%-8s %9.5f %8.5f %11.4f %9.4f %11.5f %8.5f %11.1f\n", comps[v].name,
+                cs[v].t.max, err_rms(&cs[v].t), cs[v].p.max, err_rms(&cs[v].p),
+                cs[v].h.max, err_rms(&cs[v].h), cs[v].ns);
+      }
+      if(bverbose == 1) printf("Debug: Compared values: T [%ld] P [%ld] H [%ld]\n",
+                              cs[0].t.n, cs[0].p.n, cs[0].h.n);
+      printf("\n");
+   }
+   free(cs);
+   exit(0);
+}
@@ -0,0 +1,415 @@
+/* ------------------------------------------------------------ *
+ * file:        bme280.hpp                                      *
+ * purpose:     Header-only C++17 driver for embedding sensor   *
+ *              reads in C++ programs, next to the C reference  *
+ *              implementation of getbme280:                    *
+ *                                                              *
+ *              Bme280<Transport, Precision>                    *
+ *                                                              *
+ *              Transport   the bus access, a class with        *
+ *                          bool read(reg, buf, len) and        *
+ *                          bool write(reg, val), e.g. LinuxI2c *
+ *              Precision   the compensation, statically        *
+ *                          dispatched: Float, Double (the      *
+ *                          datasheet floating point version)   *
+ *                          or Fixed (the datasheet integer     *
+ *                          version: 0.01*C, 1/256Pa, 1/1024%)  *
+ *                                                              *
+ *              The settings are typed enums, their register    *
+ *              values are computed at compile time (Settings), *
+ *              and no mode strings are parsed. The calls       *
+ *              return false on bus errors, nothing throws.     *
+ *                                                              *
+ * example:     using namespace bme280;                         *
+ *              Bme280<LinuxI2c> s("/dev/i2c-1", 0x76);         *
+ *              Bme280<LinuxI2c>::Reading r;                    *
+ *              if(s.begin() && s.configure(weather)            *
+ *                 && s.measure(r)) printf("%.2f\n", r.temp_c); *
+ *                                                              *
+ * author:      10/18/2026 agent                                *
+ * ------------------------------------------------------------ */
+#ifndef BME280_HPP
+#define BME280_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <thread>
+#include <chrono>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c-dev.h>
+
+namespace bme280 {
+
+/* ------------------------------------------------------------ *
+ * Registers, and the channel flags of skipped measurements,    *
+ * the same as BME280_*_ADDR and CHAN_* in getbme280.h          *
+ * ------------------------------------------------------------ */
+namespace reg {
+   constexpr uint8_t calib00   = 0x88;   // 26 bytes 0x88..0xA1
+   constexpr uint8_t chip_id   = 0xD0;
+   constexpr uint8_t reset     = 0xE0;
+   constexpr uint8_t calib26   = 0xE1;   // 7 bytes 0xE1..0xE7
+   constexpr uint8_t ctrl_hum  = 0xF2;
+   constexpr uint8_t status    = 0xF3;
+   constexpr uint8_t ctrl_meas = 0xF4;
+   constexpr uint8_t config    = 0xF5;
+   constexpr uint8_t data      = 0xF7;   // 8 bytes 0xF7..0xFE
+}
+
+constexpr uint8_t chan_t   = 0x01;
+constexpr uint8_t chan_p   = 0x02;
+constexpr uint8_t chan_h   = 0x04;
+constexpr uint8_t chan_all = 0x07;
+
+/* ------------------------------------------------------------ *
+ * Settings, the enum values are the register codes             *
+ * ------------------------------------------------------------ */
+enum class Osrs : uint8_t { skip = 0, x1 = 1, x2 = 2, x4 = 3, x8 = 4, x16 = 5 };
+enum class Filter : uint8_t { off = 0, x2 = 1, x4 = 2, x8 = 3, x16 = 4 };
+enum class Standby : uint8_t { ms0_5 = 0, ms62_5 = 1, ms125 = 2, ms250 = 3,
+                               ms500 = 4, ms1000 = 5, ms10 = 6, ms20 = 7 };
+enum class Mode : uint8_t { sleep = 0, forced = 1, normal = 3 };
+
+/* ------------------------------------------------------------ *
+ * Settings holds a complete configuration. The setters return  *
+ * a copy, so constexpr configurations can be built like        *
+ * Settings().pressure(Osrs::x16).filter(Filter::x16), and the  *
+ * register values are constants.                               *
+ * ------------------------------------------------------------ */
+struct Settings {
+   Osrs osrs_t = Osrs::x1;
+   Osrs osrs_p = Osrs::x1;
+   Osrs osrs_h = Osrs::x1;
+   Filter iir = Filter::off;
+   Standby stby = Standby::ms0_5;
+   Mode pmode = Mode::forced;
+
+   constexpr Settings temperature(Osrs o) const { Settings s = *this; s.osrs_t = o; return s; }
+   constexpr Settings pressure(Osrs o) const { Settings s = *this; s.osrs_p = o; return s; }
+   constexpr Settings humidity(Osrs o) const { Settings s = *this; s.osrs_h = o; return s; }
+   constexpr Settings filter(Filter f) const { Settings s = *this; s.iir = f; return s; }
+   constexpr Settings standby(Standby t) const { Settings s = *this; s.stby = t; return s; }
+   constexpr Settings mode(Mode m) const { Settings s = *this; s.pmode = m; return s; }
+
+   /* -- Register values, datasheet chapter 5.4 -- */
+   constexpr uint8_t ctrl_hum() const { return static_cast<uint8_t>(osrs_h); }
+   constexpr uint8_t ctrl_meas() const {
+      return static_cast<uint8_t>(static_cast<uint8_t>(osrs_t) << 5
+                                  | static_cast<uint8_t>(osrs_p) << 2
+                                  | static_cast<uint8_t>(pmode));
+   }
+   constexpr uint8_t config() const {
+      return static_cast<uint8_t>(static_cast<uint8_t>(stby) << 5
+                                  | static_cast<uint8_t>(iir) << 2);
+   }
+
+   /* -- The channels that are not measured -- */
+   constexpr uint8_t skip() const {
+      return (osrs_t == Osrs::skip ? chan_t : 0) | (osrs_p == Osrs::skip ? chan_p : 0)
+           | (osrs_h == Osrs::skip ? chan_h : 0);
+   }
+
+   /* -- Maximum measurement time in us, datasheet chapter 9.1 -- */
+   static constexpr uint32_t samples(Osrs o) {
+      return o == Osrs::skip ? 0 : 1u << (static_cast<uint8_t>(o) - 1);
+   }
+   constexpr uint32_t measure_us() const {
+      uint32_t t = samples(osrs_t), p = samples(osrs_p), h = samples(osrs_h);
+      return 1250 + 2300 * t + (p ? 2300 * p + 575 : 0) + (h ? 2300 * h + 575 : 0);
+   }
+};
+
+/* ------------------------------------------------------------ *
+ * The datasheet recommended modes, as in preset_bme280.c       *
+ * ------------------------------------------------------------ */
+constexpr Settings weather  = Settings();
+constexpr Settings humidity = Settings().pressure(Osrs::skip);
+constexpr Settings indoor   = Settings().temperature(Osrs::x2).pressure(Osrs::x16)
+                                        .filter(Filter::x16).mode(Mode::normal);
+constexpr Settings gaming   = Settings().pressure(Osrs::x4).humidity(Osrs::skip)
+                                        .filter(Filter::x16).mode(Mode::normal);
+
+/* ------------------------------------------------------------ *
+ * Calibration data, parsed from the 26 bytes at 0x88 and the   *
+ * 7 bytes at 0xE1                                              *
+ * ------------------------------------------------------------ */
+struct Calib {
+   uint16_t dig_T1; int16_t dig_T2, dig_T3;
+   uint16_t dig_P1; int16_t dig_P2, dig_P3, dig_P4, dig_P5, dig_P6, dig_P7, dig_P8, dig_P9;
+   uint8_t dig_H1; int16_t dig_H2; uint8_t dig_H3; int16_t dig_H4, dig_H5; int8_t dig_H6;
+
+   static constexpr Calib parse(const uint8_t *tp, const uint8_t *h) {
+      auto u16 = [](const uint8_t *b) { return static_cast<uint16_t>(b[0] | b[1] << 8); };
+      auto s16 = [&](const uint8_t *b) { return static_cast<int16_t>(u16(b)); };
+      Calib c {};
+      c.dig_T1 = u16(tp);      c.dig_T2 = s16(tp + 2);  c.dig_T3 = s16(tp + 4);
+      c.dig_P1 = u16(tp + 6);  c.dig_P2 = s16(tp + 8);  c.dig_P3 = s16(tp + 10);
+      c.dig_P4 = s16(tp + 12); c.dig_P5 = s16(tp + 14); c.dig_P6 = s16(tp + 16);
+      c.dig_P7 = s16(tp + 18); c.dig_P8 = s16(tp + 20); c.dig_P9 = s16(tp + 22);
+      if(h == nullptr) return c;
+      c.dig_H1 = tp[25];
+      c.dig_H2 = s16(h);
+      c.dig_H3 = h[2];
+      c.dig_H4 = static_cast<int16_t>(static_cast<int8_t>(h[3]) * 16 + (h[4] & 0x0F));
+      c.dig_H5 = static_cast<int16_t>(static_cast<int8_t>(h[5]) * 16 + (h[4] >> 4));
+      c.dig_H6 = static_cast<int8_t>(h[6]);
+      return c;
+   }
+};
+
+/* ------------------------------------------------------------ *
+ * Raw adc values of one read, and the skipped channels         *
+ * ------------------------------------------------------------ */
+struct Raw {
+   int32_t adc_t;
+   int32_t adc_p;
+   int32_t adc_h;
+   uint8_t skip;
+
+   static constexpr Raw decode(const uint8_t *b, uint8_t skip) {
+      return Raw { b[3] << 12 | b[4] << 4 | b[5] >> 4,
+                   b[0] << 12 | b[1] << 4 | b[2] >> 4,
+                   b[6] << 8 | b[7], skip };
+   }
+};
+
+/* ------------------------------------------------------------ *
+ * Floating<T> - datasheet floating point compensation in T,    *
+ * skipped channels are NaN. A skipped temperature skips all,   *
+ * the others need its t_fine.                                  *
+ * ------------------------------------------------------------ */
+template <typename T>
+struct Floating {
+   struct Reading {
+      T temp_c;      // temperature in *C
+      T pres_pa;     // pressure in Pa
+      T humi_rh;     // relative humidity in %
+      uint8_t skip;  // skipped channels chan_*
+   };
+
+   static constexpr Reading compensate(const Calib &c, const Raw &r) {
+      constexpr T nan = std::numeric_limits<T>::quiet_NaN();
+      Reading out { nan, nan, nan, r.skip };
+      if(r.skip & chan_t) {
+         out.skip = chan_all;
+         return out;
+      }
+      T adc_t = static_cast<T>(r.adc_t);
+      T var1 = (adc_t / T(16384) - c.dig_T1 / T(1024)) * c.dig_T2;
+      T var2 = (adc_t / T(131072) - c.dig_T1 / T(8192)) *
+               (adc_t / T(131072) - c.dig_T1 / T(8192)) * c.dig_T3;
+      T t_fine = static_cast<T>(static_cast<int32_t>(var1 + var2));
+      out.temp_c = (var1 + var2) / T(5120);
+
+      if((r.skip & chan_p) == 0) {
+         var1 = t_fine / T(2) - T(64000);
+         var2 = var1 * var1 * c.dig_P6 / T(32768);
+         var2 = var2 + var1 * c.dig_P5 * T(2);
+         var2 = var2 / T(4) + c.dig_P4 * T(65536);
+         var1 = (c.dig_P3 * var1 * var1 / T(524288) + c.dig_P2 * var1) / T(524288);
+         var1 = (T(1) + var1 / T(32768)) * c.dig_P1;
+         if(var1 == T(0)) out.pres_pa = T(0);
+         else {
+            T p = T(1048576) - static_cast<T>(r.adc_p);
+            p = (p - var2 / T(4096)) * T(6250) / var1;
+            var1 = c.dig_P9 * p * p / T(2147483648.0);
+            var2 = p * c.dig_P8 / T(32768);
+            out.pres_pa = p + (var1 + var2 + c.dig_P7) / T(16);
+         }
+      }
+
+      if((r.skip & chan_h) == 0) {
+         T h = t_fine - T(76800);
+         h = (static_cast<T>(r.adc_h) - (c.dig_H4 * T(64) + c.dig_H5 / T(16384) * h)) *
+             (c.dig_H2 / T(65536) * (T(1) + c.dig_H6 / T(67108864) * h *
+             (T(1) + c.dig_H3 / T(67108864) * h)));
+         h = h * (T(1) - c.dig_H1 * h / T(524288));
+         out.humi_rh = h > T(100) ? T(100) : h < T(0) ? T(0) : h;
+      }
+      return out;
+   }
+};
+
+using Float = Floating<float>;
+using Double = Floating<double>;
+
+/* ------------------------------------------------------------ *
+ * Fixed - datasheet integer compensation, 32 bit temperature   *
+ * and humidity, 64 bit pressure (fixed_bme280.c). Skipped      *
+ * channels are 0. The negative left shifts of the datasheet    *
+ * are written as multiplications, they are not constexpr.      *
+ * ------------------------------------------------------------ */
+struct Fixed {
+   struct Reading {
+      int32_t temp_c;   // temperature in 0.01*C
+      uint32_t pres_pa; // pressure in 1/256 Pa
+      uint32_t humi_rh; // relative humidity in 1/1024 %
+      uint8_t skip;     // skipped channels chan_*
+   };
+
+   static constexpr Reading compensate(const Calib &c, const Raw &r) {
+      Reading out { 0, 0, 0, r.skip };
+      if(r.skip & chan_t) {
+         out.skip = chan_all;
+         return out;
+      }
+      int32_t adc_t = r.adc_t;
+      int32_t var1 = (((adc_t >> 3) - (static_cast<int32_t>(c.dig_T1) << 1)) * c.dig_T2) >> 11;
+      int32_t var2 = (((((adc_t >> 4) - static_cast<int32_t>(c.dig_T1)) *
+                     ((adc_t >> 4) - static_cast<int32_t>(c.dig_T1))) >> 12) * c.dig_T3) >> 14;
+      int32_t t_fine = var1 + var2;
+      out.temp_c = (t_fine * 5 + 128) >> 8;
+
+      if((r.skip & chan_p) == 0) {
+         int64_t v1 = static_cast<int64_t>(t_fine) - 128000;
+         int64_t v2 = v1 * v1 * c.dig_P6;
+         v2 = v2 + v1 * c.dig_P5 * (int64_t(1) << 17);
+         v2 = v2 + c.dig_P4 * (int64_t(1) << 35);
+         v1 = ((v1 * v1 * c.dig_P3) >> 8) + v1 * c.dig_P2 * (int64_t(1) << 12);
+         v1 = ((int64_t(1) << 47) + v1) * c.dig_P1 >> 33;
+         if(v1 != 0) {
+            int64_t p = 1048576 - r.adc_p;
+            p = ((p << 31) - v2) * 3125 / v1;
+            v1 = (static_cast<int64_t>(c.dig_P9) * (p >> 13) * (p >> 13)) >> 25;
+            v2 = (static_cast<int64_t>(c.dig_P8) * p) >> 19;
+            out.pres_pa = static_cast<uint32_t>(((p + v1 + v2) >> 8) + c.dig_P7 * int64_t(16));
+         }
+      }
+
+      if((r.skip & chan_h) == 0) {
+         int32_t v = t_fine - 76800;
+         v = ((((r.adc_h << 14) - c.dig_H4 * (int32_t(1) << 20) - c.dig_H5 * v) + 16384) >> 15)
+             * (((((((v * c.dig_H6) >> 10) * (((v * c.dig_H3) >> 11) + 32768)) >> 10)
+             + 2097152) * c.dig_H2 + 8192) >> 14);
+         v = v - (((((v >> 15) * (v >> 15)) >> 7) * c.dig_H1) >> 4);
+         v = v < 0 ? 0 : v > 419430400 ? 419430400 : v;
+         out.humi_rh = static_cast<uint32_t>(v >> 12);
+      }
+      return out;
+   }
+};
+
+/* ------------------------------------------------------------ *
+ * LinuxI2c - transport over a /dev/i2c-N bus device            *
+ * ------------------------------------------------------------ */
+class LinuxI2c {
+public:
+   LinuxI2c(const char *bus, uint8_t addr) : fd_(::open(bus, O_RDWR | O_CLOEXEC)) {
+      if(fd_ >= 0 && ::ioctl(fd_, I2C_SLAVE, addr) != 0) {
+         ::close(fd_);
+         fd_ = -1;
+      }
+   }
+   ~LinuxI2c() { if(fd_ >= 0) ::close(fd_); }
+   LinuxI2c(const LinuxI2c&) = delete;
+   LinuxI2c &operator=(const LinuxI2c&) = delete;
+   LinuxI2c(LinuxI2c &&o) noexcept : fd_(std::exchange(o.fd_, -1)) {}
+
+   bool ok() const { return fd_ >= 0; }
+
+   bool read(uint8_t reg, uint8_t *buf, std::size_t len) {
+      return ::write(fd_, &reg, 1) == 1 && ::read(fd_, buf, len) == static_cast<ssize_t>(len);
+   }
+   bool write(uint8_t reg, uint8_t val) {
+      uint8_t buf[2] = { reg, val };
+      return ::write(fd_, buf, 2) == 2;
+   }
+
+private:
+   int fd_;
+};
+
+/* ------------------------------------------------------------ *
+ * Bme280<Transport, Precision> - the driver. The constructor   *
+ * arguments go to the Transport. begin() reads the chip id and *
+ * calibration, and must succeed before the reads.              *
+ * ------------------------------------------------------------ */
+template <typename Transport, typename Precision = Float>
+class Bme280 {
+public:
+   using Reading = typename Precision::Reading;
+
+   template <typename... Args>
+   explicit Bme280(Args&&... args) : bus_(std::forward<Args>(args)...) {}
+
+   Transport &transport() { return bus_; }
+   const Calib &calib() const { return cal_; }
+   const Settings &settings() const { return set_; }
+   uint8_t chip_id() const { return id_; }
+
+   /* -- The BMP280 (0x56..0x58) has no humidity -- */
+   bool has_humidity() const { return id_ == 0x60; }
+
+   bool begin() {
+      uint8_t tp[26], h[7];
+      if(!bus_.read(reg::chip_id, &id_, 1)) return false;
+      if(id_ != 0x60 && (id_ < 0x56 || id_ > 0x58)) return false;
+      if(!bus_.read(reg::calib00, tp, sizeof(tp))) return false;
+      if(has_humidity() && !bus_.read(reg::calib26, h, sizeof(h))) return false;
+      cal_ = Calib::parse(tp, has_humidity() ? h : nullptr);
+      return true;
+   }
+
+   /* ---------------------------------------------------------- *
+    * configure() writes the settings. config is only written in *
+    * sleep mode, and ctrl_hum takes effect with the next write  *
+    * of ctrl_meas (datasheet 5.4.3 and 5.4.6).                  *
+    * ---------------------------------------------------------- */
+   bool configure(const Settings &s) {
+      Settings n = has_humidity() ? s : s.humidity(Osrs::skip);
+      if(!bus_.write(reg::ctrl_meas, n.mode(Mode::sleep).ctrl_meas())) return false;
+      if(!bus_.write(reg::config, n.config())) return false;
+      if(has_humidity() && !bus_.write(reg::ctrl_hum, n.ctrl_hum())) return false;
+      if(n.pmode == Mode::normal && !bus_.write(reg::ctrl_meas, n.ctrl_meas())) return false;
+      set_ = n;
+      return true;
+   }
+
+   /* -- read() reads and compensates the current data registers -- */
+   bool read(Reading &out) {
+      uint8_t buf[8] = {0};
+      if(!bus_.read(reg::data, buf, has_humidity() ? 8 : 6)) return false;
+      out = Precision::compensate(cal_, Raw::decode(buf, set_.skip()));
+      return true;
+   }
+
+   /* ---------------------------------------------------------- *
+    * measure() triggers one forced conversion, waits the max.   *
+    * measurement time, checks the measuring bit, and reads it.  *
+    * In normal mode it reads the last conversion.               *
+    * ---------------------------------------------------------- */
+   bool measure(Reading &out) {
+      if(set_.pmode == Mode::normal) return read(out);
+      if(!bus_.write(reg::ctrl_meas, set_.mode(Mode::forced).ctrl_meas())) return false;
+      std::this_thread::sleep_for(std::chrono::microseconds(set_.measure_us()));
+      uint8_t status = 0x08;
+      for(int i = 0; i < 100 && (status & 0x08); i++) {
+         if(!bus_.read(reg::status, &status, 1)) return false;
+         if(status & 0x08) std::this_thread::sleep_for(std::chrono::microseconds(500));
+      }
+      return read(out);
+   }
+
+   /* -- reset() soft resets the sensor, settings go to sleep -- */
+   bool reset() {
+      if(!bus_.write(reg::reset, 0xB6)) return false;
+      set_ = Settings().temperature(Osrs::skip).pressure(Osrs::skip)
+                       .humidity(Osrs::skip).mode(Mode::sleep);
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      return true;
+   }
+
+private:
+   Transport bus_;
+   Calib cal_ {};
+   Settings set_ = Settings().mode(Mode::sleep);
+   uint8_t id_ = 0;
+};
+
+} // namespace bme280
+
+#endif
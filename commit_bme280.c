@@ -0,0 +1,176 @@
+/* ------------------------------------------------------------ *
+ * file:        commit_bme280.c                                 *
+ * purpose:     Group commit for the file outputs of "-c": the  *
+ *              text log "-l" and the store file "-z". Samples  *
+ *              are buffered, and written and synced together   *
+ *              once a group reaches a sample count or an age,  *
+ *              so high-rate logging does not cost one flash    *
+ *              write per sample. Sync policies:                *
+ *                                                              *
+ *              none: write only, the kernel writes back later  *
+ *              data: fdatasync() after each group (default)    *
+ *              full: fsync() after each group, incl. metadata  *
+ *                                                              *
+ *              A power cut loses at most the open group. The   *
+ *              tail recovery rules: a text log is cut back to  *
+ *              its last complete line, a store file to its     *
+ *              last complete block (see bmez_open).            *
+ *                                                              *
+ * author:      10/18/2026 agent                                *
+ * ------------------------------------------------------------ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "getbme280.h"
+
+extern int verbose;
+
+/* ------------------------------------------------------------ *
+ * group_now() returns the monotonic clock in seconds           *
+ * ------------------------------------------------------------ */
+static double group_now() {
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* ------------------------------------------------------------ *
+ * group_init() parses the -G argument "count:seconds[:sync]"   *
+ * ------------------------------------------------------------ */
+int group_init(struct bmegroup *grp, char *spec) {
+   char sync[8] = "data";
+
+   memset(grp, 0, sizeof(*grp));
+   int n = sscanf(spec, "%d:%d:%7s", &grp->count, &grp->age, sync);
+   if(n < 2 || grp->count < 1 || grp->age < 0) {
+      printf("Error: invalid group commit setting %s.\n", spec);
+      return(-1);
+   }
+   if(strcmp(sync, "none") == 0)      grp->sync = SYNC_NONE;
+   else if(strcmp(sync, "data") == 0) grp->sync = SYNC_DATA;
+   else if(strcmp(sync, "full") == 0) grp->sync = SYNC_FULL;
+   else {
+      printf("Error: invalid sync policy %s.\n", sync);
+      return(-1);
+   }
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * group_add() counts one buffered sample, and returns 1 if the *
+ * group is due for its commit by count or age.                 *
+ * ------------------------------------------------------------ */
+int group_add(struct bmegroup *grp) {
+   double now = group_now();
+   if(grp->pending == 0) grp->since = now;
+   grp->pending++;
+   return(grp->pending >= grp->count || now - grp->since >= grp->age);
+}
+
+/* ------------------------------------------------------------ *
+ * group_done() starts the next group after a commit            *
+ * ------------------------------------------------------------ */
+void group_done(struct bmegroup *grp) {
+   if(grp->pending > 0) grp->commits++;
+   grp->pending = 0;
+}
+
+/* ------------------------------------------------------------ *
+ * bme_sync() syncs a file with the given policy                *
+ * ------------------------------------------------------------ */
+int bme_sync(int fd, int sync) {
+   int res = 0;
+   if(sync == SYNC_DATA) res = fdatasync(fd);
+   if(sync == SYNC_FULL) res = fsync(fd);
+   if(res != 0) printf("Error: sync failure on file descriptor %d\n", fd);
+   return(res);
+}
+
+/* ------------------------------------------------------------ *
+ * log_open() opens or creates a text log for appending. A torn *
+ * last line, e.g. after a power cut, is cut off so the next    *
+ * line starts clean. Returns 0, or -1 on errors.               *
+ * ------------------------------------------------------------ */
+int log_open(struct bmelog *blog, char *file, int sync) {
+   struct stat st;
+
+   memset(blog, 0, sizeof(*blog));
+   blog->sync = sync;
+   if((blog->fd = open(file, O_RDWR | O_CREAT | O_APPEND, 0644)) < 0) {
+      printf("Error open %s for writing.\n", file);
+      return(-1);
+   }
+   if(fstat(blog->fd, &st) != 0) {
+      printf("Error: cannot stat %s.\n", file);
+      close(blog->fd);
+      return(-1);
+   }
+
+   /* ---------------------------------------------------------- *
+    * Search backwards for the last newline                      *
+    * ---------------------------------------------------------- */
+   off_t end = st.st_size;
+   char buf[512];
+   while(end > 0) {
+      off_t off = end > (off_t) sizeof(buf) ? end - sizeof(buf) : 0;
+      ssize_t n = pread(blog->fd, buf, end - off, off);
+      if(n != end - off) {
+         printf("Error: read failure for %s.\n", file);
+         close(blog->fd);
+         return(-1);
+      }
+      while(n > 0 && buf[n-1] != '\n') n--;
+      if(n > 0) { end = off + n; break; }
+      end = off;
+   }
+   if(end < st.st_size) {
+      if(verbose == 1) printf("Debug: Drop torn log line: [%lld bytes]\n",
+                              (long long) (st.st_size - end));
+      if(ftruncate(blog->fd, end) != 0) {
+         printf("Error: cannot truncate %s.\n", file);
+         close(blog->fd);
+         return(-1);
+      }
+   }
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * log_commit() writes the buffered lines in one write() and    *
+ * syncs them with the log sync policy                          *
+ * ------------------------------------------------------------ */
+int log_commit(struct bmelog *blog) {
+   if(blog->len == 0) return(0);
+   if(write(blog->fd, blog->buf, blog->len) != (ssize_t) blog->len) {
+      printf("Error: log write failure.\n");
+      return(-1);
+   }
+   blog->len = 0;
+   return bme_sync(blog->fd, blog->sync);
+}
+
+/* ------------------------------------------------------------ *
+ * log_put() buffers one line. A full buffer is committed early *
+ * ------------------------------------------------------------ */
+int log_put(struct bmelog *blog, char *line, size_t len) {
+   if(blog->len + len > sizeof(blog->buf) && log_commit(blog) != 0) return(-1);
+   if(len > sizeof(blog->buf)) return(-1);
+   memcpy(blog->buf + blog->len, line, len);
+   blog->len += len;
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * log_close() commits the buffered lines and closes the log    *
+ * ------------------------------------------------------------ */
+int log_close(struct bmelog *blog) {
+   int res = log_commit(blog);
+   if(close(blog->fd) != 0) res = -1;
+   blog->fd = -1;
+   return(res);
+}
@@ -0,0 +1,149 @@
+/* ------------------------------------------------------------ *
+ * file:        comp_bme280.c                                   *
+ * purpose:     Alternative compensation implementations from   *
+ *              the BME280 and BMP280 datasheets, next to the   *
+ *              float version bme_compensate() in i2c_bme280.c. *
+ *              All take the raw adc values in bmedata, and set *
+ *              temp_c, temp_f, pres_p and humi_p like it does, *
+ *              NAN for skipped channels:                       *
+ *                                                              *
+ *              double  datasheet floating point version        *
+ *              int64   datasheet integer version, 32 bit       *
+ *                      temperature and humidity, 64 bit        *
+ *                      pressure, resolution 0.01*C, 1/256 Pa,  *
+ *                      1/1024 %                                *
+ *              int32   as int64, with the 32 bit pressure      *
+ *                      version of the BMP280 datasheet, 1 Pa   *
+ *                                                              *
+ *              The integer formulas are in fixed_bme280.c.     *
+ *                                                              *
+ *              "-K" selects the version used by get_data() and *
+ *              the query subcommand. bench280 measures their   *
+ *              accuracy and speed.                             *
+ *                                                              *
+ * author:      10/18/2026 agent                                *
+ * ------------------------------------------------------------ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "getbme280.h"
+
+/* ------------------------------------------------------------ *
+ * Compensation versions by name, the first is the default      *
+ * ------------------------------------------------------------ */
+static struct bmecomp comps[] = {
+   { "float",  bme_compensate },
+   { "double", comp_double },
+   { "int64",  comp_int64 },
+   { "int32",  comp_int32 },
+   { NULL,     NULL }
+};
+void (*compensate)(struct bmecal*, struct bmedata*) = bme_compensate;
+
+/* ------------------------------------------------------------ *
+ * get_comp() returns the compensation version list, or the one *
+ * with the given name (NULL if unknown) if name is not NULL.   *
+ * ------------------------------------------------------------ */
+struct bmecomp *get_comp(char *name) {
+   if(name == NULL) return comps;
+   for(int i = 0; comps[i].name != NULL; i++) {
+      if(strcmp(comps[i].name, name) == 0) return &comps[i];
+   }
+   return NULL;
+}
+
+/* ------------------------------------------------------------ *
+ * comp_skipped() sets all values to NAN if the temperature is  *
+ * skipped, the others need its t_fine. Returns 1 in that case. *
+ * ------------------------------------------------------------ */
+static int comp_skipped(struct bmedata *bmed) {
+   if((bmed->skip & CHAN_T) == 0) return 0;
+   bmed->temp_c = bmed->temp_f = bmed->pres_p = bmed->humi_p = NAN;
+   return 1;
+}
+
+/* ------------------------------------------------------------ *
+ * comp_p_double() returns the pressure in Pa                   *
+ * ------------------------------------------------------------ */
+static double comp_p_double(struct bmecal *bmec, double adc_p, int32_t t_fine) {
+   double var1 = t_fine / 2.0 - 64000.0;
+   double var2 = var1 * var1 * bmec->dig_P6 / 32768.0;
+   var2 = var2 + var1 * bmec->dig_P5 * 2.0;
+   var2 = var2 / 4.0 + bmec->dig_P4 * 65536.0;
+   var1 = (bmec->dig_P3 * var1 * var1 / 524288.0 + bmec->dig_P2 * var1) / 524288.0;
+   var1 = (1.0 + var1 / 32768.0) * bmec->dig_P1;
+   if(var1 == 0) return 0;
+   double p = 1048576.0 - adc_p;
+   p = (p - var2 / 4096.0) * 6250.0 / var1;
+   var1 = bmec->dig_P9 * p * p / 2147483648.0;
+   var2 = p * bmec->dig_P8 / 32768.0;
+   return p + (var1 + var2 + bmec->dig_P7) / 16.0;
+}
+
+/* ------------------------------------------------------------ *
+ * comp_double() - datasheet floating point compensation        *
+ * ------------------------------------------------------------ */
+void comp_double(struct bmecal *bmec, struct bmedata *bmed) {
+   if(comp_skipped(bmed)) return;
+   double adc_t = bmed->adc_t;
+   double adc_h = bmed->adc_h;
+
+   double var1 = (adc_t/16384.0 - bmec->dig_T1/1024.0) * bmec->dig_T2;
+   double var2 = (adc_t/131072.0 - bmec->dig_T1/8192.0) *
+                 (adc_t/131072.0 - bmec->dig_T1/8192.0) * bmec->dig_T3;
+   int32_t t_fine = (int32_t) (var1 + var2);
+   bmed->temp_c = (var1 + var2) / 5120.0;
+   bmed->temp_f = bmed->temp_c * 1.8 + 32;
+
+   if(bmed->skip & CHAN_P) bmed->pres_p = NAN;
+   else bmed->pres_p = comp_p_double(bmec, bmed->adc_p, t_fine);
+
+   if(bmed->skip & CHAN_H) {
+      bmed->humi_p = NAN;
+      return;
+   }
+   double h = t_fine - 76800.0;
+   h = (adc_h - (bmec->dig_H4 * 64.0 + bmec->dig_H5 / 16384.0 * h)) *
+       (bmec->dig_H2 / 65536.0 * (1.0 + bmec->dig_H6 / 67108864.0 * h *
+       (1.0 + bmec->dig_H3 / 67108864.0 * h)));
+   h = h * (1.0 - bmec->dig_H1 * h / 524288.0);
+   if(h > 100.0) h = 100.0;
+   else if(h < 0.0) h = 0.0;
+   bmed->humi_p = h;
+}
+
+/* ------------------------------------------------------------ *
+ * comp_int64() - datasheet integer compensation, 64 bit for    *
+ * the pressure                                                 *
+ * ------------------------------------------------------------ */
+void comp_int64(struct bmecal *bmec, struct bmedata *bmed) {
+   if(comp_skipped(bmed)) return;
+   int32_t t_fine;
+   bmed->temp_c = comp_t_int32(bmec, bmed->adc_t, &t_fine) / 100.0;
+   bmed->temp_f = bmed->temp_c * 1.8 + 32;
+
+   if(bmed->skip & CHAN_P) bmed->pres_p = NAN;
+   else bmed->pres_p = comp_p_int64(bmec, bmed->adc_p, t_fine) / 256.0;
+
+   if(bmed->skip & CHAN_H) bmed->humi_p = NAN;
+   else bmed->humi_p = comp_h_int32(bmec, bmed->adc_h, t_fine) / 1024.0;
+}
+
+/* ------------------------------------------------------------ *
+ * comp_int32() - as comp_int64(), with the BMP280 datasheet 32 *
+ * bit pressure compensation                                    *
+ * ------------------------------------------------------------ */
+void comp_int32(struct bmecal *bmec, struct bmedata *bmed) {
+   if(comp_skipped(bmed)) return;
+   int32_t t_fine;
+   bmed->temp_c = comp_t_int32(bmec, bmed->adc_t, &t_fine) / 100.0;
+   bmed->temp_f = bmed->temp_c * 1.8 + 32;
+
+   if(bmed->skip & CHAN_P) bmed->pres_p = NAN;
+   else bmed->pres_p = comp_p_int32(bmec, bmed->adc_p, t_fine);
+
+   if(bmed->skip & CHAN_H) bmed->humi_p = NAN;
+   else bmed->humi_p = comp_h_int32(bmec, bmed->adc_h, t_fine) / 1024.0;
+}
@@ -0,0 +1,166 @@
+/* ------------------------------------------------------------ *
+ * file:        control_bme280.c                                *
+ * purpose:     Control socket for live reconfiguration of a    *
+ *              running "-c" sampler. "-S path" listens on a    *
+ *              Unix-domain stream socket, and the sampling     *
+ *              loop serves it between two samples. Each line   *
+ *              is one command, with the arguments of the same  *
+ *              command line options:                           *
+ *                                                              *
+ *              m <type>-<rate>  oversampling, e.g. "m p-16"    *
+ *              f <coefficient>  IIR filter, e.g. "f 4"         *
+ *              s <ms>           standby time, e.g. "s 62.5"    *
+ *              P <preset>       datasheet preset, "P indoor"   *
+ *              i                report only                    *
+ *                                                              *
+ *              The reply is "OK" or "ERR", and the new         *
+ *              effective timing. The calibration, the I2C file *
+ *              descriptor and all outputs stay open, so the    *
+ *              data stream continues without a gap. Example:   *
+ *              echo "m p-16" | nc -U /run/bme280.sock          *
+ *              OK odr=24.69Hz meas=40.00ms bw=0.519Hz          *
+ *                                                              *
+ * author:      10/18/2026 agent                                *
+ * ------------------------------------------------------------ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "getbme280.h"
+
+extern int verbose;
+
+/* ------------------------------------------------------------ *
+ * ctl_open() creates the listening control socket. A stale     *
+ * socket file from an earlier run is replaced. Returns the     *
+ * socket, or -1 on errors.                                     *
+ * ------------------------------------------------------------ */
+int ctl_open(char *path) {
+   struct sockaddr_un sa;
+
+   if(strlen(path) >= sizeof(sa.sun_path)) {
+      printf("Error: control socket path %s to long.\n", path);
+      return(-1);
+   }
+   int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+   if(fd < 0) {
+      printf("Error: cannot create the control socket.\n");
+      return(-1);
+   }
+   memset(&sa, 0, sizeof(sa));
+   sa.sun_family = AF_UNIX;
+   strncpy(sa.sun_path, path, sizeof(sa.sun_path) - 1);
+   unlink(path);
+   if(bind(fd, (struct sockaddr *) &sa, sizeof(sa)) != 0 || listen(fd, 4) != 0) {
+      printf("Error: cannot listen on control socket %s.\n", path);
+      close(fd);
+      return(-1);
+   }
+   if(verbose == 1) printf("Debug: Control socket: [%s]\n", path);
+   return(fd);
+}
+
+/* ------------------------------------------------------------ *
+ * ctl_apply() runs one command. Config register writes are     *
+ * only reliable in sleep mode, so the sensor sleeps during the *
+ * change, and returns to normal mode if it was running.        *
+ * Returns 0, or -1 on errors.                                  *
+ * ------------------------------------------------------------ */
+static int ctl_apply(char *cmd) {
+   struct bmeinf bmei;
+   int res = 0;
+
+   while(*cmd == ' ') cmd++;
+   char op = cmd[0];
+   char *arg = cmd + 1;
+   while(*arg == ' ') arg++;
+   if(op == 'i') return(0);
+   if(strchr("mfsP", op) == NULL || *arg == '\0') return(-1);
+
+   if(bme_snapshot(&bmei) != 0) return(-1);
+   if(bmei.power_mode != psleep) res |= set_power(psleep);
+
+   if(op == 'm') {
+      if(arg[1] != '-') res = -1;
+      else if(arg[0] == 't') res |= set_t_osrs(arg + 2);
+      else if(arg[0] == 'p') res |= set_p_osrs(arg + 2);
+      else if(arg[0] == 'h') res |= set_h_osrs(arg + 2);
+      else res = -1;
+   }
+   if(op == 'f') res |= set_filter(arg);
+   if(op == 's') res |= set_stby(arg);
+   if(op == 'P') {
+      struct bmepreset *bmpr = get_preset(arg);
+      if(bmpr == NULL) res = -1;
+      else {
+         res |= set_preset(bmpr);
+         bmei.power_mode = bmpr->mode == normal ? normal : psleep;
+      }
+   }
+
+   if(bmei.power_mode == normal) res |= set_power(normal);
+   return(res == 0 ? 0 : -1);
+}
+
+/* ------------------------------------------------------------ *
+ * ctl_client() reads the commands of one connection, applies   *
+ * them, and answers each with the new effective timing. rate   *
+ * is the sample rate of the loop in Hz, for forced mode.       *
+ * ------------------------------------------------------------ */
+static void ctl_client(int cfd, float rate) {
+   char buf[256];
+   size_t len = 0;
+   struct pollfd pfd = { cfd, POLLIN, 0 };
+
+   /* ---------------------------------------------------------- *
+    * Wait at most 100ms for data, so a stuck client cannot hold *
+    * up the sampling loop                                       *
+    * ---------------------------------------------------------- */
+   while(len < sizeof(buf) - 1 && poll(&pfd, 1, 100) == 1) {
+      ssize_t n = read(cfd, buf + len, sizeof(buf) - 1 - len);
+      if(n <= 0) break;
+      len += n;
+      if(buf[len-1] == '\n') break;
+   }
+   buf[len] = '\0';
+
+   for(char *line = strtok(buf, "\r\n"); line != NULL; line = strtok(NULL, "\r\n")) {
+      int res = ctl_apply(line);
+      if(verbose == 1) printf("Debug: Control command: [%s] result [%d]\n", line, res);
+
+      struct bmeinf bmei;
+      struct bmetime bmet;
+      char reply[128];
+      if(bme_snapshot(&bmei) != 0) res = -1;
+      bme_timing(&bmei, rate, &bmet);
+      int n = snprintf(reply, sizeof(reply), "%s odr=%.2fHz meas=%.2fms bw=%.3gHz\n",
+                       res == 0 ? "OK" : "ERR", bmet.odr, bmet.meas_typ, bmet.bandw);
+      // MSG_NOSIGNAL: a client that is gone must not SIGPIPE the sampler
+      if(send(cfd, reply, n, MSG_NOSIGNAL) != n) break;
+   }
+}
+
+/* ------------------------------------------------------------ *
+ * ctl_poll() serves all pending connections of the control     *
+ * socket without waiting, called between two samples.          *
+ * ------------------------------------------------------------ */
+void ctl_poll(int fd, float rate) {
+   int cfd;
+   while((cfd = accept(fd, NULL, NULL)) >= 0) {
+      ctl_client(cfd, rate);
+      close(cfd);
+   }
+}
+
+/* ------------------------------------------------------------ *
+ * ctl_close() closes the control socket and removes its file   *
+ * ------------------------------------------------------------ */
+void ctl_close(int fd, char *path) {
+   close(fd);
+   unlink(path);
+}
@@ -0,0 +1,169 @@
+/* ------------------------------------------------------------ *
+ * file:        filter_bme280.c                                 *
+ * purpose:     Software filter chain for "-c -F", applied to   *
+ *              the compensated temperature, humidity and       *
+ *              pressure of each sample before the output:      *
+ *                                                              *
+ *              ema[:alpha]     exponential moving average,     *
+ *                              y += alpha * (x - y), O(1)      *
+ *              median[:n]      rolling median over n samples,  *
+ *                              rejects single-sample spikes,   *
+ *                              binary search in a sorted copy  *
+ *                              of the window, n <= 31          *
+ *              kalman[:ratio]  scalar Kalman filter, random    *
+ *                              walk model, O(1). ratio is the  *
+ *                              process to measurement noise    *
+ *                              variance, so one value fits all *
+ *                              channels regardless of units.   *
+ *                                                              *
+ *              Stages run in the given order, e.g.             *
+ *              "-F median:5,ema:0.3" removes spikes first. The *
+ *              sensor can then run in its fastest mode without *
+ *              the hardware IIR filter, which slows the step   *
+ *              response of every consumer alike.               *
+ *                                                              *
+ * author:      10/18/2026 agent                                *
+ * ------------------------------------------------------------ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "getbme280.h"
+
+extern int verbose;
+
+/* ------------------------------------------------------------ *
+ * filter_stage() parses one stage "name[:param]"               *
+ * ------------------------------------------------------------ */
+static int filter_stage(struct bmefstage *st, char *spec) {
+   char *arg = strchr(spec, ':');
+   if(arg != NULL) *arg++ = '\0';
+
+   memset(st, 0, sizeof(*st));
+   if(strcmp(spec, "ema") == 0) {
+      st->type = FILT_EMA;
+      st->param = arg ? atof(arg) : 0.2;
+      if(st->param <= 0 || st->param > 1) return(-1);
+   }
+   else if(strcmp(spec, "median") == 0) {
+      st->type = FILT_MEDIAN;
+      st->n = arg ? atoi(arg) : 5;
+      if(st->n < 3 || st->n > FILT_MEDIAN_MAX || st->n % 2 == 0) return(-1);
+   }
+   else if(strcmp(spec, "kalman") == 0) {
+      st->type = FILT_KALMAN;
+      st->param = arg ? atof(arg) : 0.01;
+      if(st->param <= 0) return(-1);
+   }
+   else return(-1);
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * filter_init() parses the -F argument, a comma separated list *
+ * of up to FILT_STAGES stages. Returns 0 or -1 on errors.      *
+ * ------------------------------------------------------------ */
+int filter_init(struct bmefilter *bmef, char *spec) {
+   char buf[64];
+
+   memset(bmef, 0, sizeof(*bmef));
+   strncpy(buf, spec, sizeof(buf) - 1);
+   buf[sizeof(buf) - 1] = '\0';
+   for(char *tok = strtok(buf, ","); tok != NULL; tok = strtok(NULL, ",")) {
+      if(bmef->stages == FILT_STAGES || filter_stage(&bmef->st[bmef->stages], tok) != 0) {
+         printf("Error: invalid filter setting %s.\n", spec);
+         return(-1);
+      }
+      bmef->stages++;
+   }
+   if(bmef->stages == 0) {
+      printf("Error: invalid filter setting %s.\n", spec);
+      return(-1);
+   }
+   if(verbose == 1) printf("Debug: Software filter: [%s] stages [%d]\n", spec, bmef->stages);
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * median_pos() returns the insert position of x in the sorted  *
+ * window, found by binary search                               *
+ * ------------------------------------------------------------ */
+static int median_pos(float *sorted, int fill, float x) {
+   int lo = 0, hi = fill;
+   while(lo < hi) {
+      int mid = (lo + hi) / 2;
+      if(sorted[mid] < x) lo = mid + 1;
+      else hi = mid;
+   }
+   return lo;
+}
+
+/* ------------------------------------------------------------ *
+ * filter_one() runs one stage over one channel value           *
+ * ------------------------------------------------------------ */
+static float filter_one(struct bmefstage *st, int ch, float x) {
+   switch(st->type) {
+      case FILT_EMA:
+         if(st->init[ch] == 0) { st->y[ch] = x; st->init[ch] = 1; }
+         else st->y[ch] += st->param * (x - st->y[ch]);
+         return st->y[ch];
+
+      case FILT_MEDIAN: {
+         /* ------------------------------------------------------- *
+          * The ring keeps the arrival order, the sorted copy the   *
+          * values. The oldest value leaves the sorted copy before  *
+          * the new one is inserted.                                *
+          * ------------------------------------------------------- */
+         float *ring = st->ring[ch], *sorted = st->sorted[ch];
+         int fill = st->fill[ch];
+         if(fill == st->n) {
+            float old = ring[st->pos[ch]];
+            int i = median_pos(sorted, fill, old);
+            memmove(sorted + i, sorted + i + 1, (fill - i - 1) * sizeof(float));
+            fill--;
+         }
+         int i = median_pos(sorted, fill, x);
+         memmove(sorted + i + 1, sorted + i, (fill - i) * sizeof(float));
+         sorted[i] = x;
+         st->fill[ch] = ++fill;
+         ring[st->pos[ch]] = x;
+         st->pos[ch] = (st->pos[ch] + 1) % st->n;
+         return (fill % 2) ? sorted[fill/2] : (sorted[fill/2 - 1] + sorted[fill/2]) / 2;
+      }
+
+      case FILT_KALMAN: {
+         /* ------------------------------------------------------- *
+          * Random walk x(k) = x(k-1) + w, z(k) = x(k) + v, with    *
+          * var(v) = 1 and var(w) = ratio: p is the error variance  *
+          * in units of the measurement noise variance.             *
+          * ------------------------------------------------------- */
+         if(st->init[ch] == 0) { st->y[ch] = x; st->p[ch] = 1; st->init[ch] = 1; }
+         else {
+            float p = st->p[ch] + st->param;
+            float k = p / (p + 1);
+            st->y[ch] += k * (x - st->y[ch]);
+            st->p[ch] = (1 - k) * p;
+         }
+         return st->y[ch];
+      }
+   }
+   return x;
+}
+
+/* ------------------------------------------------------------ *
+ * filter_apply() runs the filter chain over the temperature,   *
+ * humidity and pressure of one sample. The raw adc values stay *
+ * as read, so "-z" stores the unfiltered samples. Channels     *
+ * without data (NAN humidity on BMP280) pass unchanged.        *
+ * ------------------------------------------------------------ */
+void filter_apply(struct bmefilter *bmef, struct bmedata *bmed) {
+   float *val[3] = { &bmed->temp_c, &bmed->humi_p, &bmed->pres_p };
+
+   for(int s = 0; s < bmef->stages; s++) {
+      for(int ch = 0; ch < 3; ch++) {
+         if(isnan(*val[ch])) continue;
+         *val[ch] = filter_one(&bmef->st[s], ch, *val[ch]);
+      }
+   }
+}
@@ -0,0 +1,78 @@
+/* ------------------------------------------------------------ *
+ * file:        fixed_bme280.c                                  *
+ * purpose:     The integer compensation of the BME280 and      *
+ *              BMP280 datasheets. comp_bme280.c builds the     *
+ *              int64 and int32 versions on it, and the tiny    *
+ *              build (tiny_bme280.c) prints its results with   *
+ *              no float code at all. It needs no libc.         *
+ *                                                              *
+ * author:      10/18/2026 agent                                *
+ * ------------------------------------------------------------ */
+#include <stdint.h>
+#include <sys/types.h>
+#include "getbme280.h"
+
+/* ------------------------------------------------------------ *
+ * comp_t_int32() returns the temperature in 0.01*C, and t_fine *
+ * ------------------------------------------------------------ */
+int32_t comp_t_int32(struct bmecal *bmec, int32_t adc_t, int32_t *t_fine) {
+   int32_t var1 = ((((adc_t >> 3) - ((int32_t) bmec->dig_T1 << 1))) * ((int32_t) bmec->dig_T2)) >> 11;
+   int32_t var2 = (((((adc_t >> 4) - ((int32_t) bmec->dig_T1)) *
+                  ((adc_t >> 4) - ((int32_t) bmec->dig_T1))) >> 12) * ((int32_t) bmec->dig_T3)) >> 14;
+   *t_fine = var1 + var2;
+   return (*t_fine * 5 + 128) >> 8;
+}
+
+/* ------------------------------------------------------------ *
+ * comp_h_int32() returns the humidity in 1/1024 %              *
+ * ------------------------------------------------------------ */
+uint32_t comp_h_int32(struct bmecal *bmec, int32_t adc_h, int32_t t_fine) {
+   int32_t v = t_fine - ((int32_t) 76800);
+   v = (((((adc_h << 14) - (((int32_t) bmec->dig_H4) << 20) - (((int32_t) bmec->dig_H5) * v))
+       + ((int32_t) 16384)) >> 15) * (((((((v * ((int32_t) bmec->dig_H6)) >> 10)
+       * (((v * ((int32_t) bmec->dig_H3)) >> 11) + ((int32_t) 32768))) >> 10)
+       + ((int32_t) 2097152)) * ((int32_t) bmec->dig_H2) + 8192) >> 14));
+   v = v - (((((v >> 15) * (v >> 15)) >> 7) * ((int32_t) bmec->dig_H1)) >> 4);
+   v = v < 0 ? 0 : v;
+   v = v > 419430400 ? 419430400 : v;
+   return (uint32_t) (v >> 12);
+}
+
+/* ------------------------------------------------------------ *
+ * comp_p_int64() returns the pressure in 1/256 Pa              *
+ * ------------------------------------------------------------ */
+uint32_t comp_p_int64(struct bmecal *bmec, int32_t adc_p, int32_t t_fine) {
+   int64_t var1 = ((int64_t) t_fine) - 128000;
+   int64_t var2 = var1 * var1 * (int64_t) bmec->dig_P6;
+   var2 = var2 + ((var1 * (int64_t) bmec->dig_P5) << 17);
+   var2 = var2 + (((int64_t) bmec->dig_P4) << 35);
+   var1 = ((var1 * var1 * (int64_t) bmec->dig_P3) >> 8) + ((var1 * (int64_t) bmec->dig_P2) << 12);
+   var1 = (((((int64_t) 1) << 47) + var1)) * ((int64_t) bmec->dig_P1) >> 33;
+   if(var1 == 0) return 0;
+   int64_t p = 1048576 - adc_p;
+   p = (((p << 31) - var2) * 3125) / var1;
+   var1 = (((int64_t) bmec->dig_P9) * (p >> 13) * (p >> 13)) >> 25;
+   var2 = (((int64_t) bmec->dig_P8) * p) >> 19;
+   p = ((p + var1 + var2) >> 8) + (((int64_t) bmec->dig_P7) << 4);
+   return (uint32_t) p;
+}
+
+/* ------------------------------------------------------------ *
+ * comp_p_int32() returns the pressure in Pa, BMP280 datasheet  *
+ * ------------------------------------------------------------ */
+uint32_t comp_p_int32(struct bmecal *bmec, int32_t adc_p, int32_t t_fine) {
+   int32_t var1 = (((int32_t) t_fine) >> 1) - (int32_t) 64000;
+   int32_t var2 = (((var1 >> 2) * (var1 >> 2)) >> 11) * ((int32_t) bmec->dig_P6);
+   var2 = var2 + ((var1 * ((int32_t) bmec->dig_P5)) << 1);
+   var2 = (var2 >> 2) + (((int32_t) bmec->dig_P4) << 16);
+   var1 = (((bmec->dig_P3 * (((var1 >> 2) * (var1 >> 2)) >> 13)) >> 3)
+          + ((((int32_t) bmec->dig_P2) * var1) >> 1)) >> 18;
+   var1 = ((((32768 + var1)) * ((int32_t) bmec->dig_P1)) >> 15);
+   if(var1 == 0) return 0;
+   uint32_t p = (((uint32_t) (((int32_t) 1048576) - adc_p) - (var2 >> 12))) * 3125;
+   if(p < 0x80000000) p = (p << 1) / ((uint32_t) var1);
+   else p = (p / (uint32_t) var1) * 2;
+   var1 = (((int32_t) bmec->dig_P9) * ((int32_t) (((p >> 3) * (p >> 3)) >> 13))) >> 12;
+   var2 = (((int32_t) (p >> 2)) * ((int32_t) bmec->dig_P8)) >> 13;
+   return (uint32_t) ((int32_t) p + ((var1 + var2 + bmec->dig_P7) >> 4));
+}
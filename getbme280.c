@@ -16,12 +16,15 @@
  * ------------------------------------------------------------ */
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdint.h>
 #include <ctype.h>
 #include <unistd.h>
 #include <string.h>
 #include <getopt.h>
 #include <time.h>
+#include <math.h>
+#include <signal.h>
 #include "getbme280.h"
 
 /* ------------------------------------------------------------ *
@@ -29,31 +32,75 @@
  * ------------------------------------------------------------ */
 int verbose = 0;
 int outflag = 0;
+int zflag = 0;
+int adaptflag = 0;
+int deriveflag = 0; // 1=precise, 2=fast derived values
+float elevation = 0; // station elevation in m for -x sea-level pressure
+int stampflag = 0;  // 1 = -N read time stamps in the output lines
 int argflag = 0; // 1=dump, 2=info, 3=reset, 4=data, 5=continuous
 char osrs_mode[7] = {0};  // oversampling mode
 char pwr_mode[7]  = {0};  // power mode
 char iir_mode[4]  = {0};  // IIR filter mode
 char stby_time[5] = {0};  // standby time
+char preset[16]   = {0};  // datasheet recommended mode
 char senaddr[256] = BME280_ADDR;
-char i2c_bus[256] = I2CBUS;
+char i2c_bus[SENSOR_LISTLEN] = I2CBUS;  // sensor list, see mux_bme280.c
 char htmfile[256] = {0};
+char zfile[256] = {0};
+char adapt_spec[32] = {0}; // adaptive sampling fast:slow[:dp]
+int ctlflag = 0;
+char ctlpath[108] = {0};   // control socket path
+int filterflag = 0;
+char filter_spec[64] = {0}; // software filter chain
+int qpolicy = BMEQ_DROP;   // -c queue overflow policy
+int qsize = BMEQ_SIZE;     // -c queue size in samples
+struct bmezw bmez;         // -z store writer
+int logflag = 0;
+char logfile[256] = {0};
+struct bmelog blog;        // -l text log writer
+char group_spec[32] = "60:60:data"; // group commit count:seconds:sync
+struct bmegroup grp;       // group commit state of -l and -z
+int pushflag = 0;
+char push_spec[256] = {0}; // -U destination[,id=n][,window=sec]
+struct bmepush bmpu;       // -U datagram push state
+int ruleflag = 0;
+char rulefile[256] = {0};  // -R event rule file
+struct bmerules bmer;      // -R event rules
+int lockflag = 0;
+char lock_spec[160] = {0}; // -L lock timeout ms[:dir]
+int iioflag = 0;
+char iio_spec[256] = {0};  // IIO device dir[,trigger=name][,dev=path]
+struct bmeiio bmeio;       // -I IIO device state
+extern struct bmesensor sensors[]; // the -b sensor list, in i2c_bme280.c
+extern int nsensors;
+extern long mux_writes;
+volatile sig_atomic_t stopflag = 0; // set by SIGINT/SIGTERM in -c
 
 /* ------------------------------------------------------------ *
  * print_usage() prints the programs commandline instructions.  *
  * ------------------------------------------------------------ */
 void usage() {
-   static char const usage[] = "Usage: getbme280 [-a hex i2c-addr] [-b i2c-bus] [-d] [-i] [-m osrs_mode] [-p pwrmode] [-t] [-c] [-r] [-o htmlfile] [-v]\n\
+   static char const usage[] = "Usage: getbme280 [-a hex i2c-addr] [-b i2c-bus] [-d] [-i] [-m osrs_mode] [-p pwrmode] [-P preset] [-t] [-c] [-r] [-o htmlfile] [-z storefile] [-l logfile] [-G count:sec[:sync]] [-A fast:slow] [-F filters] [-Q drop|block[:size]] [-S socket] [-R rulefile] [-x precise|fast] [-e elevation] [-N] [-K comp] [-I iiodev] [-U dest] [-L ms[:dir]] [-v]\n\
 \n\
 Command line parameters have the following format:\n\
    -a   sensor I2C bus address in hex, Example: -a 0x76 (default)\n\
    -b   I2C bus to query, Example: -b /dev/i2c-1 (default)\n\
+          or a comma separated sensor list, also behind TCA9548A muxes:\n\
+          bus[:mux@<addr>:<channel>][/<sensor addr>], default addr is -a\n\
+          example: -b /dev/i2c-1:mux@0x70:0,/dev/i2c-1:mux@0x70:1/0x77\n\
+          -c, -o and -z support one sensor\n\
+   -I   read the sensor through the Linux IIO kernel driver (bmp280), not\n\
+          /dev/i2c. arguments: <sysfs dir>[,trigger=<name>][,dev=<chrdev>]\n\
+          with a trigger, -c reads the IIO buffer chrdev, default /dev/<name>\n\
+          supports -i, -m, -t and -c, without -z, -A and -S, example:\n\
+          -I /sys/bus/iio/devices/iio:device0,trigger=hrtimer0\n\
    -d   dump the complete sensor register map content\n\
    -f   set sensor IIR filter mode. arguments: <coefficient>. examples:\n\
               off = disabled, 1 sample to reach >=75%% of step response\n\
                 2 = 2 samples to reach >= 75%% of step response\n\
                 4 = 5 samples to reach >= 75%% of step response\n\
           valid settings: off, 2, 4, 8, 16\n\
-   -i   print sensor information (config and calibration)\n\
+   -i   print sensor information (config, timing and calibration)\n\
    -m   set sensor oversampling mode. arguments: <type>-<rate>. examples:\n\
           t-skip  = disable the temperature measurement\n\
              t-1  = temperature 1x oversampling\n\
@@ -65,34 +112,244 @@ Command line parameters have the following format:\n\
           normal  = cycle between measuring and standby\n\
           forced  = take a single measurement and return to sleep\n\
           sleep   = no measurements (default after power-up)\n\
+   -P   apply a datasheet recommended mode, and print its timing. arguments:\n\
+          weather  = forced 1/min, p/t/h 1x, filter off (host triggers -t)\n\
+          humidity = forced 1/s, t/h 1x, no pressure, filter off\n\
+          indoor   = normal 0.5ms standby, p 16x, t 2x, h 1x, filter 16\n\
+          gaming   = normal 0.5ms standby, p 4x, t 1x, no humidity, filter 16\n\
    -r   reset sensor\n\
    -s   set sensor standby time for power mode normal. arguments: <ms>\n\
           valid ms settings: 0.5, 10, 20, 62.5, 125, 250, 500, 1000\n\
-   -t   read and output single measurement (power mode forced)\n\
+   -t   read and output single measurement (power mode forced), with several\n\
+          sensors in -b, all convert at the same time\n\
    -c   read and output continuous measurements (power mode normal, 1sec interval)\n\
+   -A   adaptive sampling for -c. arguments: <fast-ms>:<slow-ms>[:<Pa/min>]\n\
+          samples every slow-ms in forced mode with 1x oversampling while\n\
+          readings are stable, and every fast-ms in normal mode with 16x\n\
+          pressure oversampling and IIR filter 4 while they change faster\n\
+          than the threshold (default 3 Pa/min, 0.2*C/min, 1%%/min)\n\
+          example: -A 250:10000\n\
+   -F   software filter chain for -c, applied to the compensated values.\n\
+          arguments: comma separated stages, run in the given order:\n\
+          ema[:alpha]    = exponential moving average, default alpha 0.2\n\
+          median[:n]     = rolling median over n samples, default 5, max 31\n\
+          kalman[:ratio] = Kalman filter, process/measurement noise\n\
+                           variance ratio, default 0.01\n\
+          example: -F median:5,ema:0.3\n\
+   -Q   output queue of -c. The sampling loop queues the samples for a separate\n\
+          output thread, so slow outputs do not delay the sensor reads.\n\
+          arguments: <policy>[:<size>], if the queue is full:\n\
+          drop  = drop the oldest queued sample (default)\n\
+          block = wait for the output thread\n\
+          default size: 1024 samples, example: -Q block:64\n\
+   -S   control socket for -c, changes settings while sampling continues.\n\
+          commands: m <type>-<rate>, f <coefficient>, s <ms>, P <preset>, i\n\
+          the reply reports the new output data rate, example:\n\
+          -S /run/bme280.sock, then: echo \"f 4\" | nc -U /run/bme280.sock\n\
+   -R   event rules for -c, from a rule file. stdout then gets only the rule\n\
+          state changes instead of the samples, one rule per line:\n\
+          <name> temp|humi|pres [rate] >|< <limit> [hyst <h>] [window <sec>]\n\
+          events stdout|udp:<host>:<port>|unix:<path>|exec <command>\n\
+          example: -R /etc/bme280.rules\n\
+   -L   lock the I2C bus against other processes, for each run and each\n\
+          -c sample, waiting in FIFO order up to the timeout in ms. lock\n\
+          files: <dir>/bme280-<bus>.lock (default dir: /run/lock)\n\
+          example: -L 500, or -L 500:/tmp, -v prints the wait times\n\
    -o   output data to HTML table file (requires -t/-c), example: -o ./bme280.html\n\
+   -U   push each -c sample as 72 byte binary datagram to a collector. arguments:\n\
+          udp:<host>:<port> or unix:<path>, options: ,id=<n> sensor id\n\
+          (default: host id), ,window=<sec> send window averages instead\n\
+          example: -U udp:collector:5280,id=17, receive with the listen subcommand\n\
+   -z   append raw samples to a compressed store file (requires -t/-c)\n\
+          example: -z ./bme280.bmez, read back with the query subcommand\n\
+   -x   add derived values to the -t/-c output. arguments:\n\
+          precise = libm log/exp/pow\n\
+          fast    = polynomial approximation, dew point error < 0.001*C\n\
+          adds dew point, absolute humidity, altitude and sea-level pressure\n\
+   -e   station elevation in m for the -x sea-level pressure, example: -e 35\n\
+   -N   add the read time stamps to the -t/-c output: realtime and\n\
+          monotonic clock in ns at the data read, its latency, and\n\
+          the sample number. example: Time=1584280335.120354117\n\
+          Mono=5121.003377263 Latency=987412ns Seq=17\n\
+   -K   compensation version for the raw sensor values. arguments:\n\
+          float  = datasheet floating point, single precision (default)\n\
+          double = datasheet floating point, double precision\n\
+          int64  = datasheet integer, 64 bit pressure\n\
+          int32  = datasheet integer, 32 bit pressure (BMP280 datasheet)\n\
+          accuracy and speed of each version: ./bench280\n\
+   -l   append the output lines to a log file (requires -t/-c)\n\
+          example: -l ./bme280.log, read back with the query subcommand\n\
+   -G   group commit of the -l and -z files in -c mode. arguments:\n\
+          <count>:<seconds>[:<sync>], commit after count samples or when\n\
+          the oldest buffered sample is seconds old. sync policy:\n\
+          none = write only, data = fdatasync (default), full = fsync\n\
+          default: -G 60:60:data\n\
    -h   display this message\n\
    -v   enable debug output\n\
 \n\
+Subcommands:\n\
+   query  time-range query over a -c sample log or -z store, see: getbme280 query -h\n\
+   listen print the datagrams of -U, see: getbme280 listen -h\n\
+   reprocess  compensate -z stores on all cores, see: getbme280 reprocess -h\n\
+   tune   pick the cheapest settings for a rate and noise target, see: getbme280 tune -h\n\
+   sweep  noise and timing of all settings, CSV or JSON, see: getbme280 sweep -h\n\
 \n\
 Usage examples:\n\
 ./getbme280 -a 0x77 -b /dev/i2c-0 -i\n\
 ./getbme280 -t -v\n\
+./getbme280 -P indoor\n\
 ./getbme280 -c\n\
-./getbme280 -t -o ./bme280.html\n\n";
+./getbme280 -t -o ./bme280.html\n\
+./getbme280 -c -z ./bme280.bmez\n\
+./getbme280 -c -l ./bme280.log -G 600:300:data\n\
+./getbme280 -t -x precise -e 35\n\
+./getbme280 -t -b /dev/i2c-1:mux@0x70:0,/dev/i2c-1:mux@0x70:1\n\
+./getbme280 -t -I /sys/bus/iio/devices/iio:device0\n\
+./getbme280 -c -U udp:collector:5280,id=17,window=60\n\
+./getbme280 query bme280.log 2020-03-16T02:00 2020-03-16T03:00\n\
+./getbme280 tune -r 1 -n temp:0.01,pres:2 -M 50\n\
+./getbme280 sweep -n 64 -j -o node17.json\n\n";
    printf(usage);
 }
 
+/* ------------------------------------------------------------ *
+ * line_add() appends to line at position n, and returns the    *
+ * new length, at most size - 1 if the text is cut off.         *
+ * ------------------------------------------------------------ */
+static int line_add(char *line, size_t size, int n, const char *fmt, ...) {
+   if(n >= (int) size - 1) return n;
+   va_list ap;
+   va_start(ap, fmt);
+   int res = vsnprintf(line + n, size - n, fmt, ap);
+   va_end(ap);
+   if(res < 0) return n;
+   return (n + res > (int) size - 1) ? (int) size - 1 : n + res;
+}
+
+/* ------------------------------------------------------------ *
+ * format_data() formats one sample as output line, and returns *
+ * its length. Sensors without humidity (BMP280) omit the       *
+ * humidity field, and skipped channels (-m x-skip) their own.  *
+ * Example:                                                     *
+ * 1584280335 Temp=22.76*C Humidity=22.30% Pressure=1002.56hPa  *
+ * With -x, the derived values follow on the same line:         *
+ * Dewpoint=0.11*C AbsHumidity=4.51g/m3 Altitude=89.49m         *
+ * SeaLevel=1002.56hPa                                          *
+ * With -N, the read time stamps follow:                        *
+ * Time=1584280335.120354117 Mono=5121.003377263 Latency=412ns  *
+ * Seq=17                                                       *
+ * With several sensors in -b, the line ends with Sensor=<spec> *
+ * ------------------------------------------------------------ */
+int format_data(char *line, size_t size, time_t ts, struct bmedata *bmed, char *spec) {
+   int n = line_add(line, size, 0, "%lld", (long long) ts);
+   if(isnan(bmed->temp_c)) n = line_add(line, size, n, " Temp=skipped");
+   else n = line_add(line, size, n, " Temp=%3.2f*C", bmed->temp_c);
+   if(! isnan(bmed->humi_p))
+      n = line_add(line, size, n, " Humidity=%3.2f%%", bmed->humi_p);
+   if(! isnan(bmed->pres_p))
+      n = line_add(line, size, n, " Pressure=%3.2fhPa", bmed->pres_p/100);
+
+   if(deriveflag > 0) {
+      struct bmederiv bmedv;
+      derive_data(bmed, &bmedv, elevation, deriveflag == 2);
+      if(! isnan(bmedv.dewp_c))
+         n = line_add(line, size, n, " Dewpoint=%3.2f*C AbsHumidity=%3.2fg/m3",
+                     bmedv.dewp_c, bmedv.abshum);
+      if(! isnan(bmed->pres_p))
+         n = line_add(line, size, n, " Altitude=%3.2fm SeaLevel=%3.2fhPa",
+                     bmedv.alti_m, bmedv.qnh_p/100);
+   }
+   if(stampflag == 1)
+      n = line_add(line, size, n, " Time=%lld.%09lld Mono=%lld.%09lld Latency=%dns Seq=%u",
+                   (long long) (bmed->st.rt_ns / STAMP_NS), (long long) (bmed->st.rt_ns % STAMP_NS),
+                   (long long) (bmed->st.mono_ns / STAMP_NS), (long long) (bmed->st.mono_ns % STAMP_NS),
+                   bmed->st.lat_ns, bmed->st.seq);
+   if(spec != NULL) n = line_add(line, size, n, " Sensor=%s", spec);
+   /* ---------------------------------------------------------- *
+    * A line cut off at size still ends with the newline         *
+    * ---------------------------------------------------------- */
+   if(n == (int) size - 1) line[n-1] = '\n';
+   else n = line_add(line, size, n, "\n");
+   return(n);
+}
+
+/* ------------------------------------------------------------ *
+ * print_data() prints one sample line to stdout                *
+ * ------------------------------------------------------------ */
+void print_data(time_t ts, struct bmedata *bmed) {
+   char line[256];
+   format_data(line, sizeof(line), ts, bmed, NULL);
+   fputs(line, stdout);
+}
+
+/* ------------------------------------------------------------ *
+ * write_html() writes one sample as HTML table to the -o file  *
+ * ------------------------------------------------------------ */
+void write_html(struct bmedata *bmed) {
+   FILE *html;
+   if(! (html=fopen(htmfile, "w"))) {
+      printf("Error open %s for writing.\n", htmfile);
+      exit(-1);
+   }
+   fprintf(html, "<table><tr>\n");
+   fprintf(html, "<td class=\"sensordata\">Temperature:<span class=\"sensorvalue\">%3.2f</span></td>\n", bmed->temp_c);
+   if(! isnan(bmed->humi_p)) {
+      fprintf(html, "<td class=\"sensorspace\"></td>\n");
+      fprintf(html, "<td class=\"sensordata\">Humidity:<span class=\"sensorvalue\">%3.2f</span></td>\n", bmed->humi_p);
+   }
+   if(! isnan(bmed->pres_p)) {
+      fprintf(html, "<td class=\"sensorspace\"></td>\n");
+      fprintf(html, "<td class=\"sensordata\">Pressure:<span class=\"sensorvalue\">%3.2f</span></td>\n", bmed->pres_p);
+   }
+   fprintf(html, "</tr></table>\n");
+   fclose(html);
+}
+
+/* ------------------------------------------------------------ *
+ * sink_out() is the output function of the -c output thread,   *
+ * it writes one queued sample to all selected outputs. The     *
+ * file outputs -l and -z are written in group commits. With    *
+ * -R, stdout gets the rule events instead of the samples.      *
+ * ------------------------------------------------------------ */
+void sink_out(struct bmesample *bmes) {
+   char line[384];
+   int len = format_data(line, sizeof(line), bmes->ts, &bmes->bmed, NULL);
+
+   if(ruleflag == 1) rule_check(&bmer, bmes->ts, &bmes->bmed);
+   else {
+      fputs(line, stdout);
+      fflush(stdout);
+   }
+   if(outflag == 1) write_html(&bmes->bmed);
+   if(logflag == 1) log_put(&blog, line, len);
+   if(zflag == 1) bmez_put(&bmez, bmes->ts, &bmes->bmed);
+   if(pushflag == 1) push_put(&bmpu, bmes->ts, &bmes->bmed);
+
+   if((logflag == 1 || zflag == 1) && group_add(&grp)) {
+      if(logflag == 1) log_commit(&blog);
+      if(zflag == 1) bmez_commit(&bmez);
+      group_done(&grp);
+   }
+}
+
+/* ------------------------------------------------------------ *
+ * sig_stop() ends the -c loop so that open outputs get flushed *
+ * ------------------------------------------------------------ */
+void sig_stop(int sig) {
+   stopflag = 1;
+}
+
 /* ------------------------------------------------------------ *
  * parseargs() checks the commandline arguments with C getopt   *
  * ------------------------------------------------------------ */
 void parseargs(int argc, char* argv[]) {
    int arg;
+   char *end;
    opterr = 0;
 
    if(argc == 1) { usage(); exit(-1); }
 
-   while ((arg = (int) getopt (argc, argv, "a:b:cdf:im:p:rs:to:hv")) != -1) {
+   while ((arg = (int) getopt (argc, argv, "a:b:cde:f:il:m:p:rs:to:x:z:A:F:G:I:K:L:NP:Q:R:S:U:hv")) != -1) {
       switch (arg) {
          // arg -v verbose, type: flag, optional
          case 'v':
@@ -127,6 +384,16 @@ void parseargs(int argc, char* argv[]) {
             argflag = 1;
             break;
 
+         // arg -e + station elevation in m, type: float
+         case 'e':
+            if(verbose == 1) printf("Debug: arg -e, value %s\n", optarg);
+            elevation = strtof(optarg, &end);
+            if(*end != '\0' || elevation < -500 || elevation > 9000) {
+               printf("Error: invalid station elevation %s.\n", optarg);
+               exit(-1);
+            }
+            break;
+
          // arg -f + IIR filter mode, type: string off,2,4,8, or 16
          case 'f':
             if(verbose == 1) printf("Debug: arg -f, value %s\n", optarg);
@@ -172,6 +439,16 @@ void parseargs(int argc, char* argv[]) {
             strncpy(pwr_mode, optarg, sizeof(pwr_mode));
             break;
 
+         // arg -P sets a datasheet preset, type: string
+         case 'P':
+            if(verbose == 1) printf("Debug: arg -P, value %s\n", optarg);
+            if (strlen(optarg) >= sizeof(preset)) {
+               printf("Error: preset argument to long.\n");
+               exit(-1);
+            }
+            strncpy(preset, optarg, sizeof(preset));
+            break;
+
          // arg -r
          // optional, resets sensor
          case 'r':
@@ -201,6 +478,91 @@ void parseargs(int argc, char* argv[]) {
             argflag = 5;
             break;
 
+         // arg -A adaptive sampling, type: string, requires -c
+         case 'A':
+            adaptflag = 1;
+            if(verbose == 1) printf("Debug: arg -A, value %s\n", optarg);
+            if (strlen(optarg) >= sizeof(adapt_spec)) {
+               printf("Error: adaptive sampling argument to long.\n");
+               exit(-1);
+            }
+            strncpy(adapt_spec, optarg, sizeof(adapt_spec));
+            break;
+
+         // arg -F software filter chain, type: string, requires -c
+         case 'F':
+            filterflag = 1;
+            if(verbose == 1) printf("Debug: arg -F, value %s\n", optarg);
+            if (strlen(optarg) >= sizeof(filter_spec)) {
+               printf("Error: filter argument to long.\n");
+               exit(-1);
+            }
+            strncpy(filter_spec, optarg, sizeof(filter_spec));
+            break;
+
+         // arg -Q queue policy and size, type: string, requires -c
+         case 'Q':
+            if(verbose == 1) printf("Debug: arg -Q, value %s\n", optarg);
+            if(strncmp(optarg, "drop", 4) == 0) qpolicy = BMEQ_DROP;
+            else if(strncmp(optarg, "block", 5) == 0) qpolicy = BMEQ_BLOCK;
+            else {
+               printf("Error: invalid queue policy %s.\n", optarg);
+               exit(-1);
+            }
+            end = strchr(optarg, ':');
+            if(end != NULL) qsize = atoi(end+1);
+            if(qsize < 1 || qsize > 1048576) {
+               printf("Error: invalid queue size %s.\n", optarg);
+               exit(-1);
+            }
+            break;
+
+         // arg -S control socket path, type: string, requires -c
+         case 'S':
+            ctlflag = 1;
+            if(verbose == 1) printf("Debug: arg -S, value %s\n", optarg);
+            if (strlen(optarg) >= sizeof(ctlpath)) {
+               printf("Error: control socket argument to long.\n");
+               exit(-1);
+            }
+            strncpy(ctlpath, optarg, sizeof(ctlpath));
+            break;
+
+         // arg -R event rule file, type: string, requires -c
+         case 'R':
+            ruleflag = 1;
+            if(verbose == 1) printf("Debug: arg -R, value %s\n", optarg);
+            if (strlen(optarg) >= sizeof(rulefile)) {
+               printf("Error: rule file argument to long.\n");
+               exit(-1);
+            }
+            strncpy(rulefile, optarg, sizeof(rulefile));
+            break;
+
+         // arg -L bus lock timeout, type: string ms[:dir]
+         // example: 500:/run/lock
+         case 'L':
+            lockflag = 1;
+            if(verbose == 1) printf("Debug: arg -L, value %s\n", optarg);
+            if (strlen(optarg) >= sizeof(lock_spec)) {
+               printf("Error: lock argument to long.\n");
+               exit(-1);
+            }
+            strncpy(lock_spec, optarg, sizeof(lock_spec));
+            break;
+
+         // arg -U datagram push destination, type: string, requires -c
+         // example: udp:collector:5280,id=17,window=60
+         case 'U':
+            pushflag = 1;
+            if(verbose == 1) printf("Debug: arg -U, value %s\n", optarg);
+            if (strlen(optarg) >= sizeof(push_spec)) {
+               printf("Error: push destination argument to long.\n");
+               exit(-1);
+            }
+            strncpy(push_spec, optarg, sizeof(push_spec));
+            break;
+
          // arg -o + dst HTML file, type: string, requires -t
          // writes the sensor output to file. example: /tmp/sensor.htm
          case 'o':
@@ -213,6 +575,77 @@ void parseargs(int argc, char* argv[]) {
             strncpy(htmfile, optarg, sizeof(htmfile));
             break;
 
+         // arg -x derived values, type: string precise or fast
+         case 'x':
+            if(verbose == 1) printf("Debug: arg -x, value %s\n", optarg);
+            if(strcmp(optarg, "precise") == 0) deriveflag = 1;
+            else if(strcmp(optarg, "fast") == 0) deriveflag = 2;
+            else {
+               printf("Error: invalid derived value mode %s.\n", optarg);
+               exit(-1);
+            }
+            break;
+
+         // arg -N read time stamps in the output, type: flag
+         case 'N':
+            stampflag = 1; break;
+
+         // arg -I IIO device, type: string
+         // example: /sys/bus/iio/devices/iio:device0,trigger=hrtimer0
+         case 'I':
+            iioflag = 1;
+            if(verbose == 1) printf("Debug: arg -I, value %s\n", optarg);
+            if (strlen(optarg) >= sizeof(iio_spec)) {
+               printf("Error: IIO device argument to long.\n");
+               exit(-1);
+            }
+            strncpy(iio_spec, optarg, sizeof(iio_spec));
+            break;
+
+         // arg -K compensation version, type: string
+         case 'K':
+            if(verbose == 1) printf("Debug: arg -K, value %s\n", optarg);
+            if(get_comp(optarg) == NULL) {
+               printf("Error: invalid compensation version %s.\n", optarg);
+               exit(-1);
+            }
+            compensate = get_comp(optarg)->func;
+            break;
+
+         // arg -z + dst store file, type: string, requires -t/-c
+         // appends raw samples compressed. example: /var/log/bme280.bmez
+         case 'z':
+            zflag = 1;
+            if(verbose == 1) printf("Debug: arg -z, value %s\n", optarg);
+            if (strlen(optarg) >= sizeof(zfile)) {
+               printf("Error: store file argument to long.\n");
+               exit(-1);
+            }
+            strncpy(zfile, optarg, sizeof(zfile));
+            break;
+
+         // arg -l + dst log file, type: string, requires -t/-c
+         // appends the output lines. example: /var/log/bme280.log
+         case 'l':
+            logflag = 1;
+            if(verbose == 1) printf("Debug: arg -l, value %s\n", optarg);
+            if (strlen(optarg) >= sizeof(logfile)) {
+               printf("Error: log file argument to long.\n");
+               exit(-1);
+            }
+            strncpy(logfile, optarg, sizeof(logfile));
+            break;
+
+         // arg -G group commit count:seconds[:sync], type: string
+         case 'G':
+            if(verbose == 1) printf("Debug: arg -G, value %s\n", optarg);
+            if (strlen(optarg) >= sizeof(group_spec)) {
+               printf("Error: group commit argument to long.\n");
+               exit(-1);
+            }
+            strncpy(group_spec, optarg, sizeof(group_spec));
+            break;
+
          // arg -h usage, type: flag, optional
          case 'h':
             usage(); exit(0);
@@ -237,10 +670,48 @@ void parseargs(int argc, char* argv[]) {
 int main(int argc, char *argv[]) {
    int res = -1;       // res = function retcode: 0=OK, -1 = Error
 
+   /* ---------------------------------------------------------- *
+    * "query" subcommand works on sample logs, no sensor needed  *
+    * ---------------------------------------------------------- */
+   if(argc > 1 && strcmp(argv[1], "query") == 0) {
+      res = bme_query(argc-1, &argv[1]);
+      exit(res);
+   }
+   if(argc > 1 && strcmp(argv[1], "listen") == 0) {
+      res = bme_listen(argc-1, &argv[1]);
+      exit(res);
+   }
+   if(argc > 1 && strcmp(argv[1], "reprocess") == 0) {
+      res = bme_reproc(argc-1, &argv[1]);
+      exit(res);
+   }
+   if(argc > 1 && strcmp(argv[1], "tune") == 0) {
+      res = bme_tune(argc-1, &argv[1]);
+      exit(res);
+   }
+   if(argc > 1 && strcmp(argv[1], "sweep") == 0) {
+      res = bme_sweep(argc-1, &argv[1]);
+      exit(res);
+   }
+
    /* ---------------------------------------------------------- *
     * Process the cmdline parameters                             *
     * ---------------------------------------------------------- */
    parseargs(argc, argv);
+   if(group_init(&grp, group_spec) != 0) exit(-1);
+   if(ctlflag == 1 && argflag != 5) {
+      printf("Error: -S requires -c.\n");
+      exit(-1);
+   }
+   if(pushflag == 1 && argflag != 5) {
+      printf("Error: -U requires -c.\n");
+      exit(-1);
+   }
+   if(ruleflag == 1 && argflag != 5) {
+      printf("Error: -R requires -c.\n");
+      exit(-1);
+   }
+   if(lockflag == 1 && lock_init(lock_spec) != 0) exit(-1);
 
    /* ----------------------------------------------------------- *
     * get current time (now), write program start if verbose      *
@@ -251,16 +722,38 @@ int main(int argc, char *argv[]) {
    /* ----------------------------------------------------------- *
     * "-a" open the I2C bus and connect to the sensor i2c address *
     * ----------------------------------------------------------- */
-   get_i2cbus(i2c_bus, senaddr);
+   if(iioflag == 1) {
+      /* -------------------------------------------------------- *
+       * "-I" reads through the IIO driver, it counts as one      *
+       * sensor. No raw data and no register access.              *
+       * -------------------------------------------------------- */
+      if(zflag == 1 || adaptflag == 1 || ctlflag == 1 || lockflag == 1 || argflag == 1 || argflag == 3
+         || strlen(preset) > 0 || strlen(iir_mode) > 0 || strlen(pwr_mode) > 0
+         || strlen(stby_time) > 0) {
+         printf("Error: -I supports -i, -m, -t and -c, without -z, -A, -S and -L.\n");
+         exit(-1);
+      }
+      if(iio_open(&bmeio, iio_spec, argflag == 5) != 0) exit(-1);
+      nsensors = 1;
+   }
+   else get_i2cbus(i2c_bus, senaddr);
+   if(nsensors > 1 && (argflag == 5 || outflag == 1 || zflag == 1)) {
+      printf("Error: -c, -o and -z support one sensor, -b lists %d.\n", nsensors);
+      exit(-1);
+   }
 
    /* ----------------------------------------------------------- *
     *  "-d" dump the register map content and exit the program    *
     * ----------------------------------------------------------- */
     if(argflag == 1) {
-      res = bme_dump();
-      if(res != 0) {
-         printf("Error: could not dump the register maps.\n");
-         exit(-1);
+      for(int s = 0; s < nsensors; s++) {
+         if(sensor_select(&sensors[s]) != 0) exit(-1);
+         if(nsensors > 1) printf("Sensor %s:\n", sensors[s].spec);
+         res = bme_dump();
+         if(res != 0) {
+            printf("Error: could not dump the register maps.\n");
+            exit(-1);
+         }
       }
       exit(0);
    }
@@ -268,43 +761,56 @@ int main(int argc, char *argv[]) {
    /* ----------------------------------------------------------- *
     *  "-i" print sensor information and exit the program         *
     * ----------------------------------------------------------- */
-    if(argflag == 2) {
-      struct bmeinf bmei = {0};
-      struct bmecal bmec = {0};
-      bme_info(&bmei);
-      get_calib(&bmec);
-
-      /* ----------------------------------------------------------- *
-       * print the formatted output strings to stdout                *
-       * ----------------------------------------------------------- */
+    if(argflag == 2 && iioflag == 1) {
       printf("----------------------------------------------\n");
       printf("BME280 Information at %s", ctime(&tsnow));
       printf("----------------------------------------------\n");
-      printf("    Sensor Chip ID = 0x%02X ", bmei.chip_id);
-      if(bmei.chip_id == 0x60) printf("BME280\n");
-      else if(bmei.chip_id == 0x58) printf("BMP280\n");
-      else if(bmei.chip_id == 0x56) printf("BMP280 Sample\n");
-      else if(bmei.chip_id == 0x57) printf("BMP280\n");
-      else printf("ChipID unknown\n");
-      printf("     Humidity Mode = "); print_osrs(bmei.osrs_h_mode);
-      printf("     Pressure Mode = "); print_osrs(bmei.osrs_p_mode);
-      printf("  Temperature Mode = "); print_osrs(bmei.osrs_t_mode);
-      printf("      Standby Time = "); print_stby(bmei.stby_time);
-      printf("   IIR Filter Mode = "); print_filter(bmei.filter_mode);
-      printf("   3-wire SPI Mode = "); print_spi3we(bmei.spi3we_mode);
-      printf("        Power Mode = "); print_power(bmei.power_mode);
-      printf(" Temperature Coeff = T1:%6d T2:%6d T3:%5d\n",
-             bmec.dig_T1, bmec.dig_T2, bmec.dig_T3);
-      printf("    Pressure Coeff = P1:%6d P2:%6d P3:%5d\n",
-             bmec.dig_P1, bmec.dig_P2, bmec.dig_P3);
-      printf("                     P4:%6d P5:%6d P6:%5d\n",
-             bmec.dig_P4, bmec.dig_P5, bmec.dig_P6);
-      printf("                     P7:%6d P8:%6d P9:%5d\n",
-             bmec.dig_P7, bmec.dig_P8, bmec.dig_P9);
-      printf("    Humidity Coeff = H1:%6d H2:%6d H3:%5d\n",
-             bmec.dig_H1, bmec.dig_H2, bmec.dig_H3);
-      printf("                     H4:%6d H5:%6d H6:%5d\n",
-             bmec.dig_H4, bmec.dig_H5, bmec.dig_H6);
+      iio_info(&bmeio);
+      exit(0);
+   }
+    if(argflag == 2) {
+      for(int s = 0; s < nsensors; s++) {
+         struct bmeinf bmei = {0};
+         struct bmecal bmec = {0};
+         if(sensor_select(&sensors[s]) != 0) exit(-1);
+         bme_info(&bmei);
+         get_calib(&bmec);
+
+         /* -------------------------------------------------------- *
+          * print the formatted output strings to stdout             *
+          * -------------------------------------------------------- */
+         printf("----------------------------------------------\n");
+         printf("BME280 Information at %s", ctime(&tsnow));
+         printf("----------------------------------------------\n");
+         if(nsensors > 1) printf("            Sensor = %s\n", sensors[s].spec);
+         printf("    Sensor Chip ID = 0x%02X %s\n", bmei.chip_id, bmep->name);
+         if(bmep->humidity == 1) {
+            printf("     Humidity Mode = "); print_osrs(bmei.osrs_h_mode);
+         }
+         printf("     Pressure Mode = "); print_osrs(bmei.osrs_p_mode);
+         printf("  Temperature Mode = "); print_osrs(bmei.osrs_t_mode);
+         printf("      Standby Time = "); print_stby(bmei.stby_time);
+         printf("   IIR Filter Mode = "); print_filter(bmei.filter_mode);
+         printf("   3-wire SPI Mode = "); print_spi3we(bmei.spi3we_mode);
+         printf("        Power Mode = "); print_power(bmei.power_mode);
+         struct bmetime bmet;
+         bme_timing(&bmei, 1.0, &bmet);
+         print_timing(&bmet);
+         printf(" Temperature Coeff = T1:%6d T2:%6d T3:%5d\n",
+                bmec.dig_T1, bmec.dig_T2, bmec.dig_T3);
+         printf("    Pressure Coeff = P1:%6d P2:%6d P3:%5d\n",
+                bmec.dig_P1, bmec.dig_P2, bmec.dig_P3);
+         printf("                     P4:%6d P5:%6d P6:%5d\n",
+                bmec.dig_P4, bmec.dig_P5, bmec.dig_P6);
+         printf("                     P7:%6d P8:%6d P9:%5d\n",
+                bmec.dig_P7, bmec.dig_P8, bmec.dig_P9);
+         if(bmep->humidity == 1) {
+            printf("    Humidity Coeff = H1:%6d H2:%6d H3:%5d\n",
+                   bmec.dig_H1, bmec.dig_H2, bmec.dig_H3);
+            printf("                     H4:%6d H5:%6d H6:%5d\n",
+                   bmec.dig_H4, bmec.dig_H5, bmec.dig_H6);
+         }
+      }
       exit(0);
    }
 
@@ -312,11 +818,41 @@ int main(int argc, char *argv[]) {
     *  "-r" reset the sensor and exit the program                 *
     * ----------------------------------------------------------- */
     if(argflag == 3) {
-      res = bme_reset();
-      if(res != 0) {
-         printf("Error: could not reset the sensor.\n");
+      for(int s = 0; s < nsensors; s++) {
+         if(sensor_select(&sensors[s]) != 0) exit(-1);
+         res = bme_reset();
+         if(res != 0) {
+            printf("Error: could not reset the sensor.\n");
+            exit(-1);
+         }
+      }
+      exit(0);
+   }
+
+   /* ----------------------------------------------------------- *
+    *  "-P" apply a preset, print the resulting timing and exit   *
+    * ----------------------------------------------------------- */
+   if(strlen(preset) > 0) {
+      struct bmepreset *bmpr = get_preset(preset);
+      if(bmpr == NULL) {
+         printf("Error: unknown preset %s.\n", preset);
          exit(-1);
       }
+      for(int s = 0; s < nsensors; s++) {
+         if(sensor_select(&sensors[s]) != 0) exit(-1);
+         if(set_preset(bmpr) != 0) {
+            printf("Error: could not apply preset %s.\n", preset);
+            exit(-1);
+         }
+
+         struct bmeinf bmei;
+         struct bmetime bmet;
+         if(bme_snapshot(&bmei) != 0) exit(-1);
+         bme_timing(&bmei, bmpr->rate, &bmet);
+         if(nsensors > 1) printf("Sensor %s: ", sensors[s].spec);
+         printf("Preset %s applied:\n", bmpr->name);
+         print_timing(&bmet);
+      }
       exit(0);
    }
 
@@ -324,11 +860,14 @@ int main(int argc, char *argv[]) {
     *  "-f" set the sensor IIR filter mode and exit the program   *
     * ----------------------------------------------------------- */
    if(strlen(iir_mode) > 0) {
-      res = set_filter(iir_mode);
+      for(int s = 0; s < nsensors; s++) {
+         if(sensor_select(&sensors[s]) != 0) exit(-1);
+         res = set_filter(iir_mode);
 
-      if(res != 0) {
-         printf("Error: could not set IIR filter mode [%s].\n", iir_mode);
-         exit(-1);
+         if(res != 0) {
+            printf("Error: could not set IIR filter mode [%s].\n", iir_mode);
+            exit(-1);
+         }
       }
       exit(0);
    }
@@ -336,19 +875,29 @@ int main(int argc, char *argv[]) {
    /* ----------------------------------------------------------- *
     *  "-m" set the sensor oversampling mode and exit the program *
     * ----------------------------------------------------------- */
+   if(strlen(osrs_mode) > 0 && iioflag == 1) {
+      if(iio_osrs(&bmeio, osrs_mode) != 0) {
+         printf("Error: could not set oversampling mode [%s].\n", osrs_mode);
+         exit(-1);
+      }
+      exit(0);
+   }
    if(strlen(osrs_mode) > 0) {
-      char type = osrs_mode[0];
+      for(int s = 0; s < nsensors; s++) {
+         if(sensor_select(&sensors[s]) != 0) exit(-1);
+         char type = osrs_mode[0];
 
-      if(verbose == 1) printf("Debug: Measuring type: [%c]\n", type);
-      if(verbose == 1) printf("Debug: Set osrs value: [%s]\n", &osrs_mode[2]);
+         if(verbose == 1) printf("Debug: Measuring type: [%c]\n", type);
+         if(verbose == 1) printf("Debug: Set osrs value: [%s]\n", &osrs_mode[2]);
 
-      if(type == 't') res = set_t_osrs(&osrs_mode[2]);
-      if(type == 'h') res = set_h_osrs(&osrs_mode[2]);
-      if(type == 'p') res = set_p_osrs(&osrs_mode[2]);
+         if(type == 't') res = set_t_osrs(&osrs_mode[2]);
+         if(type == 'h') res = set_h_osrs(&osrs_mode[2]);
+         if(type == 'p') res = set_p_osrs(&osrs_mode[2]);
 
-      if(res != 0) {
-         printf("Error: could not set oversampling mode [%s].\n", osrs_mode);
-         exit(-1);
+         if(res != 0) {
+            printf("Error: could not set oversampling mode [%s].\n", osrs_mode);
+            exit(-1);
+         }
       }
       exit(0);
    }
@@ -357,19 +906,22 @@ int main(int argc, char *argv[]) {
     *  "-p" set the sensor power mode and exit the program        *
     * ----------------------------------------------------------- */
    if(strlen(pwr_mode) > 0) {
-      power_t newmode;
-      if(strcmp(pwr_mode, "normal")   == 0)     newmode = normal;
-      else if(strcmp(pwr_mode, "forced")  == 0) newmode = forced;
-      else if(strcmp(pwr_mode, "sleep")  == 0)  newmode = psleep;
-      else {
-         printf("Error: invalid power mode %s.\n", pwr_mode);
-         exit(-1);
-      }
+      for(int s = 0; s < nsensors; s++) {
+         if(sensor_select(&sensors[s]) != 0) exit(-1);
+         power_t newmode;
+         if(strcmp(pwr_mode, "normal")   == 0)     newmode = normal;
+         else if(strcmp(pwr_mode, "forced")  == 0) newmode = forced;
+         else if(strcmp(pwr_mode, "sleep")  == 0)  newmode = psleep;
+         else {
+            printf("Error: invalid power mode %s.\n", pwr_mode);
+            exit(-1);
+         }
 
-      res = set_power(newmode);
-      if(res != 0) {
-         printf("Error: could not set power mode %s [0x%02X].\n", pwr_mode, newmode);
-         exit(-1);
+         res = set_power(newmode);
+         if(res != 0) {
+            printf("Error: could not set power mode %s [0x%02X].\n", pwr_mode, newmode);
+            exit(-1);
+         }
       }
       exit(0);
    }
@@ -377,56 +929,55 @@ int main(int argc, char *argv[]) {
     *  "-s" set the sensor standby time and exit the program      *
     * ----------------------------------------------------------- */
    if(strlen(stby_time) > 0) {
-      res = set_stby(stby_time);
+      for(int s = 0; s < nsensors; s++) {
+         if(sensor_select(&sensors[s]) != 0) exit(-1);
+         res = set_stby(stby_time);
 
-      if(res != 0) {
-         printf("Error: could not set standby time %s.\n", stby_time);
-         exit(-1);
+         if(res != 0) {
+            printf("Error: could not set standby time %s.\n", stby_time);
+            exit(-1);
+         }
       }
       exit(0);
    }
    /* ----------------------------------------------------------- *
     *  "-t" reads, calculates and prints compensated sensor data  *
+    *  of each sensor in the -b list. All sensors convert at the  *
+    *  same time, see batch_bme280.c.                             *
     * ----------------------------------------------------------- */
    if(argflag == 4) {
-      struct bmecal bmec;
-      struct bmedata bmed;
-      get_calib(&bmec);
-
-      /* -------------------------------------------------------- *
-       * If power mode SLEEP, set power mode FORCED to read once, *
-       * and then wait 15-120ms for the measurement to complete.  *
-       * -------------------------------------------------------- */
-      if(get_power() == 0x0) res = set_power(forced);
-      usleep(120 * 1000); // set max 120ms, needed for 16x osrs
+      static struct bmecal bmec[SENSOR_MAX];
+      static struct bmedata bmed[SENSOR_MAX];
+      if(iioflag == 1) {
+         if(iio_read(&bmeio, &bmed[0]) != 0) exit(-1);
+      }
+      else if(bme_batch(sensors, nsensors, bmec, bmed) != 0) exit(-1);
 
-      get_data(&bmec, &bmed);
+      if(logflag == 1 && log_open(&blog, logfile, grp.sync) != 0) exit(-1);
+      for(int s = 0; s < nsensors; s++) {
+         char line[384];
+         int len = format_data(line, sizeof(line), STAMP_SEC(bmed[s].st), &bmed[s],
+                               nsensors > 1 ? sensors[s].spec : NULL);
+         fputs(line, stdout);
+         if(outflag == 1) write_html(&bmed[s]);
 
-      /* ----------------------------------------------------------- *
-       * print the formatted output string to stdout (Example below) *
-       * 1584280335 Temp=22.76*C Humidity=22.30% Pressure=1002.56hPa *
-       * ----------------------------------------------------------- */
-         printf("%lld Temp=%3.2f*C Humidity=%3.2f%% Pressure=%3.2fhPa\n", 
-                (long long) tsnow, bmed.temp_c, bmed.humi_p, bmed.pres_p/100);
+         /* ----------------------------------------------------- *
+          *  Append the output line to the log file               *
+          * ----------------------------------------------------- */
+         if(logflag == 1) log_put(&blog, line, len);
 
-      if(outflag == 1) {
-         /* -------------------------------------------------------- *
-          *  Open the html file for writing accelerometer data       *
-          * -------------------------------------------------------- */
-         FILE *html;
-         if(! (html=fopen(htmfile, "w"))) {
-            printf("Error open %s for writing.\n", htmfile);
-            exit(-1);
+         if(zflag == 1) {
+            /* --------------------------------------------------- *
+             *  Append the raw sample to the compressed store file *
+             * --------------------------------------------------- */
+            if(bmez_open(&bmez, zfile, &bmec[s]) != 0) exit(-1);
+            bmez.sync = grp.sync;
+            bmez_put(&bmez, STAMP_SEC(bmed[s].st), &bmed[s]);
+            if(bmez_close(&bmez) != 0) exit(-1);
          }
-         fprintf(html, "<table><tr>\n");
-         fprintf(html, "<td class=\"sensordata\">Temperature:<span class=\"sensorvalue\">%3.2f</span></td>\n", bmed.temp_c);
-         fprintf(html, "<td class=\"sensorspace\"></td>\n");
-         fprintf(html, "<td class=\"sensordata\">Humidity:<span class=\"sensorvalue\">%3.2f</span></td>\n", bmed.humi_p);
-         fprintf(html, "<td class=\"sensorspace\"></td>\n");
-         fprintf(html, "<td class=\"sensordata\">Pressure:<span class=\"sensorvalue\">%3.2f</span></td>\n", bmed.pres_p);
-         fprintf(html, "</tr></table>\n");
-         fclose(html);
       }
+      if(logflag == 1 && log_close(&blog) != 0) exit(-1);
+      if(verbose == 1) printf("Debug: Mux channel writes: [%ld]\n", mux_writes);
       exit(0);
    } /* End reading sensor data */
 
@@ -437,42 +988,87 @@ int main(int argc, char *argv[]) {
    if(argflag == 5) {
       struct bmecal bmec;
       struct bmedata bmed;
-      get_calib(&bmec);
+      static struct bmeadapt bmea;
 
       /* -------------------------------------------------------- *
        * If power mode != NORMAL, set NORMAL for continuous reads *
+       * With -A, the adaptive controller manages the power mode. *
+       * The IIO driver runs its own forced conversions.          *
        * -------------------------------------------------------- */
-      if(get_power() != 0x3) res = set_power(normal);
-
-      while(1){
-         time_t tsnow = time(NULL);
-         get_data(&bmec, &bmed);
-   
-         /* ----------------------------------------------------------- *
-          * print the formatted output string to stdout (Example below) *
-          * ----------------------------------------------------------- */
-         printf("%lld Temp=%3.2f*C Humidity=%3.2f%% Pressure=%3.2fhPa\n", 
-                (long long) tsnow, bmed.temp_c, bmed.humi_p, bmed.pres_p/100);
-   
-         if(outflag == 1) {
-            /* -------------------------------------------------------- *
-             *  Open the html file for writing accelerometer data       *
-             * -------------------------------------------------------- */
-            FILE *html;
-            if(! (html=fopen(htmfile, "w"))) {
-               printf("Error open %s for writing.\n", htmfile);
-               exit(-1);
+      if(iioflag == 0) {
+         get_calib(&bmec);
+         struct bmeinf bmei;
+         if(bme_snapshot(&bmei) != 0) exit(-1);
+         if(adaptflag == 1) {
+            if(adapt_init(&bmea, adapt_spec) != 0) exit(-1);
+         }
+         else if(bmei.power_mode != 0x3) res = set_power(normal);
+      }
+
+      static struct bmefilter bmef;
+      if(filterflag == 1 && filter_init(&bmef, filter_spec) != 0) exit(-1);
+
+      /* -------------------------------------------------------- *
+       * Open the file outputs, SIGINT/SIGTERM end the loop clean *
+       * -------------------------------------------------------- */
+      if(logflag == 1 && log_open(&blog, logfile, grp.sync) != 0) exit(-1);
+      if(zflag == 1 && bmez_open(&bmez, zfile, &bmec) != 0) exit(-1);
+      if(pushflag == 1 && push_open(&bmpu, push_spec) != 0) exit(-1);
+      if(ruleflag == 1 && rule_open(&bmer, rulefile) != 0) exit(-1);
+      bmez.sync = grp.sync;
+      signal(SIGINT, sig_stop);
+      signal(SIGTERM, sig_stop);
+
+      /* -------------------------------------------------------- *
+       * The output thread writes the queued samples, the loop    *
+       * below only reads the sensor                              *
+       * -------------------------------------------------------- */
+      struct bmeq *q = bmeq_create(qsize, qpolicy);
+      if(q == NULL || sink_start(q, sink_out) != 0) exit(-1);
+
+      /* -------------------------------------------------------- *
+       * Settings changes arrive on the control socket, and are   *
+       * applied between two samples                              *
+       * -------------------------------------------------------- */
+      int ctlfd = -1;
+      if(ctlflag == 1 && (ctlfd = ctl_open(ctlpath)) < 0) exit(-1);
+
+      /* -------------------------------------------------------- *
+       * With -L, each sample is one lock group, a sample that    *
+       * times out on the bus lock is skipped                     *
+       * -------------------------------------------------------- */
+      bus_unlock();
+      int readfail = 0; // a failed read ends the loop, exit -1 after the flush
+      while(stopflag == 0){
+         struct bmesample bmes;
+         if(bus_lock() == 0) {
+            if(adaptflag == 1) adapt_trigger(&bmea);
+            if(iioflag == 1) {
+               if(iio_read(&bmeio, &bmed) != 0) { readfail = 1; break; }
             }
-            fprintf(html, "<table><tr>\n");
-            fprintf(html, "<td class=\"sensordata\">Temperature:<span class=\"sensorvalue\">%3.2f</span></td>\n", bmed.temp_c);
-            fprintf(html, "<td class=\"sensorspace\"></td>\n");
-            fprintf(html, "<td class=\"sensordata\">Humidity:<span class=\"sensorvalue\">%3.2f</span></td>\n", bmed.humi_p);
-            fprintf(html, "<td class=\"sensorspace\"></td>\n");
-            fprintf(html, "<td class=\"sensordata\">Pressure:<span class=\"sensorvalue\">%3.2f</span></td>\n", bmed.pres_p);
-            fprintf(html, "</tr></table>\n");
-            fclose(html);
+            else get_data(&bmec, &bmed);
+            bmes.bmed = bmed;
+            bmes.ts = STAMP_SEC(bmed.st);
+            if(filterflag == 1) filter_apply(&bmef, &bmes.bmed);
+            bmeq_push(q, &bmes);
+            if(ctlfd >= 0) ctl_poll(ctlfd, adaptflag ? 1000.0 / adapt_interval(&bmea) : 1.0);
+            if(adaptflag == 1) adapt_update(&bmea, &bmed);
+            bus_unlock();
          }
-         sleep(1);
+
+         if(adaptflag == 1) usleep(adapt_interval(&bmea) * 1000);
+         else if(iioflag == 0 || bmeio.fd < 0) sleep(1);
       }
+      sink_stop(q);
+      if(ctlfd >= 0) ctl_close(ctlfd, ctlpath);
+      if(logflag == 1 && log_close(&blog) != 0) exit(-1);
+      if(zflag == 1 && bmez_close(&bmez) != 0) exit(-1);
+      if(pushflag == 1) push_close(&bmpu);
+      if(ruleflag == 1) rule_close(&bmer);
+      group_done(&grp);
+      if(verbose == 1) printf("Debug: Group commits: [%ld]\n", grp.commits);
+      if(iioflag == 1) iio_close(&bmeio);
+      if(readfail == 1) exit(-1);
+      exit(0);
    } /* End reading continuous data */
 }
@@ -86,11 +86,52 @@
 #define BME280_CALIB_40_ADDR         0xEF
 #define BME280_CALIB_41_ADDR         0xF0
 
+/* ------------------------------------------------------------ *
+ * Derived quantities computed from struct bmedata              *
+ * ------------------------------------------------------------ */
+struct bmederiv{
+   float dewp_c;   // dew point in degrees Celsius
+   float abshum;   // absolute humidity in g/m3
+   float alti_m;   // barometric altitude in m, standard atmosphere
+   float qnh_p;    // sea-level pressure (QNH) in Pascal
+};
+
+/* ------------------------------------------------------------ *
+ * Sensor variant driver profile, selected by chip id at start. *
+ * BMP280 parts have no humidity, and only 6 data bytes.        *
+ * ------------------------------------------------------------ */
+struct bmeprof{
+   char chip_id;     // reg 0xD0 chip id of this variant
+   char *name;       // variant name for the -i output
+   int humidity;     // 1 = has humidity registers and calibration
+   int datalen;      // burst read length starting at reg 0xF7
+};
+
+/* ------------------------------------------------------------ *
+ * The sensor outputs these values for skipped measurements.    *
+ * They are also real readings, so bmedata.skip, not the value, *
+ * tells a skipped channel. Only the store has no skip flags.   *
+ * ------------------------------------------------------------ */
+#define ADC_T_SKIPPED   0x80000  // adc_t value if temperature is skipped
+#define ADC_P_SKIPPED   0x80000  // adc_p value if pressure is skipped
+#define ADC_H_SKIPPED    0x8000  // adc_h value if no humidity data
+
+/* ------------------------------------------------------------ *
+ * Enabled measurements (osrs != skip), get_data() reads only   *
+ * the data registers of these channels                         *
+ * ------------------------------------------------------------ */
+#define CHAN_T             0x01  // temperature, 0xFA..0xFC
+#define CHAN_P             0x02  // pressure, 0xF7..0xF9
+#define CHAN_H             0x04  // humidity, 0xFD..0xFE
+#define CHAN_ALL           0x07
+
 /* ------------------------------------------------------------ *
  * global variables                                             *
  * ------------------------------------------------------------ */
 extern int i2cfd;       // I2C file descriptor
 extern int verbose;     // debug flag, 0 = normal, 1 = debug mode
+extern struct bmeprof *bmep; // driver profile of the sensor
+extern int *bmechans;   // enabled channels CHAN_* of the sensor
 
 /* ------------------------------------------------------------ *
  * BME280 version, status and control data structure            *
@@ -98,6 +139,7 @@ extern int verbose;     // debug flag, 0 = normal, 1 = debug mode
 struct bmeinf{
    char chip_id;     // reg 0xD0 returns 0x60 for type BME280
    char osrs_h_mode; // reg 0xF2 hum oversampling 2-0 bit 6x values
+   char status;      // reg 0xF3 bit 3 = measuring, bit 0 = NVM copy
    char osrs_t_mode; // reg 0xF4 default 0x08 oversampling temp
    char osrs_p_mode; // reg 0xF4 default 0x08 oversampling press
    char power_mode;  // reg 0xF4, 0 = psleep, 1 = forced, 2 = forced, 3 = normal
@@ -133,6 +175,20 @@ struct bmecal{
    int8_t   dig_H6;  // Humidity calibr. H6 reg 0xE7
 };
 
+/* ------------------------------------------------------------ *
+ * Time of a data read, taken around the burst read of the data *
+ * registers (stamp_start/stamp_end in i2c_bme280.c)            *
+ * ------------------------------------------------------------ */
+#define STAMP_NS    1000000000LL // ns per second
+#define STAMP_SEC(st) ((time_t) ((st).rt_ns / STAMP_NS)) // epoch seconds
+
+struct bmestamp{
+   int64_t rt_ns;    // CLOCK_REALTIME at the read start in ns
+   int64_t mono_ns;  // CLOCK_MONOTONIC at the read start in ns
+   int32_t lat_ns;   // duration of the read in ns
+   uint32_t seq;     // sample number of the process, from 1
+};
+
 /* ------------------------------------------------------------ *
  * BME280 measurement data struct.                              *
  * ------------------------------------------------------------ */
@@ -141,6 +197,308 @@ struct bmedata{
    float temp_f;   // compensated temperature in degrees Fahrenheit
    float humi_p;   // compensated humidity in percent
    float pres_p;   // compensated pressure in Pascal
+   int32_t adc_t;  // raw temperature value, 20 bit
+   int32_t adc_p;  // raw pressure value, 20 bit
+   int32_t adc_h;  // raw humidity value, 16 bit
+   int skip;       // skipped channels CHAN_*, their adc is ADC_*_SKIPPED
+   struct bmestamp st; // time and number of the read
+};
+
+/* ------------------------------------------------------------ *
+ * Compressed sample store (store_bme280.c). The file header    *
+ * holds the calibration, blocks hold up to BMEZ_BLKSAMPLES raw *
+ * samples as delta-of-delta timestamps and adc delta codes.    *
+ * ------------------------------------------------------------ */
+#define BMEZ_MAGIC       "BMEZ"  // store file magic
+#define BMEZ_VERSION         1   // store file format version
+#define BMEZ_HDRSIZE        48   // file header: magic, version, calib
+#define BMEZ_BLKHDR         36   // block header size
+#define BMEZ_BLKSAMPLES   1024   // max samples per block
+#define BMEZ_BLKBYTES    14336   // max bitstream bytes per block
+
+struct bmezs{        // one stored raw sample
+   int64_t ts;       // timestamp, epoch seconds
+   int32_t adc_t;    // raw temperature value
+   int32_t adc_p;    // raw pressure value
+   int32_t adc_h;    // raw humidity value
+};
+
+struct bmezb{        // decoded block header
+   uint16_t count;   // samples in the block
+   uint32_t nbits;   // bitstream length in bits
+   int64_t first_ts; // timestamp of the first sample
+   int64_t last_ts;  // timestamp of the last sample
+};
+
+struct bmezw{        // store writer state
+   int fd;           // store file descriptor
+   int sync;         // sync policy, SYNC_NONE, SYNC_DATA or SYNC_FULL
+   off_t blkoff;     // file offset of the open block
+   int count;        // samples in the open block
+   uint32_t nbits;   // bitstream length of the open block
+   int64_t first_ts; // first timestamp of the open block
+   int64_t last_delta;  // last timestamp delta
+   struct bmezs last;   // last sample, base for the next delta
+   uint8_t blk[BMEZ_BLKHDR + BMEZ_BLKBYTES]; // open block buffer
+};
+
+/* ------------------------------------------------------------ *
+ * Software filter chain of -c (filter_bme280.c), the channels  *
+ * are 0 = temperature, 1 = humidity, 2 = pressure              *
+ * ------------------------------------------------------------ */
+#define FILT_EMA             1   // exponential moving average
+#define FILT_MEDIAN          2   // rolling median
+#define FILT_KALMAN          3   // scalar Kalman filter
+#define FILT_STAGES          4   // max stages in the chain
+#define FILT_MEDIAN_MAX     31   // max rolling median window
+
+struct bmefstage{    // one filter stage with per-channel state
+   int type;         // FILT_EMA, FILT_MEDIAN or FILT_KALMAN
+   float param;      // ema alpha, or kalman noise variance ratio
+   int n;            // median window size
+   int init[3];      // ema/kalman state is set
+   float y[3];       // ema/kalman output
+   float p[3];       // kalman error variance
+   int pos[3];       // median ring position of the oldest value
+   int fill[3];      // median values in the window
+   float ring[3][FILT_MEDIAN_MAX];   // median window, arrival order
+   float sorted[3][FILT_MEDIAN_MAX]; // median window, sorted
+};
+
+struct bmefilter{
+   int stages;       // number of stages in the chain
+   struct bmefstage st[FILT_STAGES];
+};
+
+/* ------------------------------------------------------------ *
+ * Group commit of the -c file outputs (commit_bme280.c)        *
+ * ------------------------------------------------------------ */
+#define SYNC_NONE            0   // no sync, kernel writes back later
+#define SYNC_DATA            1   // fdatasync() after each group
+#define SYNC_FULL            2   // fsync() after each group
+#define BMELOG_BUFSIZE   16384   // text log group buffer
+
+struct bmegroup{
+   int count;        // commit after this many samples
+   int age;          // or after the oldest is this many seconds old
+   int sync;         // sync policy
+   int pending;      // samples in the open group
+   double since;     // monotonic time of the first pending sample
+   long commits;     // number of group commits
+};
+
+struct bmelog{       // text log writer state
+   int fd;           // log file descriptor, opened O_APPEND
+   int sync;         // sync policy
+   size_t len;       // buffered bytes
+   char buf[BMELOG_BUFSIZE]; // lines of the open group
+};
+
+/* ------------------------------------------------------------ *
+ * Sample queue between the -c sampling loop and the output     *
+ * thread (sink_bme280.c). struct bmeq is private to the queue. *
+ * ------------------------------------------------------------ */
+#define BMEQ_DROP            0   // on overflow, drop the oldest sample
+#define BMEQ_BLOCK           1   // on overflow, wait for the output
+#define BMEQ_SIZE         1024   // default queue size in samples
+
+struct bmesample{    // one queued sample
+   int64_t ts;       // timestamp, epoch seconds
+   struct bmedata bmed; // compensated and raw sensor values
+};
+struct bmeq;
+
+/* ------------------------------------------------------------ *
+ * Datagram push to a collector (push_bme280.c). The datagram   *
+ * has a fixed layout, all fields big-endian.                   *
+ * ------------------------------------------------------------ */
+#define BMED_MAGIC      0xB280   // datagram magic number
+#define BMED_VERSION         2   // datagram layout version
+#define BMED_SIZE           72   // datagram size in bytes
+#define BMED_SIZE_V1        48   // version 1 size, without read stamps
+#define BMED_T            0x01   // flag: temperature is valid
+#define BMED_P            0x02   // flag: pressure is valid
+#define BMED_H            0x04   // flag: humidity is valid
+#define BMED_WINDOW       0x08   // flag: window average of count samples
+
+struct bmedgram{     // one datagram, 72 bytes
+   uint16_t magic;   // BMED_MAGIC
+   uint8_t version;  // BMED_VERSION
+   uint8_t flags;    // BMED_* flags
+   uint32_t id;      // sensor id
+   uint32_t seq;     // sequence number, +1 per datagram
+   uint32_t count;   // samples in the datagram
+   int64_t ts;       // timestamp or window start, epoch seconds
+   int32_t adc_t;    // raw temperature of the last sample
+   int32_t adc_p;    // raw pressure of the last sample
+   int32_t adc_h;    // raw humidity of the last sample
+   int32_t temp;     // temperature in 0.01*C
+   int32_t pres;     // pressure in 0.01Pa
+   int32_t humi;     // humidity in 0.001%
+   int64_t rt_ns;    // v2: read time of the last sample, epoch ns
+   int64_t mono_ns;  // v2: read time of the last sample, monotonic ns
+   int32_t lat_ns;   // v2: I2C or IIO read latency of the last sample
+   uint32_t rseq;    // v2: read sequence number of the last sample
+};
+
+struct bmepush{      // -U push state, used by the sink thread
+   int fd;           // connected datagram socket
+   uint32_t id;      // sensor id
+   uint32_t seq;     // next sequence number
+   int window;       // window in seconds, 0 = every sample
+   int64_t start;    // open window start
+   int count;        // samples in the open window
+   double sum_t;     // window sums of the compensated values
+   double sum_p;
+   double sum_h;
+   struct bmedata last; // last sample, for the raw values
+   long sent;        // datagrams sent
+   long failed;      // datagrams not sent, e.g. socket buffer full
+};
+
+/* ------------------------------------------------------------ *
+ * Bus arbitration between processes, -L (lock_bme280.c)        *
+ * ------------------------------------------------------------ */
+#define LOCK_DIR    "/run/lock"  // default lock file directory
+#define LOCK_TIMEOUT      1000   // default lock timeout in ms
+#define LOCK_QUEUE_MAX      64   // max waiting processes per bus
+#define LOCK_POLL_MIN      100   // first queue poll pause in us
+#define LOCK_POLL_MAX     2000   // max queue poll pause in us
+
+/* ------------------------------------------------------------ *
+ * Event rules of -c -R (rule_bme280.c). A rule is on while its *
+ * channel value, or its rate of change per hour, is past the   *
+ * limit, and off again once it is back by hyst. Only the state *
+ * changes are emitted.                                         *
+ * ------------------------------------------------------------ */
+#define RULE_MAX            32   // max rules in a rule file
+#define RULE_NAMELEN        32   // max rule name length
+#define RULE_WINDOW        600   // default rate window in seconds
+#define RULE_STDOUT          0   // events go to stdout
+#define RULE_SOCKET          1   // events go to a datagram socket
+#define RULE_EXEC            2   // events run a hook command
+
+struct bmerule{
+   char name[RULE_NAMELEN]; // rule name, in the events
+   int chan;         // CHAN_T, CHAN_P or CHAN_H
+   int rate;         // 1 = rate of change per hour
+   float sign;       // +1 for ">", -1 for "<"
+   float limit;      // limit in output units, times sign
+   float hyst;       // hysteresis, >= 0
+   int window;       // rate: window length in seconds
+   int on;           // current state
+   int64_t wstart;   // rate: open window start, 0 = none
+   double sum;       // rate: sum of the open window
+   int n;            // rate: samples in the open window
+   double prev;      // rate: mean of the last window
+   int64_t pstart;   // rate: start of the last window, 0 = none
+};
+
+struct bmerules{
+   int n;            // number of rules
+   int out;          // RULE_STDOUT, RULE_SOCKET or RULE_EXEC
+   int fd;           // RULE_SOCKET: connected datagram socket
+   char cmd[256];    // RULE_EXEC: hook command
+   long events;      // events emitted
+   struct bmerule r[RULE_MAX];
+};
+
+/* ------------------------------------------------------------ *
+ * Adaptive sampling controller state (adapt_bme280.c)          *
+ * ------------------------------------------------------------ */
+#define ADAPT_LOW            0   // low-rate forced mode sampling
+#define ADAPT_HIGH           1   // high-rate normal mode sampling
+#define ADAPT_HISTORY      256   // max samples for the rate of change
+#define ADAPT_SPAN         300   // rate of change window in seconds
+#define ADAPT_HOLD         300   // calm seconds before leaving high-rate
+#define ADAPT_THRES_P      3.0   // default pressure threshold Pa/min
+#define ADAPT_THRES_T      0.2   // default temperature threshold *C/min
+#define ADAPT_THRES_H      1.0   // default humidity threshold %/min
+
+struct bmehist{      // one history sample
+   double ts;        // monotonic time in seconds
+   float t;          // temperature in *C
+   float p;          // pressure in Pa
+   float h;          // humidity in %
+};
+
+struct bmeadapt{
+   int fast_ms;      // sample interval in high-rate mode
+   int slow_ms;      // sample interval in low-rate mode
+   float thres_p;    // pressure rate threshold in Pa/min
+   float thres_t;    // temperature rate threshold in *C/min
+   float thres_h;    // humidity rate threshold in %/min
+   int state;        // ADAPT_LOW or ADAPT_HIGH
+   double calm_since;// last time the activity was above thres/2
+   int fill;         // samples in the history
+   struct bmehist hist[ADAPT_HISTORY];
+};
+
+/* ------------------------------------------------------------ *
+ * Sensor list of "-b" (mux_bme280.c), one entry per sensor     *
+ * ------------------------------------------------------------ */
+#define SENSOR_MAX          64   // max sensors in the -b list
+#define SENSOR_LISTLEN    2048   // max length of the -b list
+
+struct bmesensor{
+   char spec[256];   // sensor spec as given in -b
+   char bus[256];    // I2C bus device
+   int fd;           // bus file descriptor, shared per bus
+   int addr;         // sensor I2C address
+   int mux;          // TCA9548A mux address, -1 = no mux
+   int channel;      // mux channel 0..7
+   struct bmeprof *prof; // driver profile of the detected chip
+   int chans;        // enabled channels CHAN_*, see bmechans
+};
+
+struct i2c_msg;      // <linux/i2c.h>, one message of an I2C_RDWR transfer
+
+struct bmebusops{    // bus access of the driver, see muxcheck.c, sweepcheck.c
+   int (*open)(const char *bus);                // open the bus, returns the fd
+   int (*slave)(int fd, int addr);              // set I2C_SLAVE, 0 = OK
+   int (*write)(int fd, void *buf, int len);    // returns bytes written
+   int (*read)(int fd, void *buf, int len);     // returns bytes read
+   int (*rdwr)(int fd, struct i2c_msg *msgs, int n); // I2C_RDWR, returns n
+};
+
+/* ------------------------------------------------------------ *
+ * Linux IIO kernel driver backend (iio_bme280.c)               *
+ * ------------------------------------------------------------ */
+#define IIO_CHANNELS         3   // temperature, pressure, humidity
+#define IIO_TEMP             0
+#define IIO_PRES             1
+#define IIO_HUMI             2
+#define IIO_RECMAX          64   // max buffer record length in bytes
+
+struct bmeiioch{     // one IIO channel
+   int present;      // 1 = the device has this channel
+   double scale;     // in_<ch>_scale, 1 if none
+   double offset;    // in_<ch>_offset, 0 if none
+   int index;        // scan element index in the buffer
+   int be;           // 1 = big endian scan element
+   int sign;         // 1 = signed scan element
+   int bits;         // scan element valid bits
+   int storage;      // scan element storage bits
+   int shift;        // scan element right shift
+   int pos;          // byte position in the buffer record
+};
+
+struct bmeiio{       // IIO device state
+   char dir[256];    // sysfs device directory
+   char dev[264];    // buffer chrdev, default /dev/<iio:deviceN>
+   char trigger[64]; // buffer trigger name, empty = sysfs reads
+   char name[32];    // driver device name, e.g. bme280
+   int fd;           // open buffer chrdev, -1 = sysfs reads
+   int reclen;       // buffer record length in bytes
+   struct bmeiioch ch[IIO_CHANNELS];
+};
+
+/* ------------------------------------------------------------ *
+ * Compensation versions (comp_bme280.c), selected with -K      *
+ * ------------------------------------------------------------ */
+struct bmecomp{
+   char *name;       // version name for -K
+   void (*func)(struct bmecal*, struct bmedata*);
 };
 
 /* ------------------------------------------------------------ *
@@ -153,6 +511,31 @@ typedef enum {
    normal = 0x03
 } power_t;
 
+/* ------------------------------------------------------------ *
+ * Datasheet recommended modes (preset_bme280.c), as arguments  *
+ * for the set_*() functions, and the computed sensor timing    *
+ * ------------------------------------------------------------ */
+struct bmepreset{
+   char *name;       // preset name for -P
+   char *osrs_t;     // temperature oversampling
+   char *osrs_p;     // pressure oversampling
+   char *osrs_h;     // humidity oversampling
+   char *filter;     // IIR filter coefficient
+   char *stby;       // standby time in normal mode
+   power_t mode;     // normal, or forced = host triggered
+   float rate;       // host trigger rate in Hz for forced mode
+};
+
+struct bmetime{
+   float meas_typ;   // typical measurement time in ms
+   float meas_max;   // maximum measurement time in ms
+   int normal;       // 1 = normal mode, ODR set by the sensor
+   float odr;        // output data rate in Hz
+   float odr_max;    // max. ODR for back-to-back conversions
+   float bandw;      // IIR filter bandwidth in Hz, 0 = filter off
+   float current;    // estimated average supply current in uA
+};
+
 /* ------------------------------------------------------------ *
  * external function prototypes for I2C bus communication       *
  * ------------------------------------------------------------ */
@@ -160,11 +543,15 @@ extern void get_i2cbus(char*, char*);     // get the I2C bus file handle
 extern int bme_dump();                    // dump the register map data
 extern int bme_reset();                   // reset the sensor
 extern void bme_info(struct bmeinf*);     // print sensor information
+extern int bme_snapshot(struct bmeinf*);  // read sensor state in 1 burst
 extern char get_chipid();                 // get the sensor chip id
+extern struct bmeprof *get_profile(char); // get profile for a chip id
 extern void print_osrs(char);             // prints the oversampling rate
 extern char get_power();                  // get the sensor power mode
 extern int set_power(power_t);            // set the sensor power mode
+extern int bme_trigger(struct bmeinf*);   // start a forced conversion
 extern void print_power(char);            // prints the sensor power mode
+extern char get_status();                 // get the measuring status
 extern char get_h_osrs();                 // get humidity oversampling
 extern int set_h_osrs(char*);             // set humidity oversampling
 extern char get_p_osrs();                 // get pressure oversampling
@@ -183,3 +570,179 @@ extern void get_calib();                  // get the sensor calibration data
 extern void print_calib(struct bmecal*);  // prints the calibration data 
 extern void get_data(struct bmecal*,      // get temp, humidity, and
                       struct bmedata*);   // pressure data
+extern void bme_compensate(struct bmecal*,// convert raw adc values in
+                      struct bmedata*);   // bmedata to measurements
+extern int bme_markers(struct bmedata*);  // channels with a skip value
+extern void stamp_start(struct bmestamp*);// take the read start times
+extern void stamp_end(struct bmestamp*);  // take the latency and number
+
+/* ------------------------------------------------------------ *
+ * external function prototypes for sensor lists and muxes      *
+ * ------------------------------------------------------------ */
+extern int sensor_parse(char*, char*,     // split the -b list into
+            struct bmesensor*, int);      // sensor specs
+extern void sensor_schedule(struct bmesensor*, int); // sort in read order
+extern int sensor_select(struct bmesensor*);// switch to a sensor
+extern void sensor_release();             // close the open muxes
+extern int sensor_fd(struct bmesensor*,   // find an open bus
+            int, char*);
+extern int bme_batch(struct bmesensor*,   // pipelined forced mode read
+            int, struct bmecal*, struct bmedata*); // of all sensors
+
+/* ------------------------------------------------------------ *
+ * external function prototypes for the IIO backend             *
+ * ------------------------------------------------------------ */
+extern int iio_open(struct bmeiio*,       // open the -I device, set up
+            char*, int);                  // the buffer if 1
+extern int iio_read(struct bmeiio*,       // read one sample from sysfs
+            struct bmedata*);             // or the buffer
+extern int iio_osrs(struct bmeiio*, char*);// set oversampling, -m format
+extern void iio_info(struct bmeiio*);     // print the device information
+extern void iio_close(struct bmeiio*);    // disable the buffer
+
+/* ------------------------------------------------------------ *
+ * external function prototypes for compensation versions       *
+ * ------------------------------------------------------------ */
+extern struct bmecomp *get_comp(char*);   // find a version, NULL = list
+extern void comp_double(struct bmecal*,   // datasheet double version
+                      struct bmedata*);
+extern void comp_int64(struct bmecal*,    // datasheet integer version,
+                      struct bmedata*);   // 64 bit pressure
+extern void comp_int32(struct bmecal*,    // datasheet integer version,
+                      struct bmedata*);   // 32 bit pressure
+extern void (*compensate)(struct bmecal*, // the version selected by -K
+                      struct bmedata*);
+
+/* ------------------------------------------------------------ *
+ * external function prototypes for the integer compensation    *
+ * ------------------------------------------------------------ */
+extern int32_t comp_t_int32(struct bmecal*,// temperature in 0.01*C,
+            int32_t, int32_t*);           // sets t_fine
+extern uint32_t comp_h_int32(struct bmecal*,// humidity in 1/1024 %
+            int32_t, int32_t);
+extern uint32_t comp_p_int64(struct bmecal*,// pressure in 1/256 Pa
+            int32_t, int32_t);
+extern uint32_t comp_p_int32(struct bmecal*,// pressure in Pa, BMP280
+            int32_t, int32_t);            // 32 bit version
+
+/* ------------------------------------------------------------ *
+ * external function prototypes for presets and sensor timing   *
+ * ------------------------------------------------------------ */
+extern struct bmepreset *get_preset(char*);// find a preset by name
+extern int set_preset(struct bmepreset*); // apply a preset
+extern int set_config(struct bmeinf*);    // write back a snapshot
+extern void bme_timing(struct bmeinf*,    // compute measurement time,
+            float, struct bmetime*);      // ODR, bandwidth, current
+extern void print_timing(struct bmetime*);// prints the sensor timing
+extern int bme_tune(int, char**);         // configuration optimizer
+extern float bme_rms(float*, int);        // RMS around the drift line
+extern int bme_sweep(int, char**);        // characterization sweep
+extern char *osrs_args[], *filter_args[], *stby_args[]; // codes as args
+
+/* ------------------------------------------------------------ *
+ * external function prototypes for derived quantities          *
+ * ------------------------------------------------------------ */
+extern void derive_data(struct bmedata*,  // compute dew point, abs.
+            struct bmederiv*, float, int);// humidity, altitude, QNH
+extern void derive_batch(const struct bmedata*, // same for arrays
+            struct bmederiv*, size_t, float, int); // of samples
+
+/* ------------------------------------------------------------ *
+ * external function prototypes for adaptive sampling           *
+ * ------------------------------------------------------------ */
+extern int adapt_init(struct bmeadapt*,   // parse the -A setting and
+                      char*);             // start in low-rate mode
+extern int adapt_trigger(struct bmeadapt*);// start a forced conversion
+extern void adapt_update(struct bmeadapt*,// feed a sample, switch the
+                      struct bmedata*);   // mode on rate of change
+extern int adapt_interval(struct bmeadapt*);// current interval in ms
+
+/* ------------------------------------------------------------ *
+ * external function prototypes for the control socket          *
+ * ------------------------------------------------------------ */
+extern int ctl_open(char*);               // listen on a control socket
+extern void ctl_poll(int, float);         // serve pending commands
+extern void ctl_close(int, char*);        // close, remove the socket
+
+/* ------------------------------------------------------------ *
+ * external function prototypes for the datagram push           *
+ * ------------------------------------------------------------ */
+extern int push_open(struct bmepush*,     // parse the -U setting and
+                      char*);             // connect the socket
+extern void push_put(struct bmepush*,     // send a sample, or add it
+                      int64_t, struct bmedata*); // to the window
+extern void push_close(struct bmepush*);  // send the open window, close
+extern int bme_listen(int, char**);       // datagram listener subcommand
+extern int push_connect(char*);           // datagram socket to udp:/unix:
+
+/* ------------------------------------------------------------ *
+ * external function prototypes for the bus lock                *
+ * ------------------------------------------------------------ */
+extern int lock_init(char*);              // parse the -L setting
+extern int lock_open();                   // open the bus lock files
+extern int bus_lock();                    // start a transaction group
+extern void bus_unlock();                 // end a transaction group
+extern void lock_stats();                 // print the lock waits, -v
+
+/* ------------------------------------------------------------ *
+ * external function prototypes for the event rules             *
+ * ------------------------------------------------------------ */
+extern int rule_open(struct bmerules*,    // read the -R rule file and
+                      char*);             // open the event output
+extern void rule_check(struct bmerules*,  // check one sample, emit the
+                      int64_t, struct bmedata*); // state changes
+extern void rule_close(struct bmerules*); // close the event output
+
+/* ------------------------------------------------------------ *
+ * external function prototypes for the software filter chain   *
+ * ------------------------------------------------------------ */
+extern int filter_init(struct bmefilter*, // parse the -F setting
+                      char*);
+extern void filter_apply(struct bmefilter*,// filter the compensated
+                      struct bmedata*);   // values of one sample
+
+/* ------------------------------------------------------------ *
+ * external function prototypes for group commit and text logs  *
+ * ------------------------------------------------------------ */
+extern int group_init(struct bmegroup*,   // parse the -G setting
+                      char*);
+extern int group_add(struct bmegroup*);   // count a sample, 1 = commit
+extern void group_done(struct bmegroup*); // start the next group
+extern int bme_sync(int, int);            // sync a file with a policy
+extern int log_open(struct bmelog*,       // open a text log, cut off
+                      char*, int);        // a torn last line
+extern int log_put(struct bmelog*,        // buffer one line
+                      char*, size_t);
+extern int log_commit(struct bmelog*);    // write and sync the lines
+extern int log_close(struct bmelog*);     // commit and close the log
+
+/* ------------------------------------------------------------ *
+ * external function prototypes for the sample queue and sink   *
+ * ------------------------------------------------------------ */
+extern struct bmeq *bmeq_create(int, int);// create a queue, size, policy
+extern int bmeq_push(struct bmeq*,        // queue a sample from the
+                      struct bmesample*); // sampling loop
+extern int bmeq_pop(struct bmeq*,         // take the oldest sample,
+                      struct bmesample*); // waits if queue is empty
+extern int sink_start(struct bmeq*,       // start the output thread
+                      void (*)(struct bmesample*));
+extern void sink_stop(struct bmeq*);      // drain, stop and free
+
+/* ------------------------------------------------------------ *
+ * external function prototypes for sample log processing       *
+ * ------------------------------------------------------------ */
+extern int bme_query(int, char**);        // time-range query of a log
+extern int bme_reproc(int, char**);       // parallel store reprocessing
+extern int bmez_open(struct bmezw*, char*,// open or create a store
+                      struct bmecal*);    // file for appending
+extern int bmez_put(struct bmezw*,        // append one sample to
+                      int64_t, struct bmedata*); // the store
+extern int bmez_flush(struct bmezw*);     // write the open block
+extern int bmez_commit(struct bmezw*);    // write and sync the block
+extern int bmez_close(struct bmezw*);     // write and close the store
+extern int bmez_calib(const uint8_t*,     // get the calibration from
+                      size_t, struct bmecal*); // a store file header
+extern size_t bmez_block(const uint8_t*,  // decode a block header,
+                      size_t, struct bmezb*);  // returns block length
+extern int bmez_decode(const uint8_t*,    // decode all samples of
+                      size_t, struct bmezs*);  // a store block
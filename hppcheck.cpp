@@ -0,0 +1,253 @@
+/* ------------------------------------------------------------ *
+ * file:        hppcheck.cpp                                    *
+ * purpose:     Checks the C++ driver bme280.hpp against the C  *
+ *              reference implementation, without hardware:     *
+ *              the constexpr register values and datasheet     *
+ *              examples at compile time, the three Precision   *
+ *              versions against the compensation versions of   *
+ *              comp_bme280.c over a grid of adc values, and    *
+ *              the register transfers of begin(), configure()  *
+ *              and measure() on a fake bus.                    *
+ *                                                              *
+ * return:      0 if all checks pass, and -1 on failures.       *
+ *                                                              *
+ * example:	make check                                      *
+ *                                                              *
+ * author:      10/18/2026 agent                                *
+ * ------------------------------------------------------------ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <ctime>
+#include <string>
+#include <sys/types.h>
+#include <pthread.h>
+extern "C" {
+#include "getbme280.h"
+}
+#include "bme280.hpp"
+
+using namespace bme280;
+
+/* ------------------------------------------------------------ *
+ * Global variables and defaults                                *
+ * ------------------------------------------------------------ */
+extern "C" { int verbose = 0; } // debug output of i2c_bme280.c, stays off
+static int failed = 0;          // number of failed checks
+
+/* ------------------------------------------------------------ *
+ * Compile time: register values, and the BMP280 datasheet      *
+ * example values (chapter 8.2), 25.08*C and 100653.25 Pa       *
+ * ------------------------------------------------------------ */
+static_assert(indoor.ctrl_meas() == 0x57 && indoor.config() == 0x10 && indoor.ctrl_hum() == 0x01);
+static_assert(gaming.skip() == chan_h && humidity.skip() == chan_p && weather.skip() == 0);
+static_assert(weather.measure_us() == 9300 && indoor.measure_us() == 46100);
+static_assert(Settings().standby(Standby::ms1000).filter(Filter::x4).config() == 0xA8);
+
+constexpr uint8_t ds_tp[26] = { 0x70, 0x6B, 0x43, 0x67, 0x18, 0xFC, 0x7D, 0x8E,
+                                0x43, 0xD6, 0xD0, 0x0B, 0x27, 0x0B, 0x8C, 0x00,
+                                0xF9, 0xFF, 0x8C, 0x3C, 0xF8, 0xC6, 0x70, 0x17 };
+constexpr uint8_t ds_data[8] = { 0x65, 0x5A, 0xC0, 0x7E, 0xED, 0x00, 0x80, 0x00 };
+constexpr Calib ds_cal = Calib::parse(ds_tp, nullptr);
+constexpr Raw ds_raw = Raw::decode(ds_data, chan_h);
+static_assert(ds_cal.dig_T1 == 27504 && ds_cal.dig_T3 == -1000 && ds_cal.dig_P9 == 6000);
+static_assert(ds_raw.adc_t == 519888 && ds_raw.adc_p == 415148);
+static_assert(Fixed::compensate(ds_cal, ds_raw).temp_c == 2508);
+static_assert(Fixed::compensate(ds_cal, ds_raw).pres_pa == 25767233);
+
+/* ------------------------------------------------------------ *
+ * The calibration of the grid check, from a BME280             *
+ * ------------------------------------------------------------ */
+static const struct bmecal grid_cal = {
+   28485, 26735, 50, 36738, -10635, 3024, 6980, -4, -7, 9900, -10230, 4285,
+   75, 362, 0, 313, 50, 30
+};
+
+/* ------------------------------------------------------------ *
+ * check() counts and prints a failed check                     *
+ * ------------------------------------------------------------ */
+static void check(bool ok, const char *what) {
+   if(ok) return;
+   printf("FAIL: %s\n", what);
+   failed++;
+}
+
+/* ------------------------------------------------------------ *
+ * to_calib() converts the C calibration struct                 *
+ * ------------------------------------------------------------ */
+static Calib to_calib(const struct bmecal &b) {
+   return Calib { b.dig_T1, b.dig_T2, b.dig_T3, b.dig_P1, b.dig_P2, b.dig_P3, b.dig_P4,
+                  b.dig_P5, b.dig_P6, b.dig_P7, b.dig_P8, b.dig_P9, b.dig_H1, b.dig_H2,
+                  b.dig_H3, b.dig_H4, b.dig_H5, b.dig_H6 };
+}
+
+/* ------------------------------------------------------------ *
+ * near() compares a C++ value with the C value, NAN == NAN     *
+ * ------------------------------------------------------------ */
+static bool near(double a, double b, double tol) {
+   if(std::isnan(a) || std::isnan(b)) return std::isnan(a) && std::isnan(b);
+   return std::fabs(a - b) <= tol;
+}
+
+/* ------------------------------------------------------------ *
+ * check_grid() compensates a grid of adc values with Fixed,    *
+ * Double and Float, and the C versions int64, double and float *
+ * Fixed and int64 are equal, Double and double differ by the   *
+ * float rounding of bmedata, and the single precision Float    *
+ * has the float cancellation error of the datasheet formula.   *
+ * ------------------------------------------------------------ */
+static void check_grid() {
+   struct bmecal bmec = grid_cal;
+   Calib cal = to_calib(grid_cal);
+   double maxd[3] = { 0, 0, 0 };
+   int n = 0, bad_fixed = 0, bad_double = 0, bad_float = 0;
+
+   for(int32_t adc_t = 400000; adc_t <= 600000; adc_t += 4999) {
+      for(int32_t adc_p = 200000; adc_p <= 500000; adc_p += 9973) {
+         for(int32_t adc_h = 20000; adc_h <= 40000; adc_h += 1999) {
+            for(int skip = 0; skip <= chan_all; skip++) {
+               struct bmedata bmed;
+               memset(&bmed, 0, sizeof(bmed));
+               bmed.adc_t = adc_t;
+               bmed.adc_p = adc_p;
+               bmed.adc_h = adc_h;
+               bmed.skip = skip;
+               Raw raw { adc_t, adc_p, adc_h, static_cast<uint8_t>(skip) };
+               n++;
+
+               /* -- Fixed, against the C integer functions -- */
+               Fixed::Reading fx = Fixed::compensate(cal, raw);
+               if((skip & chan_t) == 0) {
+                  int32_t t_fine;
+                  int32_t t = comp_t_int32(&bmec, adc_t, &t_fine);
+                  if(fx.temp_c != t) bad_fixed++;
+                  if((skip & chan_p) == 0 && fx.pres_pa != comp_p_int64(&bmec, adc_p, t_fine)) bad_fixed++;
+                  if((skip & chan_h) == 0 && fx.humi_rh != comp_h_int32(&bmec, adc_h, t_fine)) bad_fixed++;
+               }
+               else if(fx.skip != chan_all) bad_fixed++;
+
+               /* -- Double, against comp_double() -- */
+               Double::Reading db = Double::compensate(cal, raw);
+               comp_double(&bmec, &bmed);
+               if(!near(db.temp_c, bmed.temp_c, 1e-5) || !near(db.pres_pa, bmed.pres_p, 0.01)
+                  || !near(db.humi_rh, bmed.humi_p, 1e-5)) bad_double++;
+
+               /* -- Float, against Double -- */
+               Float::Reading fl = Float::compensate(cal, raw);
+               double d[3] = { fl.temp_c - db.temp_c, fl.pres_pa - db.pres_pa, fl.humi_rh - db.humi_rh };
+               for(int i = 0; i < 3; i++) {
+                  if(!std::isnan(d[i]) && std::fabs(d[i]) > maxd[i]) maxd[i] = std::fabs(d[i]);
+               }
+               if(!near(fl.temp_c, db.temp_c, 0.001) || !near(fl.pres_pa, db.pres_pa, 1.0)
+                  || !near(fl.humi_rh, db.humi_rh, 0.01)) bad_float++;
+            }
+         }
+      }
+   }
+   printf("Grid of %d adc values, Float max. difference to Double: "
+          "%.5f*C %.3fPa %.5f%%\n", n, maxd[0], maxd[1], maxd[2]);
+   check(bad_fixed == 0, "Fixed equals the C integer version");
+   check(bad_double == 0, "Double equals comp_double()");
+   check(bad_float == 0, "Float is within 0.001*C, 1Pa, 0.01% of Double");
+}
+
+/* ------------------------------------------------------------ *
+ * The fake bus: a register image, reads are served from it,    *
+ * and the writes are recorded as "F4=57"                       *
+ * ------------------------------------------------------------ */
+struct FakeBus {
+   uint8_t regs[256] = {0};
+   std::string trace;
+
+   bool read(uint8_t reg, uint8_t *buf, std::size_t len) {
+      if(reg + len > sizeof(regs)) return false;
+      memcpy(buf, regs + reg, len);
+      return true;
+   }
+   bool write(uint8_t reg, uint8_t val) {
+      char op[8];
+      snprintf(op, sizeof(op), "%s%02X=%02X", trace.empty() ? "" : " ", reg, val);
+      trace += op;
+      regs[reg] = val;
+      return true;
+   }
+};
+
+/* ------------------------------------------------------------ *
+ * put16() stores a calibration value in the register image     *
+ * ------------------------------------------------------------ */
+static void put16(uint8_t *r, int val) {
+   r[0] = val & 0xFF;
+   r[1] = (val >> 8) & 0xFF;
+}
+
+/* ------------------------------------------------------------ *
+ * check_driver() runs begin(), configure() and measure() on    *
+ * the fake bus with the grid calibration                       *
+ * ------------------------------------------------------------ */
+static void check_driver() {
+   Bme280<FakeBus, Fixed> s;
+   uint8_t *r = s.transport().regs;
+   const struct bmecal &b = grid_cal;
+
+   r[reg::chip_id] = 0x60;
+   int tp[12] = { b.dig_T1, b.dig_T2, b.dig_T3, b.dig_P1, b.dig_P2, b.dig_P3,
+                  b.dig_P4, b.dig_P5, b.dig_P6, b.dig_P7, b.dig_P8, b.dig_P9 };
+   for(int i = 0; i < 12; i++) put16(r + reg::calib00 + 2 * i, tp[i]);
+   r[0xA1] = b.dig_H1;
+   put16(r + reg::calib26, b.dig_H2);
+   r[0xE3] = b.dig_H3;
+   r[0xE4] = (b.dig_H4 >> 4) & 0xFF;
+   r[0xE5] = (b.dig_H4 & 0x0F) | (b.dig_H5 & 0x0F) << 4;
+   r[0xE6] = (b.dig_H5 >> 4) & 0xFF;
+   r[0xE7] = b.dig_H6;
+   uint8_t data[8] = { 0x65, 0x5A, 0xC0, 0x7E, 0xED, 0x00, 0x6C, 0x9E };
+   memcpy(r + reg::data, data, sizeof(data));
+
+   check(s.begin() && s.has_humidity(), "begin() on a BME280");
+   check(s.calib().dig_T1 == b.dig_T1 && s.calib().dig_H4 == b.dig_H4
+         && s.calib().dig_H5 == b.dig_H5 && s.calib().dig_P9 == b.dig_P9,
+         "begin() parses the calibration");
+
+   check(s.configure(indoor) && s.transport().trace == "F4=54 F5=10 F2=01 F4=57",
+         "configure(indoor) writes ctrl_meas sleep, config, ctrl_hum, ctrl_meas");
+
+   s.transport().trace.clear();
+   Fixed::Reading fx;
+   check(s.configure(gaming) && s.measure(fx), "configure(gaming) and read");
+   check(fx.skip == chan_h && fx.humi_rh == 0, "gaming skips the humidity");
+
+   s.transport().trace.clear();
+   check(s.configure(weather) && s.measure(fx), "configure(weather) and measure");
+   check(s.transport().trace == "F4=24 F5=00 F2=01 F4=25",
+         "measure() triggers a forced conversion");
+   Raw raw = Raw::decode(data, 0);
+   Fixed::Reading ref = Fixed::compensate(to_calib(grid_cal), raw);
+   check(fx.temp_c == ref.temp_c && fx.pres_pa == ref.pres_pa && fx.humi_rh == ref.humi_rh
+         && fx.skip == 0, "measure() reads and compensates the data registers");
+
+   /* -- A BMP280 has no humidity, and no ctrl_hum write -- */
+   Bme280<FakeBus, Double> p;
+   memcpy(p.transport().regs, r, 256);
+   p.transport().regs[reg::chip_id] = 0x58;
+   Double::Reading db;
+   check(p.begin() && !p.has_humidity() && p.configure(weather) && p.measure(db),
+         "begin() and measure() on a BMP280");
+   check(p.transport().trace == "F4=24 F5=00 F4=25", "no ctrl_hum on a BMP280");
+   check(std::isnan(db.humi_rh) && db.skip == chan_h && !std::isnan(db.pres_pa),
+         "BMP280 humidity is skipped");
+}
+
+int main() {
+   check_grid();
+   check_driver();
+
+   if(failed > 0) {
+      printf("Error: %d C++ driver checks failed.\n", failed);
+      exit(-1);
+   }
+   printf("All C++ driver checks passed.\n");
+   exit(0);
+}
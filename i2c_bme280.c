@@ -14,7 +14,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <math.h>
+#include <time.h>
 #include <linux/i2c-dev.h>
+#include <linux/i2c.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
 #include <fcntl.h>
@@ -22,36 +25,105 @@
 
 extern int verbose;
 int i2cfd;
+int i2cslave;  // sensor address, for combined I2C_RDWR transfers
+struct bmesensor sensors[SENSOR_MAX]; // the -b sensor list, in read order
+int nsensors = 0;
+
+/* ------------------------------------------------------------ *
+ * Driver profiles for the supported chip ids. Unknown chip ids *
+ * fall back to the full BME280 register set.                   *
+ * ------------------------------------------------------------ */
+static struct bmeprof bmeprofs[] = {
+   { 0x60, "BME280",        1, 8 },
+   { 0x58, "BMP280",        0, 6 },
+   { 0x56, "BMP280 Sample", 0, 6 },
+   { 0x57, "BMP280",        0, 6 },
+};
+static struct bmeprof bmeunknown = { 0x00, "ChipID unknown", 1, 8 };
+struct bmeprof *bmep = &bmeprofs[0];
+static int chans_all = CHAN_ALL;
+int *bmechans = &chans_all;
+
+/* ------------------------------------------------------------ *
+ * Bus access of the driver. All register transfers go through  *
+ * busops: muxcheck and sweepcheck replace it with a fake bus,  *
+ * no hardware needed.                                          *
+ * ------------------------------------------------------------ */
+static int bus_open(const char *bus) { return open(bus, O_RDWR); }
+static int bus_slave(int fd, int addr) { return ioctl(fd, I2C_SLAVE, addr); }
+static int bus_write(int fd, void *buf, int len) { return write(fd, buf, len); }
+static int bus_read(int fd, void *buf, int len) { return read(fd, buf, len); }
+static int bus_rdwr(int fd, struct i2c_msg *msgs, int n) {
+   struct i2c_rdwr_ioctl_data xfer = { msgs, n };
+   return ioctl(fd, I2C_RDWR, &xfer);
+}
+struct bmebusops busops = { bus_open, bus_slave, bus_write, bus_read, bus_rdwr };
 
 /* ------------------------------------------------------------ *
  * get_i2cbus() - Enables the I2C bus communication. RPi 2,3,4  *
  * use /dev/i2c-1, RPi 1 used i2c-0, NanoPi Neo also uses i2c-0 *
+ * i2cbus can list several sensors, also behind TCA9548A muxes, *
+ * see mux_bme280.c. They are probed in reverse read order, so  *
+ * the probe ends on the first sensor, without an extra channel *
+ * switch before the first read.                                *
  * ------------------------------------------------------------ */
 void get_i2cbus(char *i2cbus, char *i2caddr) {
+   nsensors = sensor_parse(i2cbus, i2caddr, sensors, SENSOR_MAX);
+   if(nsensors < 1) exit(-1);
+   sensor_schedule(sensors, nsensors);
 
-   if((i2cfd = open(i2cbus, O_RDWR)) < 0) {
-      printf("Error failed to open I2C bus [%s].\n", i2cbus);
-      exit(-1);
+   for(int i = nsensors - 1; i >= 0; i--) {
+      struct bmesensor *s = &sensors[i];
+      s->fd = sensor_fd(sensors, nsensors, s->bus);
+      if(s->fd < 0 && (s->fd = busops.open(s->bus)) < 0) {
+         printf("Error failed to open I2C bus [%s].\n", s->bus);
+         exit(-1);
+      }
+      if(verbose == 1) printf("Debug: I2C bus device: [%s]\n", s->bus);
    }
-   if(verbose == 1) printf("Debug: I2C bus device: [%s]\n", i2cbus);
-   /* --------------------------------------------------------- *
-    * Set I2C device (BME280 I2C address is 0x76 or 0xF77)      *
-    * --------------------------------------------------------- */
-   int addr = (int)strtol(i2caddr, NULL, 16);
-   if(verbose == 1) printf("Debug: Sensor address: [0x%02X]\n", addr);
 
-   if(ioctl(i2cfd, I2C_SLAVE, addr) != 0) {
-      printf("Error can't find sensor at address [0x%02X].\n", addr);
-      exit(-1);
+   /* ------------------------------------------------------------ *
+    * With -L, the probe and the rest of the run are one group,    *
+    * -c unlocks after its setup. See lock_bme280.c.               *
+    * ------------------------------------------------------------ */
+   if(lock_open() != 0 || bus_lock() != 0) exit(-1);
+
+   for(int i = nsensors - 1; i >= 0; i--) {
+      struct bmesensor *s = &sensors[i];
+      /* --------------------------------------------------------- *
+       * Set I2C device (BME280 I2C address is 0x76 or 0xF77)      *
+       * --------------------------------------------------------- */
+      if(verbose == 1) printf("Debug: Sensor address: [0x%02X]\n", s->addr);
+      if(sensor_select(s) != 0) exit(-1);
+
+      /* --------------------------------------------------------- *
+       * I2C communication test is the only way to confirm success *
+       * --------------------------------------------------------- */
+      char chipid = get_chipid();
+      if(chipid == 0) {
+         printf("Error: No response from I2C. addr [0x%02X]?\n", s->addr);
+         exit(-1);
+      }
+      if(verbose == 1) printf("Debug: Got data @addr: [0x%02X]\n", s->addr);
+
+      /* --------------------------------------------------------- *
+       * Select the driver profile for the detected sensor variant *
+       * --------------------------------------------------------- */
+      bmep = s->prof = get_profile(chipid);
+      if(verbose == 1) printf("Debug: Sensor profile: [%s] humidity [%d] data [%d bytes]\n",
+                              bmep->name, bmep->humidity, bmep->datalen);
    }
-   /* --------------------------------------------------------- *
-    * I2C communication test is the only way to confirm success *
-    * --------------------------------------------------------- */
-   if(get_chipid(addr) == 0) {
-      printf("Error: No response from I2C. addr [0x%02X]?\n", addr);
-      exit(-1);
+}
+
+/* --------------------------------------------------------------- *
+ * get_profile() returns the driver profile for a sensor chip id.  *
+ * --------------------------------------------------------------- */
+struct bmeprof *get_profile(char chipid) {
+   for(size_t i = 0; i < sizeof(bmeprofs) / sizeof(bmeprofs[0]); i++) {
+      if(bmeprofs[i].chip_id == chipid) return &bmeprofs[i];
    }
-   if(verbose == 1) printf("Debug: Got data @addr: [0x%02X]\n", addr);
+   bmeunknown.chip_id = chipid;
+   return &bmeunknown;
 }
 
 /* --------------------------------------------------------------- *
@@ -60,11 +132,11 @@ void get_i2cbus(char *i2cbus, char *i2caddr) {
 char get_chipid() {
    char reg = BME280_CHIP_ID_ADDR;
    char buf = 0;
-   if(write(i2cfd, &reg, 1) != 1) {
+   if(busops.write(i2cfd, &reg, 1) != 1) {
       printf("Error: I2C write failure for register 0x%02X\n", reg);
    }
 
-   if(read(i2cfd, &buf, 1) != 1) {
+   if(busops.read(i2cfd, &buf, 1) != 1) {
       printf("Error: I2C read failure for register 0x%02X\n", reg);
    }
    return buf;
@@ -93,12 +165,12 @@ int bme_dump() {
     * Next read 26 bytes calibration, starting at addr 0x88  *
     * ------------------------------------------------------ */
    reg = 0x88;
-   if(write(i2cfd, &reg, 1) != 1) {
+   if(busops.write(i2cfd, &reg, 1) != 1) {
       printf("Error: I2C write failure for register 0x%02X\n", reg);
       exit(-1);
    }
 
-   if(read(i2cfd, &buf, 26) != 26) {
+   if(busops.read(i2cfd, &buf, 26) != 26) {
       printf("Error: I2C read failure for register 0x%02X\n", reg);
       exit(-1);
    }
@@ -116,12 +188,12 @@ int bme_dump() {
    memset(buf, 0, sizeof(buf)); // clear all data from buf
    reg = 0xD0;
 
-   if(write(i2cfd, &reg, 1) != 1) {
+   if(busops.write(i2cfd, &reg, 1) != 1) {
       printf("Error: I2C write failure for register 0x%02X\n", reg);
       exit(-1);
    }
 
-   if(read(i2cfd, &buf, 1) != 1) {
+   if(busops.read(i2cfd, &buf, 1) != 1) {
       printf("Error: I2C read failure for register 0x%02X\n", reg);
       exit(-1);
    }
@@ -133,12 +205,12 @@ int bme_dump() {
    memset(buf, 0, sizeof(buf)); // clear all data from buf
    reg = 0xE0;
 
-   if(write(i2cfd, &reg, 1) != 1) {
+   if(busops.write(i2cfd, &reg, 1) != 1) {
       printf("Error: I2C write failure for register 0x%02X\n", reg);
       exit(-1);
    }
 
-   if(read(i2cfd, &buf, 31) != 31) {
+   if(busops.read(i2cfd, &buf, 31) != 31) {
       printf("Error: I2C read failure for register 0x%02X\n", reg);
       exit(-1);
    }
@@ -150,7 +222,7 @@ int bme_dump() {
           buf[16], buf[17], buf[18], buf[19], buf[20], buf[21], buf[22], buf[23]);
    printf("%02X %02X %02X %02X %02X %02X %02X\n",
           buf[24], buf[25], buf[26], buf[27], buf[28], buf[29], buf[30]);
-   exit(0);
+   return(0);
 }
 
 /* --------------------------------------------------------------- *
@@ -160,7 +232,7 @@ int bme_reset() {
    char data[2];
    data[0] = BME280_RESET_ADDR;
    data[1] = 0xB6;
-   if(write(i2cfd, data, 2) != 2) {
+   if(busops.write(i2cfd, data, 2) != 2) {
       printf("Error: I2C write failure for register 0x%02X\n", data[0]);
       exit(-1);
    }
@@ -170,7 +242,24 @@ int bme_reset() {
     * After a reset, the sensor needs at leat 2ms to boot up.      *
     * ------------------------------------------------------------ */
    usleep(2 * 1000);
-   exit(0);
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * bme_trigger() starts a forced conversion with one register   *
+ * write. The oversampling bits come from a snapshot of 0xF4,   *
+ * so unlike set_power() it needs no read before and after.     *
+ * ------------------------------------------------------------ */
+int bme_trigger(struct bmeinf *bmei) {
+   char buf[2];
+   buf[0] = BME280_CTRL_MEAS_ADDR;
+   buf[1] = (bmei->osrs_t_mode << 5) | (bmei->osrs_p_mode << 2) | forced;
+   if(verbose == 1) printf("Debug: Write pwr_mode: [0x%02X] to register [0x%02X]\n", buf[1], buf[0]);
+   if(busops.write(i2cfd, buf, 2) != 2) {
+      printf("Error: I2C write failure for register 0x%02X\n", buf[0]);
+      return(-1);
+   }
+   return(0);
 }
 
 /* ------------------------------------------------------------ *
@@ -180,13 +269,13 @@ int bme_reset() {
  * ------------------------------------------------------------ */
 int set_power(power_t mode) {
    char reg = BME280_CTRL_MEAS_ADDR;
-   if(write(i2cfd, &reg, 1) != 1) {
+   if(busops.write(i2cfd, &reg, 1) != 1) {
       printf("Error: I2C write failure for register 0x%02X\n", reg);
       return(-1);
    }
 
    char regdata = 0;
-   if(read(i2cfd, &regdata, 1) != 1) {
+   if(busops.read(i2cfd, &regdata, 1) != 1) {
       printf("Error: I2C read failure for register data 0x%02X\n", reg);
       return(-1);
    }
@@ -221,7 +310,7 @@ int set_power(power_t mode) {
    buf[0] = BME280_CTRL_MEAS_ADDR;
    buf[1] = regdata;
    if(verbose == 1) printf("Debug: Write pwr_mode: [0x%02X] to register [0x%02X]\n", buf[1], buf[0]);
-   if(write(i2cfd, buf, 2) != 2) {
+   if(busops.write(i2cfd, buf, 2) != 2) {
       printf("Error: I2C write failure for register 0x%02X\n", buf[0]);
       return(-1);
    }
@@ -236,13 +325,13 @@ int set_power(power_t mode) {
  * ------------------------------------------------------------ */
 char get_power() {
    char reg = BME280_CTRL_MEAS_ADDR;
-   if(write(i2cfd, &reg, 1) != 1) {
+   if(busops.write(i2cfd, &reg, 1) != 1) {
       printf("Error: I2C write failure for register 0x%02X\n", reg);
       return(-1);
    }
 
    char buf = 0;
-   if(read(i2cfd, &buf, 1) != 1) {
+   if(busops.read(i2cfd, &buf, 1) != 1) {
       printf("Error: I2C read failure for register data 0x%02X\n", reg);
       return(-1);
    }
@@ -251,6 +340,25 @@ char get_power() {
    return(buf & 0x03);  // only return the lowest 2 bits
 }
 
+/* ------------------------------------------------------------ *
+ * get_status() returns the status register 0xF3. Bit 3 is set  *
+ * while a conversion is running, bit 0 while NVM data copies.  *
+ * ------------------------------------------------------------ */
+char get_status() {
+   char reg = BME280_STATUS_ADDR;
+   if(busops.write(i2cfd, &reg, 1) != 1) {
+      printf("Error: I2C write failure for register 0x%02X\n", reg);
+      return(-1);
+   }
+
+   char buf = 0;
+   if(busops.read(i2cfd, &buf, 1) != 1) {
+      printf("Error: I2C read failure for register data 0x%02X\n", reg);
+      return(-1);
+   }
+   return(buf & 0x09);  // only return bit 0 and bit 3
+}
+
 /* ------------------------------------------------------------ *
  * print_power() - prints the sensor power mode string from the *
  * sensors power mode numeric value.                            *
@@ -275,26 +383,68 @@ void print_power(char mode) {
 }
 
 /* ------------------------------------------------------------ *
- * bme_info() - reads sensor configuration data from registers  *
- * 0xD0, 0xF2, 0xF3, 0xF4, 0xF5:                                *
+ * bme_snapshot() - reads the sensor state in one combined I2C  *
+ * transfer: the chip id 0xD0, and 0xF2-0xF5 as one burst. All  *
+ * fields of bmeinf are decoded from this register image:       *
  * char chip_id;     // reg 0xD0 returns 0x60 for type BME280   *
  * char osrs_h_mode; // reg 0xF2 hum oversampling 2-0 bit       *
+ * char status;      // reg 0xF3 bit 3 measuring, bit 0 NVM copy*
  * char osrs_p_mode; // reg 0xF4 default 0x08 oversampling pres *
  * char osrs_t_mode; // reg 0xF4 default 0x08 oversampling temp *
  * char power_mode;  // reg 0xF4 0=sleep, 1,2=forced, 3=normal  *
  * char spi3we_mode; // reg 0xF5 bit-0, 2x values: 0=off, 1=on  *
  * char filter_mode; // reg 0xF5 4-2 bit 5x values              *
  * char stby_time;   // reg 0xF5 7-5 bit range 0.5 ... 1000 ms  *
+ * If the adapter does not support combined transfers, it falls *
+ * back to two write+read pairs. Returns 0, or -1 on errors.    *
+ * ------------------------------------------------------------ */
+int bme_snapshot(struct bmeinf *bmei) {
+   char idreg = BME280_CHIP_ID_ADDR;
+   char ctlreg = BME280_CTRL_HUM_ADDR;
+   char id = 0;
+   char buf[4] = {0};   // register image 0xF2, 0xF3, 0xF4, 0xF5
+
+   struct i2c_msg msgs[4] = {
+      { i2cslave, 0, 1, (__u8 *) &idreg },
+      { i2cslave, I2C_M_RD, 1, (__u8 *) &id },
+      { i2cslave, 0, 1, (__u8 *) &ctlreg },
+      { i2cslave, I2C_M_RD, 4, (__u8 *) buf }
+   };
+
+   if(busops.rdwr(i2cfd, msgs, 4) != 4) {
+      if(verbose == 1) printf("Debug: I2C_RDWR failed, using single reads\n");
+      if(busops.write(i2cfd, &idreg, 1) != 1 || busops.read(i2cfd, &id, 1) != 1) {
+         printf("Error: I2C read failure for register 0x%02X\n", idreg);
+         return(-1);
+      }
+      if(busops.write(i2cfd, &ctlreg, 1) != 1 || busops.read(i2cfd, buf, 4) != 4) {
+         printf("Error: I2C read failure for register 0x%02X\n", ctlreg);
+         return(-1);
+      }
+   }
+   if(verbose == 1) printf("Debug: Snapshot: ID [0x%02X] F2-F5 [0x%02X 0x%02X 0x%02X 0x%02X]\n",
+                           id, buf[0], buf[1], buf[2], buf[3]);
+
+   bmei->chip_id     = id;
+   bmei->osrs_h_mode = bmep->humidity ? buf[0] & 0x07 : 0;
+   bmei->status      = buf[1] & 0x09;
+   bmei->osrs_p_mode = (buf[2] >>2) & 0x07;
+   bmei->osrs_t_mode = (buf[2] >>5) & 0x07;
+   bmei->power_mode  = buf[2] & 0x03;
+   bmei->spi3we_mode = buf[3] & 0x01;
+   bmei->filter_mode = (buf[3] >>2) & 0x07;
+   bmei->stby_time   = (buf[3] >>5) & 0x07;
+
+   *bmechans = (bmei->osrs_t_mode ? CHAN_T : 0) | (bmei->osrs_p_mode ? CHAN_P : 0)
+             | (bmei->osrs_h_mode ? CHAN_H : 0);
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * bme_info() - reads sensor configuration data, see above.     *
  * ------------------------------------------------------------ */
 void bme_info(struct bmeinf *bmei) {
-   bmei->chip_id = get_chipid();
-   bmei->osrs_h_mode = get_h_osrs();
-   bmei->osrs_p_mode = get_p_osrs();
-   bmei->osrs_t_mode = get_t_osrs();
-   bmei->power_mode  = get_power();
-   bmei->spi3we_mode = get_spi3we();
-   bmei->filter_mode = get_filter();
-   bmei->stby_time   = get_stby();
+   if(bme_snapshot(bmei) != 0) exit(-1);
 }
 
 /* --------------------------------------------------------------- *
@@ -303,11 +453,11 @@ void bme_info(struct bmeinf *bmei) {
 char get_h_osrs() {
    char reg = BME280_CTRL_HUM_ADDR;
    char buf = 0;
-   if(write(i2cfd, &reg, 1) != 1) {
+   if(busops.write(i2cfd, &reg, 1) != 1) {
       printf("Error: I2C write failure for register 0x%02X\n", reg);
    }
 
-   if(read(i2cfd, &buf, 1) != 1) {
+   if(busops.read(i2cfd, &buf, 1) != 1) {
       printf("Error: I2C read failure for register 0x%02X\n", reg);
    }
    if(verbose == 1) printf("Debug:  Humidity Mode: [0x%02X] 3bit [0x%02X]\n", buf, buf & 0x07);
@@ -320,11 +470,11 @@ char get_h_osrs() {
 char get_p_osrs() {
    char reg = BME280_CTRL_MEAS_ADDR;
    char buf = 0;
-   if(write(i2cfd, &reg, 1) != 1) {
+   if(busops.write(i2cfd, &reg, 1) != 1) {
       printf("Error: I2C write failure for register 0x%02X\n", reg);
    }
 
-   if(read(i2cfd, &buf, 1) != 1) {
+   if(busops.read(i2cfd, &buf, 1) != 1) {
       printf("Error: I2C read failure for register 0x%02X\n", reg);
    }
 
@@ -338,11 +488,11 @@ char get_p_osrs() {
 char get_t_osrs() {
    char reg = BME280_CTRL_MEAS_ADDR;
    char buf = 0;
-   if(write(i2cfd, &reg, 1) != 1) {
+   if(busops.write(i2cfd, &reg, 1) != 1) {
       printf("Error: I2C write failure for register 0x%02X\n", reg);
    }
 
-   if(read(i2cfd, &buf, 1) != 1) {
+   if(busops.read(i2cfd, &buf, 1) != 1) {
       printf("Error: I2C read failure for register 0x%02X\n", reg);
    }
 
@@ -350,12 +500,25 @@ char get_t_osrs() {
    return((buf >>5) & 0x07);  // only return bit 5-7
 }
 
+/* --------------------------------------------------------------- *
+ * set_chan() marks a channel enabled or skipped for get_data()    *
+ * --------------------------------------------------------------- */
+static void set_chan(int chan, int on) {
+   if(on) *bmechans |= chan;
+   else *bmechans &= ~chan;
+}
+
 /* --------------------------------------------------------------- *
  * set_h_osrs() sets the oversampling rate for humidity            *
  * --------------------------------------------------------------- */
 int set_h_osrs(char *mode){
    char regdata = 0;
 
+   if(bmep->humidity == 0) {
+      printf("Error: %s sensor has no humidity measurement\n", bmep->name);
+      return(-1);
+   }
+
    if(strcmp(mode, "skip")    == 0) regdata = 0;
    else if(strcmp(mode, "1")  == 0) regdata = 1;
    else if(strcmp(mode, "2")  == 0) regdata = 2;
@@ -371,10 +534,11 @@ int set_h_osrs(char *mode){
    buf[0] = BME280_CTRL_HUM_ADDR;
    buf[1] = regdata;
    if(verbose == 1) printf("Debug: Write osrsmode: [0x%02X] to register [0x%02X]\n", buf[1], buf[0]);
-   if(write(i2cfd, buf, 2) != 2) {
+   if(busops.write(i2cfd, buf, 2) != 2) {
       printf("Error: I2C write failure for register 0x%02X\n", buf[0]);
       return(-1);
    }
+   set_chan(CHAN_H, regdata != 0);
    return(0);
 }
 
@@ -385,11 +549,11 @@ int set_h_osrs(char *mode){
 int set_t_osrs(char *mode){
    char reg = BME280_CTRL_MEAS_ADDR;
    char regdata = 0;
-   if(write(i2cfd, &reg, 1) != 1) {
+   if(busops.write(i2cfd, &reg, 1) != 1) {
       printf("Error: I2C write failure for register 0x%02X\n", reg);
    }
 
-   if(read(i2cfd, &regdata, 1) != 1) {
+   if(busops.read(i2cfd, &regdata, 1) != 1) {
       printf("Error: I2C read failure for register 0x%02X\n", reg);
    }
 
@@ -432,10 +596,11 @@ int set_t_osrs(char *mode){
    buf[0] = reg;
    buf[1] = regdata;
    if(verbose == 1) printf("Debug: Write osrsmode: [0x%02X] to register [0x%02X]\n", buf[1], buf[0]);
-   if(write(i2cfd, buf, 2) != 2) {
+   if(busops.write(i2cfd, buf, 2) != 2) {
       printf("Error: I2C write failure for register 0x%02X\n", buf[0]);
       return(-1);
    }
+   set_chan(CHAN_T, strcmp(mode, "skip") != 0);
    return(0);
 }
 
@@ -446,11 +611,11 @@ int set_t_osrs(char *mode){
 int set_p_osrs(char *mode){
    char reg = BME280_CTRL_MEAS_ADDR;
    char regdata = 0;
-   if(write(i2cfd, &reg, 1) != 1) {
+   if(busops.write(i2cfd, &reg, 1) != 1) {
       printf("Error: I2C write failure for register 0x%02X\n", reg);
    }
 
-   if(read(i2cfd, &regdata, 1) != 1) {
+   if(busops.read(i2cfd, &regdata, 1) != 1) {
       printf("Error: I2C read failure for register 0x%02X\n", reg);
    }
 
@@ -493,10 +658,11 @@ int set_p_osrs(char *mode){
    buf[0] = reg;
    buf[1] = regdata;
    if(verbose == 1) printf("Debug: Write osrsmode: [0x%02X] to register [0x%02X]\n", buf[1], buf[0]);
-   if(write(i2cfd, buf, 2) != 2) {
+   if(busops.write(i2cfd, buf, 2) != 2) {
       printf("Error: I2C write failure for register 0x%02X\n", buf[0]);
       return(-1);
    }
+   set_chan(CHAN_P, strcmp(mode, "skip") != 0);
    return(0);
 }
 
@@ -506,11 +672,11 @@ int set_p_osrs(char *mode){
 char get_spi3we() {
    char reg = BME280_CONFIG_ADDR;
    char buf = 0;
-   if(write(i2cfd, &reg, 1) != 1) {
+   if(busops.write(i2cfd, &reg, 1) != 1) {
       printf("Error: I2C write failure for register 0x%02X\n", reg);
    }
 
-   if(read(i2cfd, &buf, 1) != 1) {
+   if(busops.read(i2cfd, &buf, 1) != 1) {
       printf("Error: I2C read failure for register 0x%02X\n", reg);
    }
 
@@ -524,11 +690,11 @@ char get_spi3we() {
 char get_filter() {
    char reg = BME280_CONFIG_ADDR;
    char buf = 0;
-   if(write(i2cfd, &reg, 1) != 1) {
+   if(busops.write(i2cfd, &reg, 1) != 1) {
       printf("Error: I2C write failure for register 0x%02X\n", reg);
    }
 
-   if(read(i2cfd, &buf, 1) != 1) {
+   if(busops.read(i2cfd, &buf, 1) != 1) {
       printf("Error: I2C read failure for register 0x%02X\n", reg);
    }
 
@@ -543,11 +709,11 @@ char get_filter() {
 int set_filter(char *mode) {
    char reg = BME280_CONFIG_ADDR;
    char regdata = 0;
-   if(write(i2cfd, &reg, 1) != 1) {
+   if(busops.write(i2cfd, &reg, 1) != 1) {
       printf("Error: I2C write failure for register 0x%02X\n", reg);
    }
 
-   if(read(i2cfd, &regdata, 1) != 1) {
+   if(busops.read(i2cfd, &regdata, 1) != 1) {
       printf("Error: I2C read failure for register 0x%02X\n", reg);
    }
 
@@ -585,7 +751,7 @@ int set_filter(char *mode) {
    buf[0] = reg;
    buf[1] = regdata;
    if(verbose == 1) printf("Debug: Write IIR mode: [0x%02X] to register [0x%02X]\n", buf[1], buf[0]);
-   if(write(i2cfd, buf, 2) != 2) {
+   if(busops.write(i2cfd, buf, 2) != 2) {
       printf("Error: I2C write failure for register 0x%02X\n", buf[0]);
       return(-1);
    }
@@ -598,11 +764,11 @@ int set_filter(char *mode) {
 char get_stby() {
    char reg = BME280_CONFIG_ADDR;
    char buf = 0;
-   if(write(i2cfd, &reg, 1) != 1) {
+   if(busops.write(i2cfd, &reg, 1) != 1) {
       printf("Error: I2C write failure for register 0x%02X\n", reg);
    }
 
-   if(read(i2cfd, &buf, 1) != 1) {
+   if(busops.read(i2cfd, &buf, 1) != 1) {
       printf("Error: I2C read failure for register 0x%02X\n", reg);
    }
 
@@ -617,11 +783,11 @@ char get_stby() {
 int set_stby(char *mode) {
    char reg = BME280_CONFIG_ADDR;
    char regdata = 0;
-   if(write(i2cfd, &reg, 1) != 1) {
+   if(busops.write(i2cfd, &reg, 1) != 1) {
       printf("Error: I2C write failure for register 0x%02X\n", reg);
    }
 
-   if(read(i2cfd, &regdata, 1) != 1) {
+   if(busops.read(i2cfd, &regdata, 1) != 1) {
       printf("Error: I2C read failure for register 0x%02X\n", reg);
    }
 
@@ -674,7 +840,7 @@ int set_stby(char *mode) {
    buf[0] = reg;
    buf[1] = regdata;
    if(verbose == 1) printf("Debug: Write stbytime: [0x%02X] to register [0x%02X]\n", buf[1], buf[0]);
-   if(write(i2cfd, buf, 2) != 2) {
+   if(busops.write(i2cfd, buf, 2) != 2) {
       printf("Error: I2C write failure for register 0x%02X\n", buf[0]);
       return(-1);
    }
@@ -804,11 +970,11 @@ void get_calib(struct bmecal *bmec) {
     * ------------------------------------------------------------ */
    char reg = BME280_CALIB_00_ADDR;
    char buf[24] = {0};
-   if(write(i2cfd, &reg, 1) != 1) {
+   if(busops.write(i2cfd, &reg, 1) != 1) {
       printf("Error: I2C write failure for register 0x%02X\n", reg);
    }
 
-   if(read(i2cfd, buf, 24) != 24) {
+   if(busops.read(i2cfd, buf, 24) != 24) {
       printf("Error: I2C read failure for register 0x%02X\n", reg);
    }
 
@@ -842,16 +1008,25 @@ void get_calib(struct bmecal *bmec) {
    bmec->dig_P9 = (buf[22] + buf[23] * 256);
    if(bmec->dig_P9 > 32767) bmec->dig_P9 -= 65536;
 
+   /* ------------------------------------------------------------ *
+    * BMP280 profiles have no humidity calibration registers       *
+    * ------------------------------------------------------------ */
+   if(bmep->humidity == 0) {
+      bmec->dig_H1 = bmec->dig_H2 = bmec->dig_H3 = 0;
+      bmec->dig_H4 = bmec->dig_H5 = bmec->dig_H6 = 0;
+      return;
+   }
+
    /* ------------------------------------------------------------ *
     * convert calibration register data to humidity coefficents    *
     * ------------------------------------------------------------ */
    memset(buf, 0, sizeof(buf)); // clear buf
    reg = BME280_CALIB_25_ADDR;  // register 0xA1
-   if(write(i2cfd, &reg, 1) != 1) {
+   if(busops.write(i2cfd, &reg, 1) != 1) {
       printf("Error: I2C write failure for register 0x%02X\n", reg);
    }
 
-   if(read(i2cfd, buf, 1) != 1) {
+   if(busops.read(i2cfd, buf, 1) != 1) {
       printf("Error: I2C read failure for register 0x%02X\n", reg);
    }
    bmec->dig_H1 = buf[0];
@@ -861,11 +1036,11 @@ void get_calib(struct bmecal *bmec) {
     * ------------------------------------------------------------ */
    memset(buf, 0, sizeof(buf)); // clear buf
    reg = BME280_CALIB_26_ADDR; // register 0xE1
-   if(write(i2cfd, &reg, 1) != 1) {
+   if(busops.write(i2cfd, &reg, 1) != 1) {
       printf("Error: I2C write failure for register 0x%02X\n", reg);
    }
 
-   if(read(i2cfd, buf, 7) != 7) {
+   if(busops.read(i2cfd, buf, 7) != 7) {
       printf("Error: I2C read failure for register 0x%02X\n", reg);
    }
 
@@ -883,14 +1058,37 @@ void get_calib(struct bmecal *bmec) {
    if(bmec->dig_H6 > 127) bmec->dig_H6 -= 256;
 }
 
+/* ------------------------------------------------------------ *
+ * stamp_start() takes the realtime and monotonic clocks at the *
+ * start of a data read, stamp_end() the duration of the read   *
+ * and the next sample number. The realtime clock goes first,   *
+ * the monotonic start is then closest to the read.             *
+ * ------------------------------------------------------------ */
+static uint32_t bmeseq = 0;   // number of the last sample read
+
+void stamp_start(struct bmestamp *st) {
+   struct timespec rt, mono;
+   clock_gettime(CLOCK_REALTIME, &rt);
+   clock_gettime(CLOCK_MONOTONIC, &mono);
+   st->rt_ns = rt.tv_sec * STAMP_NS + rt.tv_nsec;
+   st->mono_ns = mono.tv_sec * STAMP_NS + mono.tv_nsec;
+}
+
+void stamp_end(struct bmestamp *st) {
+   struct timespec mono;
+   clock_gettime(CLOCK_MONOTONIC, &mono);
+   st->lat_ns = (int32_t) (mono.tv_sec * STAMP_NS + mono.tv_nsec - st->mono_ns);
+   st->seq = ++bmeseq;
+}
+
 /* ------------------------------------------------------------ *
  * Get the data readings for Temp, Humidity and Pressure. For   *
  * compensation, make sure get_calib() has been called before.  *
  * ------------------------------------------------------------ */
 void get_data(struct bmecal *bmec, struct bmedata *bmed) {
-   memset(bmed, 0, sizeof &bmed);  // zero out the global data struct
+   memset(bmed, 0, sizeof(*bmed));  // zero out the global data struct
    /* --------------------------------------------------------- *
-    * Read the following 8 bytes from read-only data registers: *
+    * The data registers, up to 8 bytes starting at 0xF7:       *
     * 0xF7 press_msb (pressure msb)                             *
     * 0xF8 press_lsb (pressure lsb)                             *
     * 0xF9 press_xlsb (pressure xlsb, extend result to 20bit)   *
@@ -898,27 +1096,86 @@ void get_data(struct bmecal *bmec, struct bmedata *bmed) {
     * 0xFB temp_lsb (temperature lsb)                           *
     * 0xFC temp_xlsb (temperature xlsb, extend result to 20bit) *
     * 0xFD hum_msb (humidity msb)                               *
-    * 0xFB hum_lsb (humidity lsb)                               *
+    * 0xFE hum_lsb (humidity lsb)                               *
+    * Only the span of the enabled channels is read: it starts  *
+    * at 0xFA with pressure skipped, and ends at 0xFC without   *
+    * humidity. buf always holds the register image from 0xF7.  *
     * --------------------------------------------------------- */
-   char reg = BME280_PRES_DATA_MSB_ADDR; // register 0xF7
+   int chans = *bmechans;
+   if(bmep->humidity == 0) chans &= ~CHAN_H;
+   int first = (chans & CHAN_P) ? 0 : 3;
+   int last = (chans & CHAN_H) ? 8 : 6;
+   char reg = BME280_PRES_DATA_MSB_ADDR + first;
    char buf[8] = {0};
-   if(write(i2cfd, &reg, 1) != 1) {
+   stamp_start(&bmed->st);
+   if(busops.write(i2cfd, &reg, 1) != 1) {
       printf("Error: I2C write failure for register 0x%02X\n", reg);
    }
 
-   if(read(i2cfd, buf, 8) != 8) {
+   if(busops.read(i2cfd, buf + first, last - first) != last - first) {
       printf("Error: I2C read failure for register 0x%02X\n", reg);
    }
+   stamp_end(&bmed->st);
    /* ------------------------------------------------------------ *
     * Convert temperature and pressure data (20 bit)               *
     * ------------------------------------------------------------ */
-   long adc_p = ((long)(buf[0] * 65536 + ((long)(buf[1] * 256) + (long)(buf[2] & 0xF0)))) / 16;
-   long adc_t = ((long)(buf[3] * 65536 + ((long)(buf[4] * 256) + (long)(buf[5] & 0xF0)))) / 16;
+   if(chans & CHAN_P)
+      bmed->adc_p = ((long)(buf[0] * 65536 + ((long)(buf[1] * 256) + (long)(buf[2] & 0xF0)))) / 16;
+   else bmed->adc_p = ADC_P_SKIPPED;
+   if(chans & CHAN_T)
+      bmed->adc_t = ((long)(buf[3] * 65536 + ((long)(buf[4] * 256) + (long)(buf[5] & 0xF0)))) / 16;
+   else bmed->adc_t = ADC_T_SKIPPED;
 
    /* ------------------------------------------------------------ *
     * Convert the humidity data (16 bit)                           *
     * ------------------------------------------------------------ */
-   long adc_h = (buf[6] * 256 + buf[7]);
+   if(chans & CHAN_H) bmed->adc_h = (buf[6] * 256 + buf[7]);
+   else bmed->adc_h = ADC_H_SKIPPED;
+
+   /* ------------------------------------------------------------ *
+    * The skip value in an enabled channel is a legit reading, or  *
+    * the channel was switched off behind our back. Only the osrs  *
+    * registers tell, re-read them before the channel is dropped.  *
+    * ------------------------------------------------------------ */
+   int markers = bme_markers(bmed) & chans;
+   if(markers != 0) {
+      struct bmeinf bmei;
+      if(verbose == 1) printf("Debug: Skip value in channels: [0x%02X]\n", markers);
+      if(bme_snapshot(&bmei) == 0) chans &= *bmechans | ~markers;
+   }
+   bmed->skip = CHAN_ALL & ~chans;
+   if(verbose == 1) printf("Debug: Data read: [0x%02X] [%d bytes] channels [0x%02X]\n",
+                           reg, last - first, chans);
+   compensate(bmec, bmed);
+}
+
+/* ------------------------------------------------------------ *
+ * bme_markers() returns the channels CHAN_* whose adc value is *
+ * the skip value. Only for samples without skip flags, and for *
+ * the check of a fresh read in get_data().                     *
+ * ------------------------------------------------------------ */
+int bme_markers(struct bmedata *bmed) {
+   return (bmed->adc_t == ADC_T_SKIPPED ? CHAN_T : 0)
+        | (bmed->adc_p == ADC_P_SKIPPED ? CHAN_P : 0)
+        | (bmed->adc_h == ADC_H_SKIPPED ? CHAN_H : 0);
+}
+
+/* ------------------------------------------------------------ *
+ * bme_compensate() converts the raw adc_t, adc_p and adc_h     *
+ * values in bmed into temperature, pressure and humidity. It   *
+ * needs no sensor access, so it also works on stored samples.  *
+ * Skipped channels (bmed->skip) are set to NAN, and without    *
+ * temperature, all values are NAN: the others need its t_fine. *
+ * ------------------------------------------------------------ */
+void bme_compensate(struct bmecal *bmec, struct bmedata *bmed) {
+   long adc_p = bmed->adc_p;
+   long adc_t = bmed->adc_t;
+   long adc_h = bmed->adc_h;
+
+   if(bmed->skip & CHAN_T) {
+      bmed->temp_c = bmed->temp_f = bmed->pres_p = bmed->humi_p = NAN;
+      return;
+   }
 
    /* ------------------------------------------------------------ *
     * Temperature offset calculations                              *
@@ -938,25 +1195,33 @@ void get_data(struct bmecal *bmec, struct bmedata *bmed) {
    /* ------------------------------------------------------------ *
     * Pressure offset calculations                                 *
     * ------------------------------------------------------------ */
-   var1 = ((float)t_fine / 2.0) - 64000.0;
-   var2 = var1 * var1 * ((float)bmec->dig_P6) / 32768.0;
-   var2 = var2 + var1 * ((float)bmec->dig_P5) * 2.0;
-   var2 = (var2 / 4.0) + (((float)bmec->dig_P4) * 65536.0);
-   var1 = (((float)bmec->dig_P3) * var1 * var1/524288.0 + ((float)bmec->dig_P2) * var1)/524288.0;
-   var1 = (1.0 + var1 / 32768.0) * ((float)bmec->dig_P1);
-   float p = 1048576.0 - (float)adc_p;
-   p = (p - (var2/4096.0)) * 6250.0/var1;
-   var1 = ((float)bmec->dig_P9) * p * p/2147483648.0;
-   var2 = p * ((float)bmec->dig_P8) / 32768.0;
+   if(bmed->skip & CHAN_P) bmed->pres_p = NAN;
+   else {
+      var1 = ((float)t_fine / 2.0) - 64000.0;
+      var2 = var1 * var1 * ((float)bmec->dig_P6) / 32768.0;
+      var2 = var2 + var1 * ((float)bmec->dig_P5) * 2.0;
+      var2 = (var2 / 4.0) + (((float)bmec->dig_P4) * 65536.0);
+      var1 = (((float)bmec->dig_P3) * var1 * var1/524288.0 + ((float)bmec->dig_P2) * var1)/524288.0;
+      var1 = (1.0 + var1 / 32768.0) * ((float)bmec->dig_P1);
+      float p = 1048576.0 - (float)adc_p;
+      p = (p - (var2/4096.0)) * 6250.0/var1;
+      var1 = ((float)bmec->dig_P9) * p * p/2147483648.0;
+      var2 = p * ((float)bmec->dig_P8) / 32768.0;
 
-   /* ------------------------------------------------------------ *
-    * Pressure in Pascal (divide by 100 to get hPa)                *
-    * ------------------------------------------------------------ */
-   bmed->pres_p = (p + (var1+var2 + ((float)bmec->dig_P7))/16.0);
-   if(verbose == 1) printf("Debug: Pressure: [%.2fPa]\n", bmed->pres_p);
+      /* ------------------------------------------------------------ *
+       * Pressure in Pascal (divide by 100 to get hPa)                *
+       * ------------------------------------------------------------ */
+      bmed->pres_p = (p + (var1+var2 + ((float)bmec->dig_P7))/16.0);
+      if(verbose == 1) printf("Debug: Pressure: [%.2fPa]\n", bmed->pres_p);
+   }
+
+   if(bmed->skip & CHAN_H) {
+      bmed->humi_p = NAN;
+      return;
+   }
 
    /* ------------------------------------------------------------ *
-    * Humidity offset calculations
+    * Humidity offset calculations                                 *
     * ------------------------------------------------------------ */
    float var_H = (((float)t_fine) - 76800.0);
    var_H = (adc_h - (bmec->dig_H4 * 64.0 + bmec->dig_H5 / 16384.0 * var_H)) *
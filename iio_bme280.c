@@ -0,0 +1,343 @@
+/* ------------------------------------------------------------ *
+ * file:        iio_bme280.c                                    *
+ * purpose:     Backend for sensors bound to the Linux kernel   *
+ *              IIO driver (bmp280.ko, also BME280). The driver *
+ *              claims the I2C address, so "-I" reads its IIO   *
+ *              interface instead of /dev/i2c:                  *
+ *                                                              *
+ *              <dir>/in_temp_input               milli *C      *
+ *              <dir>/in_pressure_input           kPa           *
+ *              <dir>/in_humidityrelative_input   milli %       *
+ *                                                              *
+ *              With a trigger, "-c" reads the samples from the *
+ *              buffer chrdev instead, without one syscall per  *
+ *              value. The scan elements are decoded by their   *
+ *              type, e.g. "le:s32/32>>0", and (raw + offset) * *
+ *              scale gives the _input units (IIO sysfs ABI).   *
+ *              The driver compensates the values itself, so no *
+ *              raw adc data is available for "-z".             *
+ *                                                              *
+ *              The sysfs directory and the chrdev are plain    *
+ *              paths, so a fake tree in a temp directory works *
+ *              for tests, with a record file as chrdev, e.g.   *
+ *              -I /tmp/iio,trigger=t0,dev=/tmp/iio/buf.bin     *
+ *                                                              *
+ * author:      10/18/2026 agent                                *
+ * ------------------------------------------------------------ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <endian.h>
+#include "getbme280.h"
+
+extern int verbose;
+
+/* ------------------------------------------------------------ *
+ * IIO channel names and the factor from _input units to the    *
+ * bmedata units *C, % and Pa                                   *
+ * ------------------------------------------------------------ */
+static const char *iio_names[IIO_CHANNELS] = { "temp", "pressure", "humidityrelative" };
+static const double iio_units[IIO_CHANNELS] = { 0.001, 1000.0, 0.001 };
+static const char *iio_labels[IIO_CHANNELS] = { "Temperature", "Pressure", "Humidity" };
+
+/* ------------------------------------------------------------ *
+ * iio_get() reads a sysfs attribute into buf, without the      *
+ * trailing newline. Returns 0, or -1 if it cannot be read.     *
+ * ------------------------------------------------------------ */
+static int iio_get(char *dir, char *attr, char *buf, size_t size) {
+   char path[512];
+   snprintf(path, sizeof(path), "%s/%s", dir, attr);
+   int fd = open(path, O_RDONLY);
+   if(fd < 0) return(-1);
+   ssize_t n = read(fd, buf, size - 1);
+   close(fd);
+   if(n < 0) return(-1);
+   buf[n] = '\0';
+   while(n > 0 && (buf[n-1] == '\n' || buf[n-1] == ' ')) buf[--n] = '\0';
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * iio_put() writes a value into a sysfs attribute              *
+ * ------------------------------------------------------------ */
+static int iio_put(char *dir, char *attr, char *val) {
+   char path[512];
+   snprintf(path, sizeof(path), "%s/%s", dir, attr);
+   int fd = open(path, O_WRONLY | O_TRUNC);
+   if(fd < 0) {
+      printf("Error: cannot write IIO attribute %s.\n", path);
+      return(-1);
+   }
+   ssize_t n = write(fd, val, strlen(val));
+   close(fd);
+   if(n != (ssize_t) strlen(val)) {
+      printf("Error: cannot write IIO attribute %s.\n", path);
+      return(-1);
+   }
+   if(verbose == 1) printf("Debug: IIO write: [%s] = [%s]\n", attr, val);
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * iio_num() reads a numeric sysfs attribute, or returns def    *
+ * ------------------------------------------------------------ */
+static double iio_num(char *dir, char *attr, double def) {
+   char buf[64];
+   if(iio_get(dir, attr, buf, sizeof(buf)) != 0) return def;
+   return atof(buf);
+}
+
+/* ------------------------------------------------------------ *
+ * iio_buffer() enables the scan elements of our channels, and  *
+ * computes the record layout: each element is aligned to its   *
+ * storage size, in scan index order. Returns 0 or -1.          *
+ * ------------------------------------------------------------ */
+static int iio_buffer(struct bmeiio *bmeio) {
+   char attr[128], buf[64];
+
+   if(iio_put(bmeio->dir, "buffer/enable", "0") != 0) return(-1);
+   if(iio_get(bmeio->dir, "scan_elements/in_timestamp_en", buf, sizeof(buf)) == 0
+      && iio_put(bmeio->dir, "scan_elements/in_timestamp_en", "0") != 0) return(-1);
+
+   for(int c = 0; c < IIO_CHANNELS; c++) {
+      struct bmeiioch *ch = &bmeio->ch[c];
+      if(ch->present == 0) continue;
+      snprintf(attr, sizeof(attr), "scan_elements/in_%s_en", iio_names[c]);
+      if(iio_put(bmeio->dir, attr, "1") != 0) return(-1);
+
+      snprintf(attr, sizeof(attr), "scan_elements/in_%s_index", iio_names[c]);
+      ch->index = (int) iio_num(bmeio->dir, attr, -1);
+      snprintf(attr, sizeof(attr), "scan_elements/in_%s_type", iio_names[c]);
+      char endian[3], sign;
+      if(ch->index < 0 || iio_get(bmeio->dir, attr, buf, sizeof(buf)) != 0
+         || sscanf(buf, "%2s:%c%d/%d>>%d", endian, &sign, &ch->bits, &ch->storage, &ch->shift) != 5
+         || (ch->storage != 16 && ch->storage != 32 && ch->storage != 64)) {
+         printf("Error: invalid IIO scan element %s.\n", iio_names[c]);
+         return(-1);
+      }
+      ch->be = (strcmp(endian, "be") == 0);
+      ch->sign = (sign == 's');
+      if(verbose == 1) printf("Debug: IIO scan element: [%s] index [%d] type [%s]\n",
+                              iio_names[c], ch->index, buf);
+   }
+
+   /* ---------------------------------------------------------- *
+    * Record layout in scan index order, the record is padded to *
+    * the largest element, like the kernel does                  *
+    * ---------------------------------------------------------- */
+   int len = 0, align = 1;
+   for(int idx = 0; idx < 64; idx++) {
+      for(int c = 0; c < IIO_CHANNELS; c++) {
+         struct bmeiioch *ch = &bmeio->ch[c];
+         if(ch->present == 0 || ch->index != idx) continue;
+         int bytes = ch->storage / 8;
+         len = (len + bytes - 1) / bytes * bytes;
+         ch->pos = len;
+         len += bytes;
+         if(bytes > align) align = bytes;
+      }
+   }
+   bmeio->reclen = (len + align - 1) / align * align;
+   if(bmeio->reclen > IIO_RECMAX) {
+      printf("Error: IIO record length %d too long.\n", bmeio->reclen);
+      return(-1);
+   }
+
+   if(iio_put(bmeio->dir, "trigger/current_trigger", bmeio->trigger) != 0) return(-1);
+   if(iio_put(bmeio->dir, "buffer/length", "128") != 0) return(-1);
+   if(iio_put(bmeio->dir, "buffer/enable", "1") != 0) return(-1);
+
+   if((bmeio->fd = open(bmeio->dev, O_RDONLY)) < 0) {
+      printf("Error: cannot open IIO buffer %s.\n", bmeio->dev);
+      iio_put(bmeio->dir, "buffer/enable", "0");
+      return(-1);
+   }
+   if(verbose == 1) printf("Debug: IIO buffer: [%s] record [%d bytes]\n", bmeio->dev, bmeio->reclen);
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * iio_open() parses the -I argument "dir[,trigger=name][,dev=  *
+ * path]", and checks the channels of the device. With a        *
+ * trigger, the buffer is set up for iio_read(). Returns 0 or   *
+ * -1 on errors.                                                *
+ * ------------------------------------------------------------ */
+int iio_open(struct bmeiio *bmeio, char *spec, int buffered) {
+   char buf[256], attr[128];
+
+   memset(bmeio, 0, sizeof(*bmeio));
+   bmeio->fd = -1;
+   strncpy(buf, spec, sizeof(buf) - 1);
+   buf[sizeof(buf) - 1] = '\0';
+   char *opt = strtok(buf, ",");
+   strncpy(bmeio->dir, opt, sizeof(bmeio->dir) - 1);
+   while((opt = strtok(NULL, ",")) != NULL) {
+      if(strncmp(opt, "trigger=", 8) == 0)
+         strncpy(bmeio->trigger, opt + 8, sizeof(bmeio->trigger) - 1);
+      else if(strncmp(opt, "dev=", 4) == 0)
+         strncpy(bmeio->dev, opt + 4, sizeof(bmeio->dev) - 1);
+      else {
+         printf("Error: invalid IIO option %s.\n", opt);
+         return(-1);
+      }
+   }
+   if(bmeio->dev[0] == '\0') {
+      char *base = strrchr(bmeio->dir, '/');
+      snprintf(bmeio->dev, sizeof(bmeio->dev), "/dev/%s", base ? base + 1 : bmeio->dir);
+   }
+
+   if(iio_get(bmeio->dir, "name", bmeio->name, sizeof(bmeio->name)) != 0) {
+      printf("Error: no IIO device at %s.\n", bmeio->dir);
+      return(-1);
+   }
+   if(verbose == 1) printf("Debug: IIO device: [%s] name [%s]\n", bmeio->dir, bmeio->name);
+
+   for(int c = 0; c < IIO_CHANNELS; c++) {
+      struct bmeiioch *ch = &bmeio->ch[c];
+      snprintf(attr, sizeof(attr), "in_%s_input", iio_names[c]);
+      ch->present = (iio_get(bmeio->dir, attr, buf, sizeof(buf)) == 0);
+      snprintf(attr, sizeof(attr), "in_%s_scale", iio_names[c]);
+      ch->scale = iio_num(bmeio->dir, attr, 1.0);
+      snprintf(attr, sizeof(attr), "in_%s_offset", iio_names[c]);
+      ch->offset = iio_num(bmeio->dir, attr, 0.0);
+   }
+   if(bmeio->ch[IIO_TEMP].present == 0 || bmeio->ch[IIO_PRES].present == 0) {
+      printf("Error: IIO device %s has no temperature and pressure.\n", bmeio->dir);
+      return(-1);
+   }
+   if(buffered == 1 && bmeio->trigger[0] != '\0') return iio_buffer(bmeio);
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * iio_element() decodes one scan element of a buffer record    *
+ * ------------------------------------------------------------ */
+static double iio_element(struct bmeiioch *ch, uint8_t *rec) {
+   uint64_t v = 0;
+   if(ch->storage == 16) {
+      uint16_t x; memcpy(&x, rec + ch->pos, 2);
+      v = ch->be ? be16toh(x) : le16toh(x);
+   }
+   else if(ch->storage == 32) {
+      uint32_t x; memcpy(&x, rec + ch->pos, 4);
+      v = ch->be ? be32toh(x) : le32toh(x);
+   }
+   else {
+      uint64_t x; memcpy(&x, rec + ch->pos, 8);
+      v = ch->be ? be64toh(x) : le64toh(x);
+   }
+   v >>= ch->shift;
+   if(ch->bits < 64) v &= (1ULL << ch->bits) - 1;
+   int64_t raw = (int64_t) v;
+   if(ch->sign && ch->bits < 64 && (v >> (ch->bits - 1)) & 1) raw -= (int64_t) 1 << ch->bits;
+   return (raw + ch->offset) * ch->scale;
+}
+
+/* ------------------------------------------------------------ *
+ * iio_read() reads one sample, from the buffer if it is set    *
+ * up, or else from the sysfs attributes. Each sysfs read makes *
+ * the driver run a forced conversion. Returns 0 or -1.         *
+ * ------------------------------------------------------------ */
+int iio_read(struct bmeiio *bmeio, struct bmedata *bmed) {
+   double val[IIO_CHANNELS] = { 0, 0, NAN };
+   char attr[128];
+   struct bmestamp st;
+
+   if(bmeio->fd >= 0) {
+      uint8_t rec[IIO_RECMAX];
+      ssize_t got = 0;
+      while(got < bmeio->reclen) {
+         ssize_t n = read(bmeio->fd, rec + got, bmeio->reclen - got);
+         if(n <= 0) {
+            if(n == 0) printf("Error: end of IIO buffer %s.\n", bmeio->dev);
+            else printf("Error: read failure for IIO buffer %s.\n", bmeio->dev);
+            return(-1);
+         }
+         got += n;
+      }
+      /* -- The read waits for the trigger, stamp its return -- */
+      stamp_start(&st);
+      stamp_end(&st);
+      for(int c = 0; c < IIO_CHANNELS; c++) {
+         if(bmeio->ch[c].present) val[c] = iio_element(&bmeio->ch[c], rec);
+      }
+   }
+   else {
+      stamp_start(&st);
+      for(int c = 0; c < IIO_CHANNELS; c++) {
+         if(bmeio->ch[c].present == 0) continue;
+         snprintf(attr, sizeof(attr), "in_%s_input", iio_names[c]);
+         val[c] = iio_num(bmeio->dir, attr, NAN);
+         if(isnan(val[c])) {
+            printf("Error: cannot read IIO attribute %s/%s.\n", bmeio->dir, attr);
+            return(-1);
+         }
+      }
+      stamp_end(&st);
+   }
+
+   memset(bmed, 0, sizeof(*bmed));
+   bmed->st = st;
+   bmed->temp_c = val[IIO_TEMP] * iio_units[IIO_TEMP];
+   bmed->temp_f = bmed->temp_c * 1.8 + 32;
+   bmed->pres_p = val[IIO_PRES] * iio_units[IIO_PRES];
+   bmed->humi_p = val[IIO_HUMI] * iio_units[IIO_HUMI];
+   bmed->adc_h = ADC_H_SKIPPED;
+   if(verbose == 1) printf("Debug: IIO sample: [%.2f*C] [%.2fPa] [%.2f%%]\n",
+                           bmed->temp_c, bmed->pres_p, bmed->humi_p);
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * iio_osrs() sets an oversampling ratio with the -m argument,  *
+ * e.g. "p-16". The IIO driver has no "skip" setting.           *
+ * ------------------------------------------------------------ */
+int iio_osrs(struct bmeiio *bmeio, char *mode) {
+   char attr[128];
+   int c;
+   switch(mode[0]) {
+      case 't': c = IIO_TEMP; break;
+      case 'p': c = IIO_PRES; break;
+      case 'h': c = IIO_HUMI; break;
+      default: return(-1);
+   }
+   if(bmeio->ch[c].present == 0 || strcmp(&mode[2], "skip") == 0) return(-1);
+   snprintf(attr, sizeof(attr), "in_%s_oversampling_ratio", iio_names[c]);
+   return iio_put(bmeio->dir, attr, &mode[2]);
+}
+
+/* ------------------------------------------------------------ *
+ * iio_info() prints the device information for -i              *
+ * ------------------------------------------------------------ */
+void iio_info(struct bmeiio *bmeio) {
+   char attr[128], buf[128];
+   printf("    IIO Device Dir = %s\n", bmeio->dir);
+   printf("   IIO Device Name = %s\n", bmeio->name);
+   printf("        IIO Buffer = %s\n", bmeio->fd >= 0 ? bmeio->dev : "off, sysfs reads");
+   for(int c = 0; c < IIO_CHANNELS; c++) {
+      if(bmeio->ch[c].present == 0) continue;
+      snprintf(attr, sizeof(attr), "in_%s_oversampling_ratio", iio_names[c]);
+      if(iio_get(bmeio->dir, attr, buf, sizeof(buf)) != 0) {
+         printf("%13s Mode = n/a\n", iio_labels[c]);
+         continue;
+      }
+      printf("%13s Mode = %sx oversampling", iio_labels[c], buf);
+      snprintf(attr, sizeof(attr), "in_%s_oversampling_ratio_available", iio_names[c]);
+      if(iio_get(bmeio->dir, attr, buf, sizeof(buf)) == 0) printf(" (%s)", buf);
+      printf("\n");
+   }
+}
+
+/* ------------------------------------------------------------ *
+ * iio_close() disables the buffer and closes the chrdev        *
+ * ------------------------------------------------------------ */
+void iio_close(struct bmeiio *bmeio) {
+   if(bmeio->fd < 0) return;
+   close(bmeio->fd);
+   bmeio->fd = -1;
+   iio_put(bmeio->dir, "buffer/enable", "0");
+}
@@ -0,0 +1,238 @@
+/* ------------------------------------------------------------ *
+ * file:        lock_bme280.c                                   *
+ * purpose:     Bus arbitration between processes, "-L". Each   *
+ *              I2C bus gets a lock file, e.g. for /dev/i2c-1:  *
+ *                                                              *
+ *              /run/lock/bme280-i2c-1.lock    flock held for a *
+ *                                             transaction group*
+ *              /run/lock/bme280-i2c-1.queue   pids of waiting  *
+ *                                             processes, FIFO  *
+ *                                                              *
+ *              flock alone does not wake the waiters in order, *
+ *              so a waiter only tries the bus lock when it is  *
+ *              first in the queue. Waiters of dead processes   *
+ *              are dropped from the queue, and a crashed lock  *
+ *              holder loses its flock with the process. Other  *
+ *              tools that flock the .lock file are excluded as *
+ *              well, they just bypass the queue.               *
+ *                                                              *
+ *              A group is one -t run or -i/-d/-r/settings run, *
+ *              and in -c the setup and each sample. Waits are  *
+ *              bounded by the timeout, and counted for the -v  *
+ *              statistics.                                     *
+ *                                                              *
+ * example:	./getbme280 -t -L 500                           *
+ *                                                              *
+ * author:      10/18/2026 agent                                *
+ * ------------------------------------------------------------ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include "getbme280.h"
+
+extern int verbose;
+extern struct bmesensor sensors[];
+extern int nsensors;
+
+/* ------------------------------------------------------------ *
+ * The lock state of each bus, in the sensor schedule order, so *
+ * all processes lock several buses in the same order           *
+ * ------------------------------------------------------------ */
+static struct bmelock{
+   char *bus;        // bus device, from the sensor list
+   int fd;           // .lock file, flock = the bus is ours
+   int qfd;          // .queue file, flock while it is changed
+} locks[SENSOR_MAX];
+static int nlocks = 0;
+static int lock_on = 0;                // 1 = -L is set
+static int held = 0;                   // 1 = the group holds all bus locks
+static int lock_timeout = LOCK_TIMEOUT; // ms
+static char lock_dir[128] = LOCK_DIR;
+
+/* -- Statistics of the lock waits -- */
+static long lock_groups = 0;   // groups locked
+static long lock_waits = 0;    // groups that had to wait
+static long lock_timeouts = 0; // groups that timed out
+static double lock_wait_sum = 0; // ms
+static double lock_wait_max = 0; // ms
+
+/* ------------------------------------------------------------ *
+ * lock_now() returns the monotonic time in ms                  *
+ * ------------------------------------------------------------ */
+static double lock_now() {
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+/* ------------------------------------------------------------ *
+ * lock_init() parses the -L argument <timeout ms>[:<dir>].     *
+ * Returns 0 or -1 on errors.                                   *
+ * ------------------------------------------------------------ */
+int lock_init(char *spec) {
+   char *end;
+   lock_timeout = strtol(spec, &end, 10);
+   if(end == spec || lock_timeout < 0 || (*end != '\0' && *end != ':')) {
+      printf("Error: invalid lock setting %s, use <timeout ms>[:<dir>].\n", spec);
+      return(-1);
+   }
+   if(*end == ':') {
+      if(strlen(end + 1) == 0 || strlen(end + 1) >= sizeof(lock_dir)) {
+         printf("Error: invalid lock directory in %s.\n", spec);
+         return(-1);
+      }
+      strcpy(lock_dir, end + 1);
+   }
+   if(verbose == 1) printf("Debug: Bus lock timeout: [%dms] dir [%s]\n", lock_timeout, lock_dir);
+   lock_on = 1;
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * lock_file() opens or creates a lock file of a bus, the name  *
+ * is the last part of the bus path. Returns the fd, or -1.     *
+ * ------------------------------------------------------------ */
+static int lock_file(char *bus, char *ext) {
+   char path[512];
+   char *name = strrchr(bus, '/');
+   snprintf(path, sizeof(path), "%s/bme280-%s.%s", lock_dir, name ? name + 1 : bus, ext);
+   int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+   if(fd < 0) printf("Error: cannot open lock file %s.\n", path);
+   return(fd);
+}
+
+/* ------------------------------------------------------------ *
+ * lock_open() opens the lock files of all buses in the sensor  *
+ * list, if -L is set. The statistics are printed at the exit.  *
+ * Returns 0 or -1 on errors.                                   *
+ * ------------------------------------------------------------ */
+int lock_open() {
+   if(lock_on == 0) return(0);
+   atexit(lock_stats);
+   for(int s = 0; s < nsensors; s++) {
+      if(nlocks > 0 && strcmp(locks[nlocks-1].bus, sensors[s].bus) == 0) continue;
+      struct bmelock *lk = &locks[nlocks];
+      lk->bus = sensors[s].bus;
+      if((lk->fd = lock_file(lk->bus, "lock")) < 0) return(-1);
+      if((lk->qfd = lock_file(lk->bus, "queue")) < 0) return(-1);
+      nlocks++;
+   }
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * queue_update() runs one change of the waiting queue under    *
+ * its flock: dead waiters are dropped, op = 1 appends us, and  *
+ * op = -1 removes us. With op = 1 and no live waiters, it      *
+ * tries the bus lock first, and only queues up if it is taken. *
+ * Returns 1 if we are first in the queue (op 0), or hold the   *
+ * bus (op 1), else 0. -1 on errors.                            *
+ * ------------------------------------------------------------ */
+static int queue_update(struct bmelock *lk, int op) {
+   pid_t q[LOCK_QUEUE_MAX + 1];
+   pid_t me = getpid();
+   int res = 0, n = 0;
+
+   if(flock(lk->qfd, LOCK_EX) != 0) return(-1);
+   ssize_t len = pread(lk->qfd, q, sizeof(q) - sizeof(pid_t), 0);
+   if(len < 0) len = 0;
+   for(int i = 0; i < (int) (len / sizeof(pid_t)); i++) {
+      if(q[i] == me && op == -1) continue;
+      if(q[i] != me && kill(q[i], 0) != 0 && errno == ESRCH) continue;
+      q[n++] = q[i];
+   }
+   int changed = (n * sizeof(pid_t) != (size_t) len);
+   if(op == 1) {
+      if(n == 0 && flock(lk->fd, LOCK_EX | LOCK_NB) == 0) res = 1;
+      else if(n < LOCK_QUEUE_MAX) { q[n++] = me; changed = 1; }
+   }
+   else if(op == 0) res = (n > 0 && q[0] == me);
+   if(changed) {
+      if(pwrite(lk->qfd, q, n * sizeof(pid_t), 0) != (ssize_t) (n * sizeof(pid_t))
+         || ftruncate(lk->qfd, n * sizeof(pid_t)) != 0) res = -1;
+   }
+   flock(lk->qfd, LOCK_UN);
+   return(res);
+}
+
+/* ------------------------------------------------------------ *
+ * lock_bus() locks one bus until the deadline, in queue order. *
+ * Returns 0, 1 if it had to wait, or -1 on timeout or errors.  *
+ * ------------------------------------------------------------ */
+static int lock_bus(struct bmelock *lk, double deadline) {
+   int res = queue_update(lk, 1);
+   if(res != 0) return(res == 1 ? 0 : -1);
+
+   useconds_t pause = LOCK_POLL_MIN;
+   while(1) {
+      res = queue_update(lk, 0);
+      if(res == 1 && flock(lk->fd, LOCK_EX | LOCK_NB) == 0) {
+         queue_update(lk, -1);
+         return(1);
+      }
+      if(res < 0 || lock_now() >= deadline) break;
+      usleep(pause);
+      if(pause < LOCK_POLL_MAX) pause *= 2;
+   }
+   queue_update(lk, -1);
+   return(-1);
+}
+
+/* ------------------------------------------------------------ *
+ * bus_lock() starts a transaction group: it locks all buses of *
+ * the sensor list within the -L timeout. Returns 0, or -1 on a *
+ * timeout.                                                     *
+ * ------------------------------------------------------------ */
+int bus_lock() {
+   if(nlocks == 0 || held == 1) return(0);
+   double start = lock_now();
+   double deadline = start + lock_timeout;
+   int waited = 0;
+
+   for(int i = 0; i < nlocks; i++) {
+      int res = lock_bus(&locks[i], deadline);
+      if(res < 0) {
+         printf("Error: bus %s is locked for more than %dms.\n", locks[i].bus, lock_timeout);
+         while(--i >= 0) flock(locks[i].fd, LOCK_UN);
+         lock_timeouts++;
+         return(-1);
+      }
+      waited |= res;
+   }
+   double wait = lock_now() - start;
+   held = 1;
+   lock_groups++;
+   lock_waits += waited;
+   lock_wait_sum += wait;
+   if(wait > lock_wait_max) lock_wait_max = wait;
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * bus_unlock() ends the transaction group. The open mux is     *
+ * closed first, the next process may use another mux, or the   *
+ * same sensor address on another channel.                      *
+ * ------------------------------------------------------------ */
+void bus_unlock() {
+   if(held == 0) return;
+   sensor_release();
+   for(int i = nlocks - 1; i >= 0; i--) flock(locks[i].fd, LOCK_UN);
+   held = 0;
+}
+
+/* ------------------------------------------------------------ *
+ * lock_stats() prints the lock wait statistics with -v         *
+ * ------------------------------------------------------------ */
+void lock_stats() {
+   if(nlocks == 0 || verbose == 0) return;
+   printf("Debug: Bus lock: groups [%ld] waited [%ld] timeouts [%ld] wait avg [%.3fms] max [%.3fms]\n",
+          lock_groups, lock_waits, lock_timeouts,
+          lock_groups > 0 ? lock_wait_sum / lock_groups : 0, lock_wait_max);
+}
@@ -0,0 +1,206 @@
+/* ------------------------------------------------------------ *
+ * file:        mux_bme280.c                                    *
+ * purpose:     Sensors behind TCA9548A I2C multiplexers, and   *
+ *              lists of sensors. "-b" takes a comma separated  *
+ *              list of sensor specs:                           *
+ *                                                              *
+ *              bus[:mux@<addr>:<channel>][/<sensor addr>]      *
+ *                                                              *
+ *              e.g. /dev/i2c-1:mux@0x70:3/0x77 is the sensor   *
+ *              0x77 on channel 3 of the mux at 0x70. Without   *
+ *              the sensor address, "-a" applies. The sensors   *
+ *              are read in bus, mux and channel order, so all  *
+ *              sensors of one channel follow each other. The   *
+ *              selected channel of each bus is cached, and a   *
+ *              channel select is only written when it changes. *
+ *              A mux that is left for another mux on the same  *
+ *              bus is disconnected first, so their channels    *
+ *              never share the bus.                            *
+ *                                                              *
+ * author:      10/18/2026 agent                                *
+ * ------------------------------------------------------------ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "getbme280.h"
+
+extern int verbose;
+extern int i2cfd;
+extern int i2cslave;
+extern struct bmeprof *bmep;
+extern struct bmebusops busops;
+
+/* ------------------------------------------------------------ *
+ * Bus state cache, one entry per opened bus file descriptor    *
+ * ------------------------------------------------------------ */
+static struct bmebus{
+   int fd;           // bus file descriptor
+   int mux;          // mux with an open channel, -1 = none
+   int channel;      // open channel of that mux
+   int slave;        // current I2C_SLAVE address, -1 = unknown
+} buses[SENSOR_MAX];
+static int nbuses = 0;
+long mux_writes = 0;  // channel select writes, for the debug output
+
+/* ------------------------------------------------------------ *
+ * sensor_parse() splits the -b list into sensor specs, with    *
+ * defaddr as sensor address if a spec has none. Returns the    *
+ * number of sensors, or -1 on errors.                          *
+ * ------------------------------------------------------------ */
+int sensor_parse(char *list, char *defaddr, struct bmesensor *bmes, int max) {
+   char buf[SENSOR_LISTLEN];
+   int n = 0;
+
+   strncpy(buf, list, sizeof(buf) - 1);
+   buf[sizeof(buf) - 1] = '\0';
+   for(char *spec = strtok(buf, ","); spec != NULL; spec = strtok(NULL, ",")) {
+      if(n == max) {
+         printf("Error: more than %d sensors in %s.\n", max, list);
+         return(-1);
+      }
+      struct bmesensor *s = &bmes[n];
+      memset(s, 0, sizeof(*s));
+      strncpy(s->spec, spec, sizeof(s->spec) - 1);
+      s->fd = -1;
+      s->mux = -1;
+      s->chans = CHAN_ALL;
+
+      char *addr = strrchr(spec, '/');
+      if(addr != NULL && strncmp(addr, "/0x", 3) == 0) *addr++ = '\0';
+      else addr = defaddr;
+      s->addr = (int) strtol(addr, NULL, 16);
+
+      char *mux = strstr(spec, ":mux@");
+      if(mux != NULL) {
+         *mux = '\0';
+         if(sscanf(mux + 5, "%i:%d", &s->mux, &s->channel) != 2
+            || s->mux < 0x70 || s->mux > 0x77 || s->channel < 0 || s->channel > 7) {
+            printf("Error: invalid mux setting in %s, use :mux@0x70:<0..7>.\n", s->spec);
+            return(-1);
+         }
+      }
+      if(s->addr < 0x03 || s->addr > 0x77 || s->addr == s->mux) {
+         printf("Error: invalid sensor address in %s.\n", s->spec);
+         return(-1);
+      }
+      strncpy(s->bus, spec, sizeof(s->bus) - 1);
+      n++;
+   }
+   if(n == 0) printf("Error: no sensor in %s.\n", list);
+   return(n > 0 ? n : -1);
+}
+
+/* ------------------------------------------------------------ *
+ * sensor_cmp() is the read order: by bus, mux, channel, addr.  *
+ * Sensors without mux come first, they need no channel select. *
+ * ------------------------------------------------------------ */
+static int sensor_cmp(const void *a, const void *b) {
+   const struct bmesensor *sa = a, *sb = b;
+   int res = strcmp(sa->bus, sb->bus);
+   if(res == 0) res = sa->mux - sb->mux;
+   if(res == 0) res = sa->channel - sb->channel;
+   if(res == 0) res = sa->addr - sb->addr;
+   return res;
+}
+
+/* ------------------------------------------------------------ *
+ * sensor_schedule() sorts the sensors into read order, so that *
+ * a pass over all sensors writes each channel select once      *
+ * ------------------------------------------------------------ */
+void sensor_schedule(struct bmesensor *bmes, int n) {
+   qsort(bmes, n, sizeof(*bmes), sensor_cmp);
+   for(int i = 1; i < n; i++) {
+      if(sensor_cmp(&bmes[i-1], &bmes[i]) == 0) {
+         printf("Error: sensor %s is listed twice.\n", bmes[i].spec);
+         exit(-1);
+      }
+   }
+}
+
+/* ------------------------------------------------------------ *
+ * bus_state() returns the cache entry of a bus file descriptor *
+ * ------------------------------------------------------------ */
+static struct bmebus *bus_state(int fd) {
+   for(int i = 0; i < nbuses; i++) {
+      if(buses[i].fd == fd) return &buses[i];
+   }
+   buses[nbuses] = (struct bmebus) { fd, -1, 0, -1 };
+   return &buses[nbuses++];
+}
+
+/* ------------------------------------------------------------ *
+ * mux_write() writes a channel mask into a mux control reg     *
+ * ------------------------------------------------------------ */
+static int mux_write(struct bmebus *bus, int mux, uint8_t mask) {
+   if(busops.slave(bus->fd, mux) != 0 || busops.write(bus->fd, &mask, 1) != 1) {
+      printf("Error: I2C write failure for mux [0x%02X].\n", mux);
+      bus->slave = -1;
+      return(-1);
+   }
+   bus->slave = mux;
+   mux_writes++;
+   if(verbose == 1) printf("Debug: Mux 0x%02X channel mask: [0x%02X]\n", mux, mask);
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * sensor_select() makes a sensor the target of all register    *
+ * functions: it sets the bus, the mux channel, the I2C slave   *
+ * address, the driver profile and the enabled channels.        *
+ * Returns 0 or -1 on errors.                                   *
+ * ------------------------------------------------------------ */
+int sensor_select(struct bmesensor *s) {
+   struct bmebus *bus = bus_state(s->fd);
+
+   if(bus->mux != s->mux || (s->mux >= 0 && bus->channel != s->channel)) {
+      /* ------------------------------------------------------- *
+       * Disconnect the open mux first if it is another one, or  *
+       * if the sensor sits on the bus itself                    *
+       * ------------------------------------------------------- */
+      if(bus->mux >= 0 && bus->mux != s->mux) {
+         if(mux_write(bus, bus->mux, 0x00) != 0) return(-1);
+         bus->mux = -1;
+      }
+      if(s->mux >= 0) {
+         if(mux_write(bus, s->mux, 1 << s->channel) != 0) return(-1);
+         bus->mux = s->mux;
+         bus->channel = s->channel;
+      }
+   }
+   if(bus->slave != s->addr) {
+      if(busops.slave(s->fd, s->addr) != 0) {
+         printf("Error can't find sensor at address [0x%02X].\n", s->addr);
+         return(-1);
+      }
+      bus->slave = s->addr;
+   }
+   i2cfd = s->fd;
+   i2cslave = s->addr;
+   if(s->prof != NULL) bmep = s->prof;
+   bmechans = &s->chans;
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * sensor_release() closes the open muxes of all buses, so the  *
+ * next process that locks the bus finds no channel connected,  *
+ * see lock_bme280.c. The next select opens the channel again.  *
+ * ------------------------------------------------------------ */
+void sensor_release() {
+   for(int i = 0; i < nbuses; i++) {
+      if(buses[i].mux >= 0 && mux_write(&buses[i], buses[i].mux, 0x00) == 0) buses[i].mux = -1;
+      buses[i].channel = -1;
+   }
+}
+
+/* ------------------------------------------------------------ *
+ * sensor_fd() returns the open file descriptor of a bus, if an *
+ * earlier sensor in the list uses the same bus, or -1          *
+ * ------------------------------------------------------------ */
+int sensor_fd(struct bmesensor *bmes, int n, char *bus) {
+   for(int i = 0; i < n; i++) {
+      if(bmes[i].fd >= 0 && strcmp(bmes[i].bus, bus) == 0) return bmes[i].fd;
+   }
+   return(-1);
+}
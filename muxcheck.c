@@ -0,0 +1,203 @@
+/* ------------------------------------------------------------ *
+ * file:        muxcheck.c                                      *
+ * purpose:     Checks the sensor list and mux code of          *
+ *              mux_bme280.c without hardware: the -b parser,   *
+ *              the read order of sensor_schedule(), and the    *
+ *              channel select cache of sensor_select(). The    *
+ *              bus access goes to a fake bus, which records    *
+ *              each I2C_SLAVE switch and write as "S70 W01",   *
+ *              and the record is compared with the expected    *
+ *              transfers.                                      *
+ *                                                              *
+ * return:      0 if all checks pass, and -1 on failures.       *
+ *                                                              *
+ * example:	make check                                      *
+ *                                                              *
+ * author:      10/18/2026 agent                                *
+ * ------------------------------------------------------------ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "getbme280.h"
+
+/* ------------------------------------------------------------ *
+ * Global variables and defaults                                *
+ * ------------------------------------------------------------ */
+int verbose = 0;           // debug output of mux_bme280.c, stays off
+extern int i2cfd;
+extern int i2cslave;
+extern struct bmebusops busops;
+
+static char trace[1024];   // transfers on the fake bus
+static int fail_write = 0; // 1 = the next write fails
+static int failed = 0;     // number of failed checks
+
+/* ------------------------------------------------------------ *
+ * The fake bus, it only records the transfers                  *
+ * ------------------------------------------------------------ */
+static void trace_add(char op, int val) {
+   int n = strlen(trace);
+   snprintf(trace + n, sizeof(trace) - n, "%s%c%02X", n ? " " : "", op, val);
+}
+
+static int fake_slave(int fd, int addr) {
+   trace_add('S', addr);
+   return(0);
+}
+
+static int fake_write(int fd, void *buf, int len) {
+   if(fail_write == 1) { fail_write = 0; return(-1); }
+   for(int i = 0; i < len; i++) trace_add('W', ((uint8_t *) buf)[i]);
+   return(len);
+}
+
+/* ------------------------------------------------------------ *
+ * check() counts and prints a failed check                     *
+ * ------------------------------------------------------------ */
+static void check(int ok, const char *what) {
+   if(ok) return;
+   printf("FAIL: %s\n", what);
+   failed++;
+}
+
+/* ------------------------------------------------------------ *
+ * check_select() selects a sensor on the fake bus, and checks  *
+ * the recorded transfers                                       *
+ * ------------------------------------------------------------ */
+static void check_select(struct bmesensor *s, const char *expect) {
+   char what[512];
+   trace[0] = '\0';
+   int res = sensor_select(s);
+   snprintf(what, sizeof(what), "select %s: got \"%s\", expected \"%s\"",
+            s->spec, trace, expect);
+   check(res == 0 && strcmp(trace, expect) == 0, what);
+   check(i2cfd == s->fd && i2cslave == s->addr && bmechans == &s->chans,
+         "select sets i2cfd, i2cslave and bmechans");
+}
+
+/* ------------------------------------------------------------ *
+ * sensor_parse() of valid and invalid lists                    *
+ * ------------------------------------------------------------ */
+static void check_parse() {
+   struct bmesensor s[SENSOR_MAX];
+
+   int n = sensor_parse("/dev/i2c-1:mux@0x70:3/0x77,/dev/i2c-1", "0x76", s, SENSOR_MAX);
+   check(n == 2, "parse two sensors");
+   check(strcmp(s[0].bus, "/dev/i2c-1") == 0 && s[0].mux == 0x70
+         && s[0].channel == 3 && s[0].addr == 0x77, "parse mux spec");
+   check(strcmp(s[1].bus, "/dev/i2c-1") == 0 && s[1].mux == -1
+         && s[1].addr == 0x76, "parse default address");
+   check(s[0].fd == -1 && s[0].chans == CHAN_ALL, "parse defaults");
+   check(strcmp(s[0].spec, "/dev/i2c-1:mux@0x70:3/0x77") == 0, "parse keeps spec");
+
+   /* -- The invalid lists print their error message -- */
+   printf("Expected errors:\n");
+   check(sensor_parse("/dev/i2c-1:mux@0x70:8", "0x76", s, SENSOR_MAX) == -1, "reject channel 8");
+   check(sensor_parse("/dev/i2c-1:mux@0x80:0", "0x76", s, SENSOR_MAX) == -1, "reject mux 0x80");
+   check(sensor_parse("/dev/i2c-1:mux@0x70:0/0x70", "0x76", s, SENSOR_MAX) == -1, "reject addr = mux");
+   check(sensor_parse("/dev/i2c-1/0x78", "0x76", s, SENSOR_MAX) == -1, "reject addr 0x78");
+   check(sensor_parse("/dev/i2c-1,/dev/i2c-1/0x77", "0x76", s, 1) == -1, "reject too many sensors");
+   check(sensor_parse(",", "0x76", s, SENSOR_MAX) == -1, "reject empty list");
+   printf("\n");
+}
+
+/* ------------------------------------------------------------ *
+ * sensor_schedule() read order: bus, mux, channel, address,    *
+ * sensors without mux first                                    *
+ * ------------------------------------------------------------ */
+static void check_schedule() {
+   struct bmesensor s[SENSOR_MAX];
+   static const char *order[] = {
+      "/dev/i2c-0/0x77",
+      "/dev/i2c-1",
+      "/dev/i2c-1:mux@0x70:0",
+      "/dev/i2c-1:mux@0x70:0/0x77",
+      "/dev/i2c-1:mux@0x70:5",
+      "/dev/i2c-1:mux@0x71:1",
+   };
+
+   int n = sensor_parse("/dev/i2c-1:mux@0x71:1,/dev/i2c-1:mux@0x70:5,"
+                        "/dev/i2c-1:mux@0x70:0/0x77,/dev/i2c-1,"
+                        "/dev/i2c-1:mux@0x70:0,/dev/i2c-0/0x77", "0x76", s, SENSOR_MAX);
+   check(n == 6, "parse schedule list");
+   sensor_schedule(s, n);
+   for(int i = 0; i < n; i++) {
+      char what[512];
+      snprintf(what, sizeof(what), "schedule position %d: got %.200s, expected %s",
+               i, s[i].spec, order[i]);
+      check(strcmp(s[i].spec, order[i]) == 0, what);
+   }
+}
+
+/* ------------------------------------------------------------ *
+ * sensor_select() channel cache on one bus with two muxes      *
+ * ------------------------------------------------------------ */
+static void check_cache() {
+   struct bmesensor s[SENSOR_MAX];
+
+   int n = sensor_parse("/dev/i2c-1:mux@0x70:0,/dev/i2c-1:mux@0x70:0/0x77,"
+                        "/dev/i2c-1:mux@0x70:5,/dev/i2c-1:mux@0x71:1,"
+                        "/dev/i2c-1", "0x76", s, SENSOR_MAX);
+   check(n == 5, "parse cache list");
+   for(int i = 0; i < n; i++) s[i].fd = 10; // one shared bus
+
+   check_select(&s[0], "S70 W01 S76");          // open channel 0
+   check_select(&s[0], "");                     // all cached
+   check_select(&s[1], "S77");                  // same channel
+   check_select(&s[2], "S70 W20 S76");          // channel 5, same mux
+   check_select(&s[3], "S70 W00 S71 W02 S76");  // close 0x70 first
+   check_select(&s[4], "S71 W00 S76");          // sensor on the bus
+   check_select(&s[4], "");
+   check_select(&s[3], "S71 W02 S76");
+
+   /* -- A failed write forgets the slave address, and retries -- */
+   fail_write = 1;
+   trace[0] = '\0';
+   printf("Expected error:\n");
+   check(sensor_select(&s[2]) == -1, "select fails on a failed write");
+   printf("\n");
+   check_select(&s[2], "S71 W00 S70 W20 S76");
+
+   /* -- A second bus has its own cache -- */
+   struct bmesensor other = s[0];
+   other.fd = 11;
+   check_select(&other, "S70 W01 S76");
+   check_select(&s[2], "");
+
+   /* -- sensor_release() at a -L bus unlock closes the muxes -- */
+   trace[0] = '\0';
+   sensor_release();
+   check(strcmp(trace, "S70 W00 S70 W00") == 0, "release closes the mux of both buses");
+   check_select(&s[2], "S70 W20 S76");
+   check_select(&s[2], "");
+}
+
+/* ------------------------------------------------------------ *
+ * sensor_fd() shares the file descriptor of a bus              *
+ * ------------------------------------------------------------ */
+static void check_fd() {
+   struct bmesensor s[SENSOR_MAX];
+
+   int n = sensor_parse("/dev/i2c-1,/dev/i2c-1/0x77,/dev/i2c-2", "0x76", s, SENSOR_MAX);
+   s[0].fd = 20;
+   check(sensor_fd(s, n, "/dev/i2c-1") == 20, "share the open bus");
+   check(sensor_fd(s, n, "/dev/i2c-2") == -1, "no open bus");
+}
+
+int main() {
+   busops.slave = fake_slave;
+   busops.write = fake_write;
+
+   check_parse();
+   check_schedule();
+   check_cache();
+   check_fd();
+
+   if(failed > 0) {
+      printf("Error: %d mux checks failed.\n", failed);
+      exit(-1);
+   }
+   printf("All mux checks passed.\n");
+   exit(0);
+}
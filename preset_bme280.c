@@ -0,0 +1,149 @@
+/* ------------------------------------------------------------ *
+ * file:        preset_bme280.c                                 *
+ * purpose:     Recommended sensor modes of the BME280 data-    *
+ *              sheet chapter 3.5 as named presets for "-P",    *
+ *              and the timing model of datasheet chapter 9:    *
+ *              measurement time, output data rate (ODR), IIR   *
+ *              filter bandwidth and average supply current for *
+ *              a sensor configuration.                         *
+ *                                                              *
+ * author:      10/18/2026 agent                                *
+ * ------------------------------------------------------------ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "getbme280.h"
+
+extern int verbose;
+
+/* ------------------------------------------------------------ *
+ * Datasheet recommended modes of operation. Forced mode modes  *
+ * leave the sensor in sleep, the host triggers conversions at  *
+ * the given rate, e.g. with "-t" from cron.                    *
+ * ------------------------------------------------------------ */
+static struct bmepreset presets[] = {
+   { "weather",  "1", "1",    "1",    "off", "0.5", forced, 1.0/60 },
+   { "humidity", "1", "skip", "1",    "off", "0.5", forced, 1.0    },
+   { "indoor",   "2", "16",   "1",    "16",  "0.5", normal, 0      },
+   { "gaming",   "1", "4",    "skip", "16",  "0.5", normal, 0      },
+};
+
+/* ------------------------------------------------------------ *
+ * Oversampling register codes to sample count, IIR filter      *
+ * codes to bandwidth per ODR (datasheet table 6), and standby  *
+ * codes to ms.                                                 *
+ * ------------------------------------------------------------ */
+static const int osrs_n[]      = { 0, 1, 2, 4, 8, 16, 16, 16 };
+static const float filter_bw[] = { 0, 0.223, 0.092, 0.042, 0.021, 0.021, 0.021, 0.021 };
+static const float stby_ms[]   = { 0.5, 62.5, 125, 250, 500, 1000, 10, 20 };
+
+/* -- The register codes as -m, -f and -s arguments -- */
+char *osrs_args[]   = { "skip", "1", "2", "4", "8", "16", "16", "16" };
+char *filter_args[] = { "off", "2", "4", "8", "16", "16", "16", "16" };
+char *stby_args[]   = { "0.5", "62.5", "125", "250", "500", "1000", "10", "20" };
+
+/* ------------------------------------------------------------ *
+ * Supply current in uA while measuring temperature, pressure   *
+ * and humidity, and in sleep and standby (datasheet table 2).  *
+ * ------------------------------------------------------------ */
+#define IDD_T      350.0
+#define IDD_P      714.0
+#define IDD_H      340.0
+#define IDD_SL       0.1
+#define IDD_SB       0.2
+
+/* ------------------------------------------------------------ *
+ * get_preset() returns the preset with the given name, or NULL *
+ * ------------------------------------------------------------ */
+struct bmepreset *get_preset(char *name) {
+   for(size_t i = 0; i < sizeof(presets) / sizeof(presets[0]); i++) {
+      if(strcmp(presets[i].name, name) == 0) return &presets[i];
+   }
+   return NULL;
+}
+
+/* ------------------------------------------------------------ *
+ * set_preset() applies a preset as one configuration. Config   *
+ * register writes are only reliable in sleep mode, so the      *
+ * sensor is put to sleep first. Returns 0 or -1 on errors.     *
+ * ------------------------------------------------------------ */
+int set_preset(struct bmepreset *bmpr) {
+   int res = 0;
+
+   if(verbose == 1) printf("Debug: Apply preset: [%s]\n", bmpr->name);
+   res |= set_power(psleep);
+   if(bmep->humidity == 1) res |= set_h_osrs(bmpr->osrs_h);
+   res |= set_t_osrs(bmpr->osrs_t);
+   res |= set_p_osrs(bmpr->osrs_p);
+   res |= set_filter(bmpr->filter);
+   res |= set_stby(bmpr->stby);
+   if(bmpr->mode == normal) res |= set_power(normal);
+   return(res == 0 ? 0 : -1);
+}
+
+/* ------------------------------------------------------------ *
+ * set_config() writes back a configuration from bme_snapshot() *
+ * e.g. after a test run. Forced mode returns as sleep mode.    *
+ * Returns 0 or -1 on errors.                                   *
+ * ------------------------------------------------------------ */
+int set_config(struct bmeinf *bmei) {
+   struct bmepreset bmpr = { "restore",
+      osrs_args[bmei->osrs_t_mode & 0x07], osrs_args[bmei->osrs_p_mode & 0x07],
+      osrs_args[bmei->osrs_h_mode & 0x07], filter_args[bmei->filter_mode & 0x07],
+      stby_args[bmei->stby_time & 0x07], bmei->power_mode == normal ? normal : psleep, 0 };
+   return(set_preset(&bmpr));
+}
+
+/* ------------------------------------------------------------ *
+ * bme_timing() computes the timing model for a configuration.  *
+ * In normal mode the ODR follows from measurement and standby  *
+ * time. In forced and sleep mode the host sets the ODR, given  *
+ * as rate in Hz. Measurement time (datasheet chapter 9.1):     *
+ * typ = 1 + 2*osrs_t + (2*osrs_p + 0.5) + (2*osrs_h + 0.5) ms  *
+ * max = 1.25 + 2.3*osrs_t + (2.3*osrs_p + 0.575)               *
+ *            + (2.3*osrs_h + 0.575) ms                         *
+ * ------------------------------------------------------------ */
+void bme_timing(struct bmeinf *bmei, float rate, struct bmetime *bmet) {
+   int t = osrs_n[bmei->osrs_t_mode & 0x07];
+   int p = osrs_n[bmei->osrs_p_mode & 0x07];
+   int h = osrs_n[bmei->osrs_h_mode & 0x07];
+
+   float ms_t = 2.0 * t;
+   float ms_p = p ? 2.0 * p + 0.5 : 0;
+   float ms_h = h ? 2.0 * h + 0.5 : 0;
+   bmet->meas_typ = 1.0 + ms_t + ms_p + ms_h;
+   bmet->meas_max = 1.25 + 2.3 * t + (p ? 2.3 * p + 0.575 : 0) + (h ? 2.3 * h + 0.575 : 0);
+
+   bmet->normal = (bmei->power_mode == normal);
+   bmet->odr_max = 1000.0 / bmet->meas_max;
+   if(bmet->normal) bmet->odr = 1000.0 / (bmet->meas_typ + stby_ms[bmei->stby_time & 0x07]);
+   else bmet->odr = rate < bmet->odr_max ? rate : bmet->odr_max;
+
+   bmet->bandw = filter_bw[bmei->filter_mode & 0x07] * bmet->odr;
+
+   /* ---------------------------------------------------------- *
+    * Average current: charge per measurement times ODR, plus    *
+    * standby (normal mode) or sleep current between them        *
+    * ---------------------------------------------------------- */
+   float charge = ms_t * IDD_T + ms_p * IDD_P + ms_h * IDD_H;   // uA*ms
+   float busy = bmet->meas_typ * bmet->odr / 1000.0;            // duty cycle
+   bmet->current = charge * bmet->odr / 1000.0
+                 + (1.0 - busy) * (bmet->normal ? IDD_SB : IDD_SL);
+}
+
+/* ------------------------------------------------------------ *
+ * print_timing() prints the timing model in the -i layout      *
+ * ------------------------------------------------------------ */
+void print_timing(struct bmetime *bmet) {
+   printf("  Measurement Time = %.2fms typ, %.2fms max\n", bmet->meas_typ, bmet->meas_max);
+   if(bmet->normal)
+      printf("  Output Data Rate = %.2fHz\n", bmet->odr);
+   else
+      printf("  Output Data Rate = %.4gHz host triggered, max %.2fHz\n", bmet->odr, bmet->odr_max);
+   if(bmet->bandw > 0)
+      printf("  Filter Bandwidth = %.3gHz\n", bmet->bandw);
+   else
+      printf("  Filter Bandwidth = full (filter off)\n");
+   printf("   Average Current = %.3guA\n", bmet->current);
+}
@@ -0,0 +1,411 @@
+/* ------------------------------------------------------------ *
+ * file:        push_bme280.c                                   *
+ * purpose:     Datagram push of "-c" samples to a collector.   *
+ *              "-U" sends each sample, or each window average, *
+ *              as one fixed 72 byte version 2 datagram (struct *
+ *              bmedgram, BMED_SIZE) over UDP or a Unix         *
+ *              datagram socket:                                *
+ *                                                              *
+ *              udp:<host>:<port>[,id=<n>][,window=<sec>]       *
+ *              unix:<path>[,id=<n>][,window=<sec>]             *
+ *                                                              *
+ *              All fields are big-endian integers: the sensor  *
+ *              id, a sequence number per sender for loss       *
+ *              detection, the raw adc values and the fixed     *
+ *              point compensated values. The datagrams are     *
+ *              sent from the sink thread, with MSG_DONTWAIT,   *
+ *              so a slow network never delays the sensor.      *
+ *                                                              *
+ *              The "listen" subcommand receives and prints the *
+ *              datagrams, for tests and as collector example.  *
+ *              It still accepts the 48 byte version 1 layout   *
+ *              (BMED_SIZE_V1), without the read timestamps.    *
+ *                                                              *
+ * example:     ./getbme280 -c -U udp:collector:5280,id=17      *
+ *              ./getbme280 listen udp:5280                     *
+ *                                                              *
+ * author:      10/18/2026 agent                                *
+ * ------------------------------------------------------------ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <endian.h>
+#include <math.h>
+#include <signal.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "getbme280.h"
+
+extern int verbose;
+
+_Static_assert(sizeof(struct bmedgram) == BMED_SIZE, "bmedgram layout");
+
+/* ------------------------------------------------------------ *
+ * push_addr() resolves "udp:<host>:<port>", "udp:<port>" (the  *
+ * local host) or "unix:<path>" into a socket address. bind = 1 *
+ * gives the listening address. Returns the socket type family, *
+ * or -1 on errors.                                             *
+ * ------------------------------------------------------------ */
+static int push_addr(char *dest, int bind, struct sockaddr_storage *sa, socklen_t *salen) {
+   memset(sa, 0, sizeof(*sa));
+   if(strncmp(dest, "unix:", 5) == 0) {
+      struct sockaddr_un *su = (struct sockaddr_un *) sa;
+      if(strlen(dest + 5) == 0 || strlen(dest + 5) >= sizeof(su->sun_path)) {
+         printf("Error: invalid socket path in %s.\n", dest);
+         return(-1);
+      }
+      su->sun_family = AF_UNIX;
+      strncpy(su->sun_path, dest + 5, sizeof(su->sun_path) - 1);
+      *salen = sizeof(*su);
+      return(AF_UNIX);
+   }
+   if(strncmp(dest, "udp:", 4) != 0) {
+      printf("Error: invalid destination %s, use udp:<host>:<port> or unix:<path>.\n", dest);
+      return(-1);
+   }
+
+   /* ---------------------------------------------------------- *
+    * The port follows the last ':', IPv6 hosts go in brackets   *
+    * ---------------------------------------------------------- */
+   char host[256] = {0};
+   char *port = strrchr(dest + 4, ':');
+   if(port == NULL) port = dest + 4;
+   else {
+      size_t len = port - (dest + 4);
+      if(len >= sizeof(host)) len = sizeof(host) - 1;
+      memcpy(host, dest + 4, len);
+      port++;
+   }
+   if(host[0] == '[' && host[strlen(host) - 1] == ']') {
+      memmove(host, host + 1, strlen(host));
+      host[strlen(host) - 1] = '\0';
+   }
+
+   struct addrinfo hints, *res;
+   memset(&hints, 0, sizeof(hints));
+   hints.ai_family = AF_UNSPEC;
+   hints.ai_socktype = SOCK_DGRAM;
+   if(bind == 1) hints.ai_flags = AI_PASSIVE;
+   if(getaddrinfo(host[0] ? host : NULL, port, &hints, &res) != 0) {
+      printf("Error: cannot resolve %s.\n", dest);
+      return(-1);
+   }
+   memcpy(sa, res->ai_addr, res->ai_addrlen);
+   *salen = res->ai_addrlen;
+   int family = res->ai_family;
+   freeaddrinfo(res);
+   return(family);
+}
+
+/* ------------------------------------------------------------ *
+ * push_connect() returns a datagram socket connected to dest,  *
+ * "udp:<host>:<port>" or "unix:<path>", or -1 on errors        *
+ * ------------------------------------------------------------ */
+int push_connect(char *dest) {
+   struct sockaddr_storage sa;
+   socklen_t salen;
+
+   int family = push_addr(dest, 0, &sa, &salen);
+   if(family < 0) return(-1);
+   int fd = socket(family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+   if(fd < 0 || connect(fd, (struct sockaddr *) &sa, salen) != 0) {
+      printf("Error: cannot connect the datagram socket to %s.\n", dest);
+      if(fd >= 0) close(fd);
+      return(-1);
+   }
+   return(fd);
+}
+
+/* ------------------------------------------------------------ *
+ * push_open() parses the -U argument and opens the datagram    *
+ * socket. Without id=, the sensor id is the host id. Returns 0 *
+ * or -1 on errors.                                             *
+ * ------------------------------------------------------------ */
+int push_open(struct bmepush *bmpu, char *spec) {
+   char buf[256];
+
+   memset(bmpu, 0, sizeof(*bmpu));
+   bmpu->fd = -1;
+   bmpu->id = (uint32_t) gethostid();
+   strncpy(buf, spec, sizeof(buf) - 1);
+   buf[sizeof(buf) - 1] = '\0';
+   char *dest = strtok(buf, ",");
+   char *opt;
+   while((opt = strtok(NULL, ",")) != NULL) {
+      if(strncmp(opt, "id=", 3) == 0)
+         bmpu->id = (uint32_t) strtoul(opt + 3, NULL, 0);
+      else if(strncmp(opt, "window=", 7) == 0 && atoi(opt + 7) > 0)
+         bmpu->window = atoi(opt + 7);
+      else {
+         printf("Error: invalid push option %s.\n", opt);
+         return(-1);
+      }
+   }
+   if(dest == NULL) {
+      printf("Error: no push destination in %s.\n", spec);
+      return(-1);
+   }
+
+   if((bmpu->fd = push_connect(dest)) < 0) return(-1);
+   if(verbose == 1) printf("Debug: Push destination: [%s] id [0x%08X] window [%ds]\n",
+                           dest, bmpu->id, bmpu->window);
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * push_fixed() converts a value to fixed point, 0 if it is NAN *
+ * ------------------------------------------------------------ */
+static uint32_t push_fixed(double val, double scale) {
+   if(isnan(val)) return 0;
+   return htobe32((uint32_t) (int32_t) lround(val * scale));
+}
+
+/* ------------------------------------------------------------ *
+ * push_send() sends the open window, or the single sample      *
+ * ------------------------------------------------------------ */
+static void push_send(struct bmepush *bmpu) {
+   struct bmedgram dg;
+   struct bmedata *last = &bmpu->last;
+   int n = bmpu->count;
+
+   dg.magic   = htobe16(BMED_MAGIC);
+   dg.version = BMED_VERSION;
+   dg.flags   = (isnan(bmpu->sum_t) ? 0 : BMED_T) | (isnan(bmpu->sum_p) ? 0 : BMED_P)
+              | (isnan(bmpu->sum_h) ? 0 : BMED_H) | (bmpu->window > 0 ? BMED_WINDOW : 0);
+   dg.id      = htobe32(bmpu->id);
+   dg.seq     = htobe32(bmpu->seq);
+   dg.count   = htobe32((uint32_t) n);
+   dg.ts      = htobe64((uint64_t) bmpu->start);
+   dg.adc_t   = htobe32((uint32_t) last->adc_t);
+   dg.adc_p   = htobe32((uint32_t) last->adc_p);
+   dg.adc_h   = htobe32((uint32_t) last->adc_h);
+   dg.temp    = push_fixed(bmpu->sum_t / n, 100.0);
+   dg.pres    = push_fixed(bmpu->sum_p / n, 100.0);
+   dg.humi    = push_fixed(bmpu->sum_h / n, 1000.0);
+   dg.rt_ns   = htobe64((uint64_t) last->st.rt_ns);
+   dg.mono_ns = htobe64((uint64_t) last->st.mono_ns);
+   dg.lat_ns  = htobe32((uint32_t) last->st.lat_ns);
+   dg.rseq    = htobe32(last->st.seq);
+
+   if(send(bmpu->fd, &dg, sizeof(dg), MSG_DONTWAIT) == sizeof(dg)) bmpu->sent++;
+   else bmpu->failed++;
+   bmpu->seq++;
+   bmpu->count = 0;
+}
+
+/* ------------------------------------------------------------ *
+ * push_put() sends one sample, or adds it to the open window.  *
+ * A window is sent with the first sample after its end, so the *
+ * average of a window of 60s covers the samples of 60s.        *
+ * ------------------------------------------------------------ */
+void push_put(struct bmepush *bmpu, int64_t ts, struct bmedata *bmed) {
+   if(bmpu->count > 0 && ts >= bmpu->start + bmpu->window) push_send(bmpu);
+   if(bmpu->count == 0) {
+      bmpu->start = (bmpu->window > 0) ? ts - ts % bmpu->window : ts;
+      bmpu->sum_t = bmpu->sum_p = bmpu->sum_h = 0;
+   }
+   bmpu->sum_t += bmed->temp_c;
+   bmpu->sum_p += bmed->pres_p;
+   bmpu->sum_h += bmed->humi_p;
+   bmpu->last = *bmed;
+   bmpu->count++;
+   if(bmpu->window == 0) push_send(bmpu);
+}
+
+/* ------------------------------------------------------------ *
+ * push_close() sends the open window and closes the socket     *
+ * ------------------------------------------------------------ */
+void push_close(struct bmepush *bmpu) {
+   if(bmpu->fd < 0) return;
+   if(bmpu->count > 0) push_send(bmpu);
+   if(verbose == 1) printf("Debug: Push datagrams: [%ld] sent [%ld] failed\n",
+                           bmpu->sent, bmpu->failed);
+   close(bmpu->fd);
+   bmpu->fd = -1;
+}
+
+/* ------------------------------------------------------------ *
+ * The listener tracks the last sequence number per sensor id   *
+ * in an open addressing table, to count the lost datagrams.    *
+ * ------------------------------------------------------------ */
+#define LISTEN_IDS        4096   // max sensor ids, a power of 2
+#define LISTEN_BATCH        64   // datagrams per recvmmsg() call
+
+struct lsensor{
+   uint32_t id;      // sensor id
+   uint32_t seq;     // next expected sequence number
+   int used;         // 1 = slot in use
+   long received;    // datagrams received
+   long lost;        // datagrams missing in the sequence
+};
+
+static struct lsensor lsensors[LISTEN_IDS];
+static int nlsensors = 0;
+static volatile sig_atomic_t lstop = 0;
+
+static void listen_stop(int sig) {
+   lstop = 1;
+}
+
+/* ------------------------------------------------------------ *
+ * listen_sensor() returns the table entry of a sensor id, NULL *
+ * if the table is full                                         *
+ * ------------------------------------------------------------ */
+static struct lsensor *listen_sensor(uint32_t id) {
+   uint32_t h = (id * 2654435761u) & (LISTEN_IDS - 1);
+   for(int i = 0; i < LISTEN_IDS; i++) {
+      struct lsensor *ls = &lsensors[(h + i) & (LISTEN_IDS - 1)];
+      if(ls->used == 0) {
+         if(nlsensors == LISTEN_IDS - 1) return NULL;
+         ls->used = 1;
+         ls->id = id;
+         nlsensors++;
+         return ls;
+      }
+      if(ls->id == id) return ls;
+   }
+   return NULL;
+}
+
+/* ------------------------------------------------------------ *
+ * listen_print() decodes one datagram and prints it in the     *
+ * sample line format, with the sensor id and sequence number.  *
+ * Returns 0, or -1 if it is no valid datagram.                 *
+ * ------------------------------------------------------------ */
+static int listen_print(uint8_t *buf, ssize_t len) {
+   struct bmedgram dg;
+   if(len != BMED_SIZE && len != BMED_SIZE_V1) return(-1);
+   memset(&dg, 0, sizeof(dg));
+   memcpy(&dg, buf, len);
+   if(be16toh(dg.magic) != BMED_MAGIC) return(-1);
+   if(!(dg.version == 1 && len == BMED_SIZE_V1) && !(dg.version == 2 && len == BMED_SIZE))
+      return(-1);
+
+   uint32_t id = be32toh(dg.id);
+   uint32_t seq = be32toh(dg.seq);
+   struct lsensor *ls = listen_sensor(id);
+   long lost = 0;
+   if(ls != NULL) {
+      if(ls->received > 0 && seq != ls->seq) {
+         lost = (int32_t) (seq - ls->seq);
+         if(lost < 0) lost = 0;   // reordered or restarted sender
+         ls->lost += lost;
+      }
+      ls->seq = seq + 1;
+      ls->received++;
+   }
+
+   char line[384];
+   int n = snprintf(line, sizeof(line), "%lld", (long long) be64toh(dg.ts));
+   if(dg.flags & BMED_T)
+      n += snprintf(line+n, sizeof(line)-n, " Temp=%3.2f*C", (int32_t) be32toh(dg.temp) / 100.0);
+   else n += snprintf(line+n, sizeof(line)-n, " Temp=skipped");
+   if(dg.flags & BMED_H)
+      n += snprintf(line+n, sizeof(line)-n, " Humidity=%3.2f%%", (int32_t) be32toh(dg.humi) / 1000.0);
+   if(dg.flags & BMED_P)
+      n += snprintf(line+n, sizeof(line)-n, " Pressure=%3.2fhPa", (int32_t) be32toh(dg.pres) / 10000.0);
+   n += snprintf(line+n, sizeof(line)-n, " Sensor=0x%08X Seq=%u", id, seq);
+   if(dg.flags & BMED_WINDOW) n += snprintf(line+n, sizeof(line)-n, " Count=%u", be32toh(dg.count));
+   if(lost > 0) n += snprintf(line+n, sizeof(line)-n, " Lost=%ld", lost);
+   if(dg.version >= 2 && dg.rt_ns != 0) {
+      int64_t rt = (int64_t) be64toh(dg.rt_ns), mono = (int64_t) be64toh(dg.mono_ns);
+      n += snprintf(line+n, sizeof(line)-n, " Time=%lld.%09lld Mono=%lld.%09lld Latency=%dns Rseq=%u",
+                    (long long) (rt / STAMP_NS), (long long) (rt % STAMP_NS),
+                    (long long) (mono / STAMP_NS), (long long) (mono % STAMP_NS),
+                    (int32_t) be32toh(dg.lat_ns), be32toh(dg.rseq));
+   }
+   if(verbose == 1) n += snprintf(line+n, sizeof(line)-n, " Raw=%d/%d/%d",
+                                  (int32_t) be32toh(dg.adc_t), (int32_t) be32toh(dg.adc_p),
+                                  (int32_t) be32toh(dg.adc_h));
+   snprintf(line+n, sizeof(line)-n, "\n");
+   fputs(line, stdout);
+   return(0);
+}
+
+static void listen_usage() {
+   printf("Usage: getbme280 listen [-v] <udp:[host:]port|unix:path>\n\n\
+Receives the datagrams of getbme280 -c -U, and prints one line per datagram,\n\
+with the sensor id and sequence number. Gaps in the sequence of a sensor\n\
+are shown as Lost=<n>. Ctrl-C prints the totals per sensor.\n\n\
+Usage examples:\n\
+./getbme280 listen udp:5280\n\
+./getbme280 listen unix:/run/bme280.dgram\n\n");
+}
+
+/* ------------------------------------------------------------ *
+ * bme_listen() runs the "listen" subcommand. Datagrams are     *
+ * received in batches with recvmmsg(), one syscall per burst.  *
+ * ------------------------------------------------------------ */
+int bme_listen(int argc, char *argv[]) {
+   struct sockaddr_storage sa;
+   socklen_t salen;
+   int arg;
+
+   opterr = 0;
+   while ((arg = (int) getopt (argc, argv, "hv")) != -1) {
+      switch (arg) {
+         case 'v':
+            verbose = 1; break;
+         case 'h':
+            listen_usage(); return(0);
+         default:
+            listen_usage(); return(-1);
+      }
+   }
+   if(argc - optind != 1) { listen_usage(); return(-1); }
+
+   char *src = argv[optind];
+   int family = push_addr(src, 1, &sa, &salen);
+   if(family < 0) return(-1);
+   int fd = socket(family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+   if(family == AF_UNIX) unlink(((struct sockaddr_un *) &sa)->sun_path);
+   if(fd < 0 || bind(fd, (struct sockaddr *) &sa, salen) != 0) {
+      printf("Error: cannot listen on %s.\n", src);
+      if(fd >= 0) close(fd);
+      return(-1);
+   }
+   if(verbose == 1) printf("Debug: Listening on: [%s]\n", src);
+
+   struct sigaction sac;
+   memset(&sac, 0, sizeof(sac));
+   sac.sa_handler = listen_stop;
+   sigaction(SIGINT, &sac, NULL);
+   sigaction(SIGTERM, &sac, NULL);
+
+   static uint8_t bufs[LISTEN_BATCH][BMED_SIZE + 1];
+   struct mmsghdr msgs[LISTEN_BATCH];
+   struct iovec iov[LISTEN_BATCH];
+   long invalid = 0;
+   while(lstop == 0) {
+      memset(msgs, 0, sizeof(msgs));
+      for(int i = 0; i < LISTEN_BATCH; i++) {
+         iov[i].iov_base = bufs[i];
+         iov[i].iov_len = sizeof(bufs[i]);
+         msgs[i].msg_hdr.msg_iov = &iov[i];
+         msgs[i].msg_hdr.msg_iovlen = 1;
+      }
+      int n = recvmmsg(fd, msgs, LISTEN_BATCH, MSG_WAITFORONE, NULL);
+      if(n < 0) continue;   // EINTR on Ctrl-C
+      for(int i = 0; i < n; i++) {
+         if(listen_print(bufs[i], msgs[i].msg_len) != 0) invalid++;
+      }
+      fflush(stdout);
+   }
+   close(fd);
+   if(family == AF_UNIX) unlink(((struct sockaddr_un *) &sa)->sun_path);
+
+   /* ---------------------------------------------------------- *
+    * Totals per sensor id                                       *
+    * ---------------------------------------------------------- */
+   printf("Sensors: %d, invalid datagrams: %ld\n", nlsensors, invalid);
+   for(int i = 0; i < LISTEN_IDS; i++) {
+      struct lsensor *ls = &lsensors[i];
+      if(ls->used == 0) continue;
+      printf("Sensor=0x%08X received %ld lost %ld\n", ls->id, ls->received, ls->lost);
+   }
+   return(0);
+}
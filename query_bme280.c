@@ -0,0 +1,441 @@
+/* ------------------------------------------------------------ *
+ * file:        query_bme280.c                                  *
+ * purpose:     Time-range queries over recorded sample logs.   *
+ *              A sample log is the stdout of "getbme280 -c"    *
+ *              written to a file, one line per sample, with    *
+ *              ascending timestamps at the start of each line. *
+ *              The log is mmap'ed and the start of the range   *
+ *              is found by binary search over line offsets, so *
+ *              only the matching records are ever touched.     *
+ *              Compressed "-z" store files are detected by     *
+ *              their header, the block headers serve as sparse *
+ *              time index and only matching blocks are decoded.*
+ *                                                              *
+ * example:     ./getbme280 query -g 300 node1.log \            *
+ *                          2020-03-16T02:00 2020-03-16T03:00   *
+ *                                                              *
+ * author:      10/18/2026 agent                                *
+ * ------------------------------------------------------------ */
+#define _XOPEN_SOURCE 700
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "getbme280.h"
+
+extern int verbose;
+
+/* ------------------------------------------------------------ *
+ * Query state with the aggregation window, one output line per *
+ * window, or per sample if window is 0.                        *
+ * ------------------------------------------------------------ */
+struct qctx {
+   long long from;   // range start, inclusive
+   long long to;     // range end, exclusive
+   long window;      // aggregation window in seconds, 0 = off
+   int func;         // 0 = avg, 1 = min, 2 = max
+   long long start;  // window start timestamp
+   long count;       // number of samples in the window
+   double temp_c;    // accumulated temperature
+   double humi_p;    // accumulated humidity
+   double pres_h;    // accumulated pressure in hPa
+   int derive;       // -x derived values, 0 = off, 1 = precise, 2 = fast
+   float elev;       // -e station elevation in m
+   int nrows;        // output rows waiting for derive_batch()
+};
+
+/* ------------------------------------------------------------ *
+ * With -x, output rows are collected and their derived values  *
+ * computed in batches of QUERY_BATCH rows                      *
+ * ------------------------------------------------------------ */
+#define QUERY_BATCH        256
+static long long rows_ts[QUERY_BATCH];
+static struct bmedata rows[QUERY_BATCH];
+static struct bmederiv rowsdv[QUERY_BATCH];
+
+/* ------------------------------------------------------------ *
+ * query_usage() prints the query subcommand instructions.      *
+ * ------------------------------------------------------------ */
+static void query_usage() {
+   printf("Usage: getbme280 query [-g seconds] [-f avg|min|max] [-K comp] [-x precise|fast] [-e elevation] [-v] logfile from to\n\
+\n\
+   logfile   a text sample log of -c, or a compressed -z store file\n\
+   from, to  time range [from, to), as epoch seconds or local time\n\
+             in the format YYYY-MM-DDTHH:MM[:SS]\n\
+   -g        aggregate samples into windows of <seconds> length\n\
+   -f        aggregate function for -g, default avg\n\
+   -K        compensation version for -z store files, see getbme280 -h\n\
+   -x        add the derived values to each output line, see getbme280 -h\n\
+   -e        station elevation in m for the -x sea-level pressure\n\
+   -v        enable debug output\n\
+\n\
+Usage examples:\n\
+./getbme280 query node1.log 1584324000 1584327600\n\
+./getbme280 query -g 300 -f max node1.log 2020-03-16T02:00 2020-03-16T03:00\n\
+./getbme280 query -x fast -e 35 node1.bmez 2020-03-16T02:00 2020-03-16T03:00\n\n");
+}
+
+/* ------------------------------------------------------------ *
+ * query_time() converts a range argument into epoch seconds.   *
+ * Returns -1 if the argument cannot be parsed.                 *
+ * ------------------------------------------------------------ */
+static long long query_time(const char *arg) {
+   char *end;
+   long long ts = strtoll(arg, &end, 10);
+   if(*arg != '\0' && *end == '\0') return ts;
+
+   struct tm tm;
+   memset(&tm, 0, sizeof(tm));
+   end = strptime(arg, "%Y-%m-%dT%H:%M", &tm);
+   if(end != NULL && *end == ':') end = strptime(end, ":%S", &tm);
+   if(end == NULL || *end != '\0') return -1;
+   tm.tm_isdst = -1;
+   return (long long) mktime(&tm);
+}
+
+/* ------------------------------------------------------------ *
+ * line_start() returns the offset of the line containing off.  *
+ * ------------------------------------------------------------ */
+static size_t line_start(const char *map, size_t off) {
+   while(off > 0 && map[off-1] != '\n') off--;
+   return off;
+}
+
+/* ------------------------------------------------------------ *
+ * line_next() returns the offset of the line following off.    *
+ * ------------------------------------------------------------ */
+static size_t line_next(const char *map, size_t size, size_t off) {
+   const char *nl = memchr(map + off, '\n', size - off);
+   return nl ? (size_t)(nl - map) + 1 : size;
+}
+
+/* ------------------------------------------------------------ *
+ * line_ts() returns the timestamp of the first sample line at  *
+ * or after off. Lines without a leading timestamp (e.g. debug  *
+ * or error output) are skipped. Returns -1 at the end of data. *
+ * ------------------------------------------------------------ */
+static long long line_ts(const char *map, size_t size, size_t off) {
+   while(off < size) {
+      if(isdigit((unsigned char) map[off])) {
+         long long ts = 0;
+         while(off < size && isdigit((unsigned char) map[off]))
+            ts = ts * 10 + (map[off++] - '0');
+         return ts;
+      }
+      off = line_next(map, size, off);
+   }
+   return -1;
+}
+
+/* ------------------------------------------------------------ *
+ * query_line() prints a sample line like print_data() does,    *
+ * humidity is NAN for sensors without humidity (BMP280), and   *
+ * humidity or pressure are NAN if the channel was skipped.     *
+ * bmedv has the derived values for -x, or is NULL.             *
+ * ------------------------------------------------------------ */
+static void query_line(long long ts, double t, double h, double p, struct bmederiv *bmedv) {
+   if(isnan(t)) {
+      printf("%lld Temp=skipped\n", ts);
+      return;
+   }
+   printf("%lld Temp=%3.2f*C", ts, t);
+   if(! isnan(h)) printf(" Humidity=%3.2f%%", h);
+   if(! isnan(p)) printf(" Pressure=%3.2fhPa", p);
+   if(bmedv != NULL) {
+      if(! isnan(bmedv->dewp_c))
+         printf(" Dewpoint=%3.2f*C AbsHumidity=%3.2fg/m3", bmedv->dewp_c, bmedv->abshum);
+      if(! isnan(p))
+         printf(" Altitude=%3.2fm SeaLevel=%3.2fhPa", bmedv->alti_m, bmedv->qnh_p/100);
+   }
+   printf("\n");
+}
+
+/* ------------------------------------------------------------ *
+ * query_drain() computes the derived values of the collected   *
+ * rows in one derive_batch() call, and prints them             *
+ * ------------------------------------------------------------ */
+static void query_drain(struct qctx *q) {
+   if(q->nrows == 0) return;
+   derive_batch(rows, rowsdv, q->nrows, q->elev, q->derive == 2);
+   for(int i = 0; i < q->nrows; i++)
+      query_line(rows_ts[i], rows[i].temp_c, rows[i].humi_p, rows[i].pres_p/100, &rowsdv[i]);
+   q->nrows = 0;
+}
+
+/* ------------------------------------------------------------ *
+ * query_print() prints a sample line, or with -x collects it   *
+ * for the next batch of derived values                         *
+ * ------------------------------------------------------------ */
+static void query_print(struct qctx *q, long long ts, double t, double h, double p) {
+   if(q->derive == 0) {
+      query_line(ts, t, h, p, NULL);
+      return;
+   }
+   rows_ts[q->nrows] = ts;
+   rows[q->nrows].temp_c = t;
+   rows[q->nrows].humi_p = h;
+   rows[q->nrows].pres_p = p * 100;
+   if(++q->nrows == QUERY_BATCH) query_drain(q);
+}
+
+/* ------------------------------------------------------------ *
+ * query_flush() prints one aggregation window in the same line *
+ * format that the -t and -c sampler output uses.               *
+ * ------------------------------------------------------------ */
+static void query_flush(struct qctx *q) {
+   if(q->count == 0) return;
+   if(q->func == 0) {
+      q->temp_c /= q->count;
+      q->humi_p /= q->count;
+      q->pres_h /= q->count;
+   }
+   query_print(q, q->start, q->temp_c, q->humi_p, q->pres_h);
+   q->count = 0;
+}
+
+/* ------------------------------------------------------------ *
+ * query_emit() prints a sample, or adds it to the open window  *
+ * ------------------------------------------------------------ */
+static void query_emit(struct qctx *q, long long ts, float t, float h, float p) {
+   if(q->window == 0) {
+      query_print(q, ts, t, h, p);
+      return;
+   }
+
+   long long wstart = ts - ((ts - q->from) % q->window);
+   if(q->count > 0 && wstart != q->start) query_flush(q);
+   if(q->count == 0) {
+      q->start = wstart;
+      q->temp_c = t; q->humi_p = h; q->pres_h = p;
+   }
+   else if(q->func == 0) {
+      q->temp_c += t; q->humi_p += h; q->pres_h += p;
+   }
+   else if(q->func == 1) {
+      if(t < q->temp_c) q->temp_c = t;
+      if(h < q->humi_p) q->humi_p = h;
+      if(p < q->pres_h) q->pres_h = p;
+   }
+   else {
+      if(t > q->temp_c) q->temp_c = t;
+      if(h > q->humi_p) q->humi_p = h;
+      if(p > q->pres_h) q->pres_h = p;
+   }
+   q->count++;
+}
+
+/* ------------------------------------------------------------ *
+ * query_text() runs the query over a mapped text sample log.   *
+ * ------------------------------------------------------------ */
+static void query_text(const char *map, size_t size, struct qctx *q) {
+   /* ---------------------------------------------------------- *
+    * Binary search for the first line with ts >= from. lo and   *
+    * hi are always line start offsets, hi = size is the end.    *
+    * ---------------------------------------------------------- */
+   posix_madvise((void *) map, size, POSIX_MADV_RANDOM);
+   size_t lo = 0, hi = size;
+   while(lo < hi) {
+      size_t mid = line_start(map, lo + (hi - lo) / 2);
+      long long ts = line_ts(map, size, mid);
+      if(ts >= 0 && ts < q->from) lo = line_next(map, size, mid);
+      else hi = mid;
+   }
+   if(verbose == 1) printf("Debug: Query offset: [%zu]\n", lo);
+
+   /* ---------------------------------------------------------- *
+    * Stream forward from the found offset until ts >= to        *
+    * ---------------------------------------------------------- */
+   size_t page = lo & ~((size_t) sysconf(_SC_PAGESIZE) - 1);
+   posix_madvise((void *) (map + page), size - page, POSIX_MADV_SEQUENTIAL);
+   size_t off = lo;
+   while(off < size) {
+      size_t next = line_next(map, size, off);
+      if(! isdigit((unsigned char) map[off])) { off = next; continue; }
+
+      long long ts = line_ts(map, size, off);
+      if(ts >= q->to) break;
+
+      if(q->window == 0 && q->derive == 0) {
+         fwrite(map + off, 1, next - off, stdout);
+         off = next;
+         continue;
+      }
+
+      /* ------------------------------------------------------- *
+       * Parse the values: "ts Temp=.. Humidity=.. Pressure=..", *
+       * the humidity field is missing for BMP280 sensors, and   *
+       * humidity or pressure if the channel was skipped. A line *
+       * with "Temp=skipped" is passed on with t = NAN, as the   *
+       * -z store path does it.                                  *
+       * ------------------------------------------------------- */
+      char line[256];
+      size_t len = next - off < sizeof(line) - 1 ? next - off : sizeof(line) - 1;
+      memcpy(line, map + off, len);
+      line[len] = '\0';
+      off = next;
+
+      float t, h = NAN, p = NAN;
+      char *ht = strstr(line, "Humidity=");
+      char *pt = strstr(line, "Pressure=");
+      if(strstr(line, " Temp=skipped") != NULL) t = NAN;
+      else if(sscanf(line, "%*s Temp=%f*C", &t) != 1) continue;
+      if(ht != NULL) sscanf(ht, "Humidity=%f%%", &h);
+      if(pt != NULL) sscanf(pt, "Pressure=%fhPa", &p);
+      query_emit(q, ts, t, h, p);
+   }
+}
+
+/* ------------------------------------------------------------ *
+ * query_store() runs the query over a mapped -z store file.    *
+ * Blocks outside the range are skipped by their header alone.  *
+ * ------------------------------------------------------------ */
+static int query_store(const uint8_t *map, size_t size, struct qctx *q) {
+   static struct bmezs bmes[BMEZ_BLKSAMPLES];
+   struct bmecal bmec;
+   struct bmedata bmed;
+   struct bmezb bmeb;
+
+   if(bmez_calib(map, size, &bmec) != 0) {
+      printf("Error: unsupported store file version.\n");
+      return(-1);
+   }
+
+   size_t off = BMEZ_HDRSIZE;
+   long blocks = 0;
+   while(off < size) {
+      size_t len = bmez_block(map + off, size - off, &bmeb);
+      if(len == 0 || off + len > size) break;  // incomplete tail
+      if(bmeb.first_ts >= q->to) break;
+      if(bmeb.last_ts < q->from) { off += len; continue; }
+
+      int n = bmez_decode(map + off, len, bmes);
+      if(n < 0) {
+         printf("Error: corrupt store block at offset %zu.\n", off);
+         return(-1);
+      }
+      blocks++;
+      for(int i = 0; i < n; i++) {
+         if(bmes[i].ts < q->from) continue;
+         if(bmes[i].ts >= q->to) break;
+         bmed.adc_t = bmes[i].adc_t;
+         bmed.adc_p = bmes[i].adc_p;
+         bmed.adc_h = bmes[i].adc_h;
+         bmed.skip = bme_markers(&bmed);
+         compensate(&bmec, &bmed);
+         query_emit(q, bmes[i].ts, bmed.temp_c, bmed.humi_p, bmed.pres_p/100);
+      }
+      off += len;
+   }
+   if(verbose == 1) printf("Debug: Decoded blocks: [%ld]\n", blocks);
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * bme_query() - "getbme280 query" entry point. Streams all log *
+ * lines with from <= ts < to, or their aggregates with -g.     *
+ * Returns 0 on success, -1 on errors.                          *
+ * ------------------------------------------------------------ */
+int bme_query(int argc, char *argv[]) {
+   struct qctx q = {0};
+   int arg;
+
+   opterr = 0;
+   while ((arg = (int) getopt (argc, argv, "g:f:K:x:e:hv")) != -1) {
+      switch (arg) {
+         case 'g':
+            q.window = strtol(optarg, NULL, 10);
+            if(q.window <= 0) {
+               printf("Error: invalid aggregation window %s.\n", optarg);
+               return(-1);
+            }
+            break;
+         case 'f':
+            if(strcmp(optarg, "avg") == 0)      q.func = 0;
+            else if(strcmp(optarg, "min") == 0) q.func = 1;
+            else if(strcmp(optarg, "max") == 0) q.func = 2;
+            else {
+               printf("Error: invalid aggregate function %s.\n", optarg);
+               return(-1);
+            }
+            break;
+         case 'K': {
+            struct bmecomp *bmek = get_comp(optarg);
+            if(bmek == NULL) {
+               printf("Error: invalid compensation version %s.\n", optarg);
+               return(-1);
+            }
+            compensate = bmek->func;
+            break;
+         }
+         case 'x':
+            if(strcmp(optarg, "precise") == 0)   q.derive = 1;
+            else if(strcmp(optarg, "fast") == 0) q.derive = 2;
+            else {
+               printf("Error: invalid derived values mode %s.\n", optarg);
+               return(-1);
+            }
+            break;
+         case 'e':
+            q.elev = strtof(optarg, NULL);
+            break;
+         case 'v':
+            verbose = 1; break;
+         case 'h':
+            query_usage(); return(0);
+         default:
+            query_usage(); return(-1);
+      }
+   }
+   if(argc - optind != 3) { query_usage(); return(-1); }
+
+   char *logfile = argv[optind];
+   q.from = query_time(argv[optind+1]);
+   q.to   = query_time(argv[optind+2]);
+   if(q.from < 0 || q.to < 0) {
+      printf("Error: invalid time range %s - %s.\n", argv[optind+1], argv[optind+2]);
+      return(-1);
+   }
+   if(verbose == 1) printf("Debug: Query range: [%lld - %lld]\n", q.from, q.to);
+
+   /* ---------------------------------------------------------- *
+    * Map the complete log, the kernel only pages in what we use *
+    * ---------------------------------------------------------- */
+   int fd = open(logfile, O_RDONLY);
+   if(fd < 0) {
+      printf("Error open %s for reading.\n", logfile);
+      return(-1);
+   }
+   struct stat st;
+   if(fstat(fd, &st) != 0) {
+      printf("Error: cannot stat %s.\n", logfile);
+      close(fd);
+      return(-1);
+   }
+   size_t size = (size_t) st.st_size;
+   if(size == 0) { close(fd); return(0); }
+
+   char *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+   close(fd);
+   if(map == MAP_FAILED) {
+      printf("Error: cannot mmap %s.\n", logfile);
+      return(-1);
+   }
+
+   int res = 0;
+   if(size >= 4 && memcmp(map, BMEZ_MAGIC, 4) == 0)
+      res = query_store((const uint8_t *) map, size, &q);
+   else
+      query_text(map, size, &q);
+   query_flush(&q);
+   query_drain(&q);
+
+   munmap(map, size);
+   return(res);
+}
@@ -0,0 +1,418 @@
+/* ------------------------------------------------------------ *
+ * file:        reproc_bme280.c                                 *
+ * purpose:     Parallel reprocessing of "-z" store archives.   *
+ *              The stores are split into jobs at block bounds, *
+ *              each block decodes on its own. A worker pool,   *
+ *              one thread per core by default, decodes and     *
+ *              compensates the jobs (-K), and formats their    *
+ *              lines into a buffer per job. The main thread    *
+ *              writes the buffers in job order, so the output  *
+ *              is the same as with one thread. Workers stay at *
+ *              most RP_AHEAD jobs per thread ahead of the      *
+ *              writer, which bounds the memory use.            *
+ *                                                              *
+ *              "-T" runs the archives with 1, 2, 4 .. threads  *
+ *              without writing, and reports the throughput and *
+ *              the scaling for sizing batch hosts.             *
+ *                                                              *
+ * example:     ./getbme280 reprocess -j 4 -x precise node*.bmez*
+ *                                                              *
+ * author:      10/18/2026 agent                                *
+ * ------------------------------------------------------------ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "getbme280.h"
+
+#define RP_FILES          256   // max store files per run
+#define RP_JOBBLOCKS       16   // store blocks per job
+#define RP_AHEAD            4   // jobs per thread ahead of the writer
+#define RP_THREADS        256   // max worker threads
+#define RP_LINEMAX        512   // max length of one output line
+
+struct rpfile{       // one mapped store file
+   char *name;       // file name, printed with several files
+   const uint8_t *map; // mapped store file
+   size_t size;      // file size
+   struct bmecal bmec; // calibration of the store header
+};
+
+struct rpjob{        // one job: up to RP_JOBBLOCKS blocks of a file
+   int file;         // index in rpctx.files
+   size_t off;       // offset of the first block
+   size_t len;       // length of all blocks
+   char *out;        // formatted lines
+   size_t outlen;    // length of the lines
+   long samples;     // decoded samples
+   int done;         // 1 = out is ready for the writer
+};
+
+struct rpctx{
+   struct rpfile files[RP_FILES];
+   int nfiles;
+   struct rpjob *jobs;
+   int njobs;
+   int derive;       // -x derived values, 0 = off, 1 = precise, 2 = fast
+   float elev;       // -e station elevation in m
+   int discard;      // 1 = format, but write no output, for -T
+   int next;         // next job for a worker
+   int written;      // jobs written by the main thread
+   int ahead;        // max jobs taken beyond written
+   pthread_mutex_t lock;
+   pthread_cond_t cond;
+};
+
+static int rverbose = 0;  // -v, per-sample debug output stays off
+
+/* ------------------------------------------------------------ *
+ * reproc_usage() prints the reprocess subcommand instructions. *
+ * ------------------------------------------------------------ */
+static void reproc_usage() {
+   printf("Usage: getbme280 reprocess [-j threads] [-K comp] [-x precise|fast] [-e elevation] [-T] [-v] storefile...\n\
+\n\
+   storefile compressed -z store files, the output follows their order\n\
+   -j        number of worker threads, default: one per core\n\
+   -K        compensation version, see getbme280 -h\n\
+   -x        add the derived values to each output line, see getbme280 -h\n\
+   -e        station elevation in m for the -x sea-level pressure\n\
+   -T        no output, report the throughput with 1, 2, 4 .. -j threads\n\
+   -v        enable debug output\n\
+\n\
+Usage examples:\n\
+./getbme280 reprocess node1.bmez > node1.txt\n\
+./getbme280 reprocess -j 8 -K double -x precise -e 35 node*.bmez > all.txt\n\
+./getbme280 reprocess -T node*.bmez\n\n");
+}
+
+/* ------------------------------------------------------------ *
+ * rp_line() formats one sample line like query_line() prints   *
+ * it, with the file name if there are several files. Returns   *
+ * the line length.                                             *
+ * ------------------------------------------------------------ */
+static int rp_line(char *line, int64_t ts, struct bmedata *bmed, struct bmederiv *bmedv, char *file) {
+   int n;
+   if(isnan(bmed->temp_c)) n = sprintf(line, "%lld Temp=skipped", (long long) ts);
+   else {
+      n = sprintf(line, "%lld Temp=%3.2f*C", (long long) ts, bmed->temp_c);
+      if(! isnan(bmed->humi_p)) n += sprintf(line + n, " Humidity=%3.2f%%", bmed->humi_p);
+      if(! isnan(bmed->pres_p)) n += sprintf(line + n, " Pressure=%3.2fhPa", bmed->pres_p/100);
+      if(bmedv != NULL) {
+         if(! isnan(bmedv->dewp_c))
+            n += sprintf(line + n, " Dewpoint=%3.2f*C AbsHumidity=%3.2fg/m3",
+                         bmedv->dewp_c, bmedv->abshum);
+         if(! isnan(bmed->pres_p))
+            n += sprintf(line + n, " Altitude=%3.2fm SeaLevel=%3.2fhPa",
+                         bmedv->alti_m, bmedv->qnh_p/100);
+      }
+   }
+   if(file != NULL) n += snprintf(line + n, RP_LINEMAX - 1 - n, " File=%s", file);
+   if(n > RP_LINEMAX - 2) n = RP_LINEMAX - 2;
+   line[n++] = '\n';
+   return n;
+}
+
+/* ------------------------------------------------------------ *
+ * rp_put() appends a line to the output of a job, the buffer   *
+ * grows by doubling. Returns 0, or -1 if out of memory.        *
+ * ------------------------------------------------------------ */
+static int rp_put(struct rpjob *job, size_t *cap, const char *line, int len) {
+   if(job->outlen + len > *cap) {
+      size_t size = *cap > 0 ? *cap * 2 : 65536;
+      char *out = realloc(job->out, size);
+      if(out == NULL) {
+         printf("Error: cannot allocate %zu bytes of output.\n", size);
+         return(-1);
+      }
+      job->out = out;
+      *cap = size;
+   }
+   memcpy(job->out + job->outlen, line, len);
+   job->outlen += len;
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * rp_job() decodes, compensates and formats the blocks of one  *
+ * job. Returns 0, or -1 on errors.                             *
+ * ------------------------------------------------------------ */
+static int rp_job(struct rpctx *rp, struct rpjob *job) {
+   struct bmezs bmes[BMEZ_BLKSAMPLES];
+   struct bmedata bmed[BMEZ_BLKSAMPLES];
+   struct bmederiv bmedv[BMEZ_BLKSAMPLES];
+   struct rpfile *f = &rp->files[job->file];
+   char *file = rp->nfiles > 1 ? f->name : NULL;
+   size_t cap = 0;
+
+   for(size_t off = job->off; off < job->off + job->len; ) {
+      struct bmezb bmeb;
+      size_t len = bmez_block(f->map + off, f->size - off, &bmeb);
+      int n = len > 0 ? bmez_decode(f->map + off, len, bmes) : -1;
+      if(n < 0) {
+         printf("Error: corrupt store block in %s at offset %zu.\n", f->name, off);
+         return(-1);
+      }
+      off += len;
+      for(int i = 0; i < n; i++) {
+         bmed[i].adc_t = bmes[i].adc_t;
+         bmed[i].adc_p = bmes[i].adc_p;
+         bmed[i].adc_h = bmes[i].adc_h;
+         bmed[i].skip = bme_markers(&bmed[i]);
+         compensate(&f->bmec, &bmed[i]);
+      }
+      if(rp->derive > 0) derive_batch(bmed, bmedv, n, rp->elev, rp->derive == 2);
+      job->samples += n;
+
+      for(int i = 0; i < n; i++) {
+         char line[RP_LINEMAX];
+         int len = rp_line(line, bmes[i].ts, &bmed[i], rp->derive > 0 ? &bmedv[i] : NULL, file);
+         if(rp_put(job, &cap, line, len) != 0) return(-1);
+      }
+   }
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * rp_worker() takes the next job while it is less than ahead   *
+ * jobs beyond the writer, runs it, and hands it to the writer  *
+ * ------------------------------------------------------------ */
+static void *rp_worker(void *arg) {
+   struct rpctx *rp = arg;
+
+   for(;;) {
+      pthread_mutex_lock(&rp->lock);
+      while(rp->next < rp->njobs && rp->next >= rp->written + rp->ahead)
+         pthread_cond_wait(&rp->cond, &rp->lock);
+      int j = rp->next < rp->njobs ? rp->next++ : -1;
+      pthread_mutex_unlock(&rp->lock);
+      if(j < 0) return NULL;
+
+      int res = rp_job(rp, &rp->jobs[j]);
+
+      pthread_mutex_lock(&rp->lock);
+      rp->jobs[j].done = res == 0 ? 1 : -1;
+      pthread_cond_broadcast(&rp->cond);
+      pthread_mutex_unlock(&rp->lock);
+   }
+}
+
+/* ------------------------------------------------------------ *
+ * rp_run() processes all jobs with nthreads workers, and the   *
+ * calling thread as writer. Returns the number of samples, or  *
+ * -1 on errors.                                                *
+ * ------------------------------------------------------------ */
+static long rp_run(struct rpctx *rp, int nthreads) {
+   pthread_t threads[RP_THREADS];
+   long samples = 0;
+   int res = 0;
+
+   for(int j = 0; j < rp->njobs; j++) {
+      rp->jobs[j].done = 0;
+      rp->jobs[j].samples = 0;
+   }
+   rp->next = rp->written = 0;
+   rp->ahead = nthreads * RP_AHEAD;
+   for(int i = 0; i < nthreads; i++) {
+      if(pthread_create(&threads[i], NULL, rp_worker, rp) != 0) {
+         printf("Error: cannot start worker thread %d.\n", i);
+         exit(-1);
+      }
+   }
+
+   for(int j = 0; j < rp->njobs; j++) {
+      struct rpjob *job = &rp->jobs[j];
+      pthread_mutex_lock(&rp->lock);
+      while(job->done == 0) pthread_cond_wait(&rp->cond, &rp->lock);
+      pthread_mutex_unlock(&rp->lock);
+
+      if(job->done < 0) res = -1;
+      else if(res == 0 && rp->discard == 0 && job->outlen > 0 && fwrite(job->out, 1, job->outlen, stdout) != job->outlen) {
+         printf("Error: cannot write the output.\n");
+         res = -1;
+      }
+      samples += job->samples;
+      free(job->out);
+      job->out = NULL;
+      job->outlen = 0;
+
+      pthread_mutex_lock(&rp->lock);
+      rp->written++;
+      pthread_cond_broadcast(&rp->cond);
+      pthread_mutex_unlock(&rp->lock);
+   }
+   for(int i = 0; i < nthreads; i++) pthread_join(threads[i], NULL);
+   fflush(stdout);
+   return res == 0 ? samples : -1;
+}
+
+/* ------------------------------------------------------------ *
+ * rp_open() maps a store file, and splits it into jobs at the  *
+ * block bounds. Returns 0, or -1 on errors.                    *
+ * ------------------------------------------------------------ */
+static int rp_open(struct rpctx *rp, char *name) {
+   struct rpfile *f = &rp->files[rp->nfiles];
+   int fd = open(name, O_RDONLY);
+   if(fd < 0) {
+      printf("Error open %s for reading.\n", name);
+      return(-1);
+   }
+   struct stat st;
+   if(fstat(fd, &st) != 0 || st.st_size < BMEZ_HDRSIZE) {
+      printf("Error: %s is no store file.\n", name);
+      close(fd);
+      return(-1);
+   }
+   f->name = name;
+   f->size = (size_t) st.st_size;
+   f->map = mmap(NULL, f->size, PROT_READ, MAP_PRIVATE, fd, 0);
+   close(fd);
+   if(f->map == MAP_FAILED) {
+      printf("Error: cannot mmap %s.\n", name);
+      return(-1);
+   }
+   if(memcmp(f->map, BMEZ_MAGIC, 4) != 0 || bmez_calib(f->map, f->size, &f->bmec) != 0) {
+      printf("Error: %s is no supported store file.\n", name);
+      return(-1);
+   }
+   madvise((void *) f->map, f->size, MADV_SEQUENTIAL);
+
+   size_t off = BMEZ_HDRSIZE;
+   while(off < f->size) {
+      struct rpjob job = { rp->nfiles, off, 0, NULL, 0, 0, 0 };
+      for(int b = 0; b < RP_JOBBLOCKS && off < f->size; b++) {
+         struct bmezb bmeb;
+         size_t len = bmez_block(f->map + off, f->size - off, &bmeb);
+         if(len == 0 || off + len > f->size) {
+            if(rverbose == 1) printf("Debug: %s: incomplete tail at [%zu]\n", name, off);
+            off = f->size;
+            break;
+         }
+         off += len;
+         job.len += len;
+      }
+      if(job.len == 0) break;
+      if(rp->njobs % 1024 == 0) {
+         struct rpjob *jobs = realloc(rp->jobs, (rp->njobs + 1024) * sizeof(*jobs));
+         if(jobs == NULL) {
+            printf("Error: cannot allocate the job list.\n");
+            return(-1);
+         }
+         rp->jobs = jobs;
+      }
+      rp->jobs[rp->njobs++] = job;
+   }
+   rp->nfiles++;
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * rp_now() returns the monotonic time in seconds               *
+ * ------------------------------------------------------------ */
+static double rp_now() {
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* ------------------------------------------------------------ *
+ * bme_reproc() is the "reprocess" subcommand, argv[0] is the   *
+ * subcommand name. Returns 0 on success, -1 on errors.         *
+ * ------------------------------------------------------------ */
+int bme_reproc(int argc, char *argv[]) {
+   static struct rpctx rp;
+   int nthreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+   int scaling = 0;
+   int arg;
+
+   opterr = 0;
+   while ((arg = (int) getopt (argc, argv, "j:K:x:e:Thv")) != -1) {
+      switch (arg) {
+         case 'j':
+            nthreads = (int) strtol(optarg, NULL, 10);
+            if(nthreads < 1 || nthreads > RP_THREADS) {
+               printf("Error: invalid thread count %s, use 1..%d.\n", optarg, RP_THREADS);
+               return(-1);
+            }
+            break;
+         case 'K': {
+            struct bmecomp *bmek = get_comp(optarg);
+            if(bmek == NULL) {
+               printf("Error: invalid compensation version %s.\n", optarg);
+               return(-1);
+            }
+            compensate = bmek->func;
+            break;
+         }
+         case 'x':
+            if(strcmp(optarg, "precise") == 0)   rp.derive = 1;
+            else if(strcmp(optarg, "fast") == 0) rp.derive = 2;
+            else {
+               printf("Error: invalid derived values mode %s.\n", optarg);
+               return(-1);
+            }
+            break;
+         case 'e':
+            rp.elev = strtof(optarg, NULL);
+            break;
+         case 'T':
+            scaling = 1; break;
+         case 'v':
+            rverbose = 1; break;
+         case 'h':
+            reproc_usage(); return(0);
+         default:
+            reproc_usage(); return(-1);
+      }
+   }
+   if(optind == argc) { reproc_usage(); return(-1); }
+   if(argc - optind > RP_FILES) {
+      printf("Error: more than %d store files.\n", RP_FILES);
+      return(-1);
+   }
+   if(nthreads < 1) nthreads = 1;
+   if(nthreads > RP_THREADS) nthreads = RP_THREADS;
+
+   for(int i = optind; i < argc; i++) {
+      if(rp_open(&rp, argv[i]) != 0) return(-1);
+   }
+   if(rverbose == 1) printf("Debug: Files: [%d] jobs: [%d] threads: [%d]\n",
+                            rp.nfiles, rp.njobs, nthreads);
+   pthread_mutex_init(&rp.lock, NULL);
+   pthread_cond_init(&rp.cond, NULL);
+
+   /* ---------------------------------------------------------- *
+    * -T: throughput with 1, 2, 4 .. nthreads workers, no output *
+    * ---------------------------------------------------------- */
+   if(scaling == 1) {
+      double base = 0;
+      rp.discard = 1;
+      printf("Threads   Samples/s     Speedup  Efficiency\n");
+      for(int n = 1; ; n = (n * 2 > nthreads && n < nthreads) ? nthreads : n * 2) {
+         double start = rp_now();
+         long samples = rp_run(&rp, n);
+         double secs = rp_now() - start;
+         if(samples < 0) return(-1);
+         double rate = secs > 0 ? samples / secs : 0;
+         if(n == 1) base = rate;
+         printf("%7d %11.0f %10.2fx %10.0f%%\n", n, rate,
+                base > 0 ? rate / base : 0, base > 0 ? rate / base / n * 100 : 0);
+         if(n >= nthreads) break;
+      }
+      return(0);
+   }
+
+   double start = rp_now();
+   long samples = rp_run(&rp, nthreads);
+   double secs = rp_now() - start;
+   if(samples < 0) return(-1);
+   if(rverbose == 1) printf("Debug: Reprocessed [%ld] samples in [%.3fs]: [%.0f samples/s]\n",
+                            samples, secs, secs > 0 ? samples / secs : 0);
+   return(0);
+}
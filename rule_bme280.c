@@ -0,0 +1,281 @@
+/* ------------------------------------------------------------ *
+ * file:        rule_bme280.c                                   *
+ * purpose:     Event rules for continuous mode "-c -R file".   *
+ *              The rules are checked in the output thread for  *
+ *              each sample, and only their state changes are   *
+ *              emitted, so a collector that only alerts on a   *
+ *              few limits no longer needs every sample.        *
+ *                                                              *
+ *              Rule file, one rule or setting per line, '#'    *
+ *              starts a comment:                               *
+ *                                                              *
+ *              events stdout|udp:<host>:<port>|unix:<path>     *
+ *              events exec <command>                           *
+ *              <name> temp|humi|pres [rate] >|< <limit>        *
+ *                     [hyst <h>] [window <sec>]                *
+ *                                                              *
+ *              Limits are in *C, % and hPa, rate limits in the *
+ *              same units per hour. A rule turns on when the   *
+ *              value is past the limit, and off when it is     *
+ *              back by more than hyst. Rates are the change of *
+ *              the window mean between two windows, and are    *
+ *              checked once per window. A sample costs one add *
+ *              and one or two compares per rule.               *
+ *                                                              *
+ * example:	./getbme280 -c -R /etc/bme280.rules             *
+ *                                                              *
+ * author:      10/18/2026 agent                                *
+ * ------------------------------------------------------------ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "getbme280.h"
+
+extern int verbose;
+extern char **environ;
+
+/* ------------------------------------------------------------ *
+ * Channel names and units of the rules                         *
+ * ------------------------------------------------------------ */
+static const struct { char *name; int chan; char *unit; } rule_chans[] = {
+   { "temp", CHAN_T, "*C" },
+   { "humi", CHAN_H, "%" },
+   { "pres", CHAN_P, "hPa" },
+};
+
+/* ------------------------------------------------------------ *
+ * rule_parse() parses one rule line, tokens split at blanks.   *
+ * Returns 0 or -1 on errors.                                   *
+ * ------------------------------------------------------------ */
+static int rule_parse(struct bmerule *r, char *name) {
+   char *tok;
+
+   memset(r, 0, sizeof(*r));
+   if(strlen(name) >= RULE_NAMELEN) return(-1);
+   strcpy(r->name, name);
+   r->window = RULE_WINDOW;
+
+   if((tok = strtok(NULL, " \t")) == NULL) return(-1);
+   for(int i = 0; i < 3; i++) {
+      if(strcmp(tok, rule_chans[i].name) == 0) r->chan = rule_chans[i].chan;
+   }
+   if(r->chan == 0 || (tok = strtok(NULL, " \t")) == NULL) return(-1);
+   if(strcmp(tok, "rate") == 0) {
+      r->rate = 1;
+      if((tok = strtok(NULL, " \t")) == NULL) return(-1);
+   }
+   if(strcmp(tok, ">") == 0) r->sign = 1;
+   else if(strcmp(tok, "<") == 0) r->sign = -1;
+   else return(-1);
+
+   char *end;
+   if((tok = strtok(NULL, " \t")) == NULL) return(-1);
+   r->limit = r->sign * strtof(tok, &end);
+   if(*end != '\0') return(-1);
+
+   while((tok = strtok(NULL, " \t")) != NULL) {
+      char *val = strtok(NULL, " \t");
+      if(val == NULL) return(-1);
+      if(strcmp(tok, "hyst") == 0) r->hyst = strtof(val, &end);
+      else if(strcmp(tok, "window") == 0 && r->rate == 1) r->window = strtol(val, &end, 10);
+      else return(-1);
+      if(*end != '\0' || r->hyst < 0 || r->window < 1) return(-1);
+   }
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * rule_output() parses the events setting, the rest of the     *
+ * line, and opens its socket. Returns 0 or -1 on errors.       *
+ * ------------------------------------------------------------ */
+static int rule_output(struct bmerules *bmer, char *dest) {
+   if(dest == NULL) return(-1);
+   dest += strspn(dest, " \t");
+   for(int n = strlen(dest); n > 0 && (dest[n-1] == ' ' || dest[n-1] == '\t'); n--) dest[n-1] = '\0';
+   if(bmer->fd >= 0) close(bmer->fd);
+   bmer->fd = -1;
+   if(strcmp(dest, "stdout") == 0) bmer->out = RULE_STDOUT;
+   else if(strncmp(dest, "exec", 4) == 0 && (dest[4] == ' ' || dest[4] == '\t')) {
+      dest += 5 + strspn(dest + 5, " \t");
+      if(*dest == '\0' || strlen(dest) >= sizeof(bmer->cmd)) return(-1);
+      strcpy(bmer->cmd, dest);
+      bmer->out = RULE_EXEC;
+   }
+   else {
+      if(dest[strcspn(dest, " \t")] != '\0') return(-1);
+      if((bmer->fd = push_connect(dest)) < 0) return(-1);
+      bmer->out = RULE_SOCKET;
+   }
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * rule_open() reads the rule file. Returns 0 or -1 on errors.  *
+ * ------------------------------------------------------------ */
+int rule_open(struct bmerules *bmer, char *file) {
+   char line[512];
+   int lineno = 0;
+
+   memset(bmer, 0, sizeof(*bmer));
+   bmer->fd = -1;
+   FILE *fp = fopen(file, "r");
+   if(fp == NULL) {
+      printf("Error: cannot open rule file %s.\n", file);
+      return(-1);
+   }
+   while(fgets(line, sizeof(line), fp) != NULL) {
+      lineno++;
+      line[strcspn(line, "#\r\n")] = '\0';
+      char *tok = strtok(line, " \t");
+      if(tok == NULL) continue;
+
+      int res;
+      if(strcmp(tok, "events") == 0) {
+         res = rule_output(bmer, strtok(NULL, ""));
+      }
+      else if(bmer->n == RULE_MAX) res = -1;
+      else if((res = rule_parse(&bmer->r[bmer->n], tok)) == 0) bmer->n++;
+      if(res != 0) {
+         printf("Error: invalid rule in %s line %d.\n", file, lineno);
+         fclose(fp);
+         rule_close(bmer);
+         return(-1);
+      }
+   }
+   fclose(fp);
+   if(bmer->n == 0) {
+      printf("Error: no rules in %s.\n", file);
+      rule_close(bmer);
+      return(-1);
+   }
+   if(verbose == 1) printf("Debug: Rules: [%d] from [%s] output [%d]\n", bmer->n, file, bmer->out);
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * rule_emit() writes one state change to the event output. A   *
+ * hook gets the event in BME_* variables, and is not waited    *
+ * for: finished hooks are reaped with the next event.          *
+ * ------------------------------------------------------------ */
+static void rule_emit(struct bmerules *bmer, struct bmerule *r, int64_t ts, float val) {
+   char line[256];
+   char *unit = "";
+   for(int i = 0; i < 3; i++) if(rule_chans[i].chan == r->chan) unit = rule_chans[i].unit;
+
+   int len = snprintf(line, sizeof(line), "%lld Rule=%s State=%s Value=%.2f%s%s Limit=%.2f%s%s\n",
+                      (long long) ts, r->name, r->on ? "on" : "off", val, unit,
+                      r->rate ? "/h" : "", r->sign * r->limit, unit, r->rate ? "/h" : "");
+   if(len >= (int) sizeof(line)) len = sizeof(line) - 1;
+   bmer->events++;
+
+   switch(bmer->out) {
+      case RULE_STDOUT:
+         fputs(line, stdout);
+         fflush(stdout);
+         break;
+
+      case RULE_SOCKET:
+         if(send(bmer->fd, line, len, MSG_DONTWAIT) != len && verbose == 1)
+            printf("Debug: Rule event not sent: [%s]\n", r->name);
+         break;
+
+      case RULE_EXEC: {
+         /* ------------------------------------------------------- *
+          * The output thread shares the process with the sampler,  *
+          * so the child may only call async-signal-safe functions: *
+          * the hook environment is built here, before the fork(),  *
+          * from environ without old BME_* entries, and the BME_*   *
+          * variables of this event.                                *
+          * ------------------------------------------------------- */
+         char envs[5][320];
+         line[len - 1] = '\0';
+         snprintf(envs[0], sizeof(envs[0]), "BME_EVENT=%s", line);
+         snprintf(envs[1], sizeof(envs[1]), "BME_RULE=%s", r->name);
+         snprintf(envs[2], sizeof(envs[2]), "BME_STATE=%s", r->on ? "on" : "off");
+         snprintf(envs[3], sizeof(envs[3]), "BME_VALUE=%.2f", val);
+         snprintf(envs[4], sizeof(envs[4]), "BME_TIME=%lld", (long long) ts);
+
+         int n = 0;
+         while(environ[n] != NULL) n++;
+         char **envp = malloc((n + 6) * sizeof(char *));
+         if(envp == NULL) {
+            printf("Error: cannot start the rule hook for %s.\n", r->name);
+            break;
+         }
+         n = 0;
+         for(char **e = environ; *e != NULL; e++)
+            if(strncmp(*e, "BME_", 4) != 0) envp[n++] = *e;
+         for(int i = 0; i < 5; i++) envp[n++] = envs[i];
+         envp[n] = NULL;
+
+         while(waitpid(-1, NULL, WNOHANG) > 0);
+         pid_t pid = fork();
+         if(pid == 0) {
+            execle("/bin/sh", "sh", "-c", bmer->cmd, (char *) NULL, envp);
+            _exit(127);
+         }
+         free(envp);
+         if(pid < 0) printf("Error: cannot start the rule hook for %s.\n", r->name);
+         break;
+      }
+   }
+}
+
+/* ------------------------------------------------------------ *
+ * rule_check() checks all rules against one sample. Skipped    *
+ * channels (NAN) leave the rule state as it is.                *
+ * ------------------------------------------------------------ */
+void rule_check(struct bmerules *bmer, int64_t ts, struct bmedata *bmed) {
+   for(int i = 0; i < bmer->n; i++) {
+      struct bmerule *r = &bmer->r[i];
+      float val = r->chan == CHAN_T ? bmed->temp_c
+                : r->chan == CHAN_H ? bmed->humi_p : bmed->pres_p / 100;
+      if(isnan(val)) continue;
+
+      /* ---------------------------------------------------------- *
+       * Rate rules sum up the window, and check the change of the  *
+       * window mean once the window is complete                    *
+       * ---------------------------------------------------------- */
+      if(r->rate == 1) {
+         if(r->wstart != 0 && ts < r->wstart + r->window) {
+            r->sum += val;
+            r->n++;
+            continue;
+         }
+         float mean = r->n > 0 ? r->sum / r->n : 0;
+         int64_t pstart = r->pstart;
+         double prev = r->prev;
+         if(r->wstart != 0) {
+            r->prev = mean;
+            r->pstart = r->wstart;
+         }
+         r->wstart = ts;
+         r->sum = val;
+         r->n = 1;
+         if(pstart == 0) continue;
+         val = (mean - prev) * 3600.0 / (r->pstart - pstart);
+      }
+
+      float x = r->sign * val;
+      if(r->on == 0 && x > r->limit) r->on = 1;
+      else if(r->on == 1 && x < r->limit - r->hyst) r->on = 0;
+      else continue;
+      rule_emit(bmer, r, ts, val);
+   }
+}
+
+/* ------------------------------------------------------------ *
+ * rule_close() closes the event socket, and reaps the hooks    *
+ * that are done                                                *
+ * ------------------------------------------------------------ */
+void rule_close(struct bmerules *bmer) {
+   if(bmer->fd >= 0) close(bmer->fd);
+   bmer->fd = -1;
+   if(bmer->out == RULE_EXEC) while(waitpid(-1, NULL, WNOHANG) > 0);
+   if(verbose == 1) printf("Debug: Rule events: [%ld]\n", bmer->events);
+}
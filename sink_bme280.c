@@ -0,0 +1,198 @@
+/* ------------------------------------------------------------ *
+ * file:        sink_bme280.c                                   *
+ * purpose:     Sample queue and output thread for continuous   *
+ *              mode "-c". The sampling loop pushes samples     *
+ *              into a bounded lock-free single-producer single *
+ *              consumer ring, a sink thread pops them and runs *
+ *              the outputs (stdout, HTML file, store file). A  *
+ *              slow SD card or a blocked stdout pipe then no   *
+ *              longer delays the next sensor read.             *
+ *                                                              *
+ *              When the ring is full, the producer either      *
+ *              drops the oldest queued sample (BMEQ_DROP), or  *
+ *              waits for the sink (BMEQ_BLOCK). Both cases are *
+ *              counted in the queue statistics.                *
+ *                                                              *
+ * author:      10/18/2026 agent                                *
+ * ------------------------------------------------------------ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <unistd.h>
+#include "getbme280.h"
+
+extern int verbose;
+
+/* ------------------------------------------------------------ *
+ * The ring indices only grow, slot = index & mask. head is     *
+ * written by the producer only. tail is advanced by the sink,  *
+ * and with BMEQ_DROP also by the producer when the ring is     *
+ * full, so both advance it with compare-and-swap. The sink     *
+ * copies a slot before it claims it; if the producer dropped   *
+ * the slot meanwhile, the claim fails and the copy is thrown   *
+ * away. The semaphore only wakes up the sink, it may count     *
+ * more entries than are left after drops.                      *
+ * ------------------------------------------------------------ */
+struct bmeq{
+   _Atomic uint64_t head;     // next slot to write
+   _Atomic uint64_t tail;     // next slot to read
+   _Atomic int closed;        // no more pushes, sink drains and ends
+   uint64_t mask;             // ring size - 1, size is a power of 2
+   int policy;                // BMEQ_DROP or BMEQ_BLOCK
+   sem_t ready;               // posted once per pushed sample
+   _Atomic uint64_t pushed;   // samples pushed
+   _Atomic uint64_t popped;   // samples handed to the outputs
+   _Atomic uint64_t dropped;  // samples dropped on overflow
+   _Atomic uint64_t blocked;  // pushes that had to wait
+   _Atomic uint64_t maxfill;  // highest fill level seen
+   void (*out)(struct bmesample*); // output function of the sink
+   pthread_t thread;          // sink thread
+   struct bmesample slot[];   // ring buffer
+};
+
+/* ------------------------------------------------------------ *
+ * bmeq_create() allocates a queue for size samples, rounded up *
+ * to a power of 2. Returns NULL on errors.                     *
+ * ------------------------------------------------------------ */
+struct bmeq *bmeq_create(int size, int policy) {
+   uint64_t n = 1;
+   while(n < (uint64_t) size) n <<= 1;
+
+   struct bmeq *q = calloc(1, sizeof(*q) + n * sizeof(q->slot[0]));
+   if(q == NULL) {
+      printf("Error: cannot allocate a sample queue of %d entries.\n", size);
+      return NULL;
+   }
+   q->mask = n - 1;
+   q->policy = policy;
+   if(sem_init(&q->ready, 0, 0) != 0) {
+      printf("Error: cannot create the sample queue semaphore.\n");
+      free(q);
+      return NULL;
+   }
+   if(verbose == 1) printf("Debug: Sample queue: [%llu] entries, on overflow [%s]\n",
+                           (unsigned long long) n, policy == BMEQ_DROP ? "drop oldest" : "block");
+   return q;
+}
+
+/* ------------------------------------------------------------ *
+ * bmeq_push() queues one sample, called from the sampling loop *
+ * only. Returns 0, or 1 if an older sample had to be dropped.  *
+ * ------------------------------------------------------------ */
+int bmeq_push(struct bmeq *q, struct bmesample *bmes) {
+   int res = 0;
+   uint64_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+   uint64_t tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+
+   if(head - tail > q->mask) {
+      if(q->policy == BMEQ_BLOCK) {
+         atomic_fetch_add(&q->blocked, 1);
+         while(head - atomic_load_explicit(&q->tail, memory_order_acquire) > q->mask)
+            usleep(1000);
+      }
+      else {
+         /* ------------------------------------------------------- *
+          * Drop the oldest sample, unless the sink just took it    *
+          * ------------------------------------------------------- */
+         if(atomic_compare_exchange_strong(&q->tail, &tail, tail + 1)) {
+            atomic_fetch_add(&q->dropped, 1);
+            res = 1;
+         }
+      }
+   }
+
+   q->slot[head & q->mask] = *bmes;
+   atomic_store_explicit(&q->head, head + 1, memory_order_release);
+   atomic_fetch_add(&q->pushed, 1);
+
+   uint64_t fill = head + 1 - atomic_load_explicit(&q->tail, memory_order_relaxed);
+   if(fill > atomic_load_explicit(&q->maxfill, memory_order_relaxed))
+      atomic_store_explicit(&q->maxfill, fill, memory_order_relaxed);
+   sem_post(&q->ready);
+   return(res);
+}
+
+/* ------------------------------------------------------------ *
+ * bmeq_pop() takes the oldest sample, waiting for one if the   *
+ * queue is empty. Returns 0, or -1 if the queue is closed and  *
+ * all samples are taken.                                       *
+ * ------------------------------------------------------------ */
+int bmeq_pop(struct bmeq *q, struct bmesample *bmes) {
+   for(;;) {
+      uint64_t tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+      uint64_t head = atomic_load_explicit(&q->head, memory_order_acquire);
+
+      if(tail == head) {
+         /* ------------------------------------------------------- *
+          * Check closed first, then head again: a last push before *
+          * sink_stop() is seen here, and taken with the next loop  *
+          * ------------------------------------------------------- */
+         if(atomic_load(&q->closed)) {
+            head = atomic_load_explicit(&q->head, memory_order_acquire);
+            if(head == tail) return(-1);
+            continue;
+         }
+         sem_wait(&q->ready);
+         continue;
+      }
+      *bmes = q->slot[tail & q->mask];
+      if(atomic_compare_exchange_strong(&q->tail, &tail, tail + 1)) {
+         atomic_fetch_add(&q->popped, 1);
+         return(0);
+      }
+   }
+}
+
+/* ------------------------------------------------------------ *
+ * sink_run() is the sink thread, it passes every sample to the *
+ * output function until the queue is closed and drained.       *
+ * ------------------------------------------------------------ */
+static void *sink_run(void *arg) {
+   struct bmeq *q = arg;
+   struct bmesample bmes;
+
+   while(bmeq_pop(q, &bmes) == 0) q->out(&bmes);
+   return NULL;
+}
+
+/* ------------------------------------------------------------ *
+ * sink_start() starts the sink thread with an output function. *
+ * The thread blocks all signals, so SIGINT/SIGTERM reach the   *
+ * sampling loop. Returns 0, or -1 on errors.                   *
+ * ------------------------------------------------------------ */
+int sink_start(struct bmeq *q, void (*out)(struct bmesample*)) {
+   sigset_t all, old;
+   sigfillset(&all);
+   pthread_sigmask(SIG_BLOCK, &all, &old);
+
+   q->out = out;
+   int res = pthread_create(&q->thread, NULL, sink_run, q);
+   pthread_sigmask(SIG_SETMASK, &old, NULL);
+   if(res != 0) {
+      printf("Error: cannot start the output thread.\n");
+      return(-1);
+   }
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * sink_stop() closes the queue, waits until the sink thread    *
+ * has written all queued samples, and frees the queue.         *
+ * ------------------------------------------------------------ */
+void sink_stop(struct bmeq *q) {
+   atomic_store(&q->closed, 1);
+   sem_post(&q->ready);
+   pthread_join(q->thread, NULL);
+
+   if(verbose == 1) printf("Debug: Sample queue: pushed [%llu] written [%llu] dropped [%llu] blocked [%llu] max fill [%llu]\n",
+                           (unsigned long long) q->pushed, (unsigned long long) q->popped,
+                           (unsigned long long) q->dropped, (unsigned long long) q->blocked,
+                           (unsigned long long) q->maxfill);
+   sem_destroy(&q->ready);
+   free(q);
+}
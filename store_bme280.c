@@ -0,0 +1,459 @@
+/* ------------------------------------------------------------ *
+ * file:        store_bme280.c                                  *
+ * purpose:     Compressed long-term sample storage. Samples    *
+ *              are kept as raw adc words, which change slowly  *
+ *              between readings and compress very well:        *
+ *                                                              *
+ *              file  = header | block | block | ...            *
+ *              header: "BMEZ", version, sensor calibration     *
+ *              block:  36 byte block header with the sample    *
+ *                      count, bit length, first/last timestamp *
+ *                      and the first sample, then a bitstream  *
+ *                      of the following samples:               *
+ *                      - timestamp delta-of-delta              *
+ *                      - adc_t, adc_p, adc_h zigzag deltas     *
+ *                      each as a short prefix code + payload.  *
+ *                                                              *
+ *              At 1 Hz with stable readings a sample takes     *
+ *              about 12-16 bits. The block headers double as   *
+ *              a sparse time index for "getbme280 query".      *
+ *                                                              *
+ * author:      10/18/2026 agent                                *
+ * ------------------------------------------------------------ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "getbme280.h"
+
+extern int verbose;
+
+/* ------------------------------------------------------------ *
+ * Little-endian field access for the file and block headers    *
+ * ------------------------------------------------------------ */
+static void put_le(uint8_t *p, uint64_t val, int len) {
+   for(int i = 0; i < len; i++) p[i] = (val >> (8 * i)) & 0xFF;
+}
+
+static uint64_t get_le(const uint8_t *p, int len) {
+   uint64_t val = 0;
+   for(int i = len - 1; i >= 0; i--) val = (val << 8) | p[i];
+   return val;
+}
+
+/* ------------------------------------------------------------ *
+ * Bitstream writer and reader, most significant bit first      *
+ * ------------------------------------------------------------ */
+static void put_bits(struct bmezw *w, uint32_t val, int n) {
+   uint8_t *p = w->blk + BMEZ_BLKHDR;
+   while(n > 0) {
+      int room = 8 - (w->nbits & 7);
+      int take = n < room ? n : room;
+      uint8_t bits = (val >> (n - take)) & ((1 << take) - 1);
+      p[w->nbits >> 3] |= bits << (room - take);
+      w->nbits += take;
+      n -= take;
+   }
+}
+
+struct bitrd {
+   const uint8_t *p;  // payload start
+   uint32_t pos;      // current bit position
+   uint32_t end;      // payload length in bits
+};
+
+static int get_bits(struct bitrd *r, int n, uint32_t *val) {
+   if(r->pos + n > r->end) return -1;
+   uint32_t v = 0;
+   while(n > 0) {
+      int room = 8 - (r->pos & 7);
+      int take = n < room ? n : room;
+      uint8_t byte = r->p[r->pos >> 3];
+      v = (v << take) | ((byte >> (room - take)) & ((1 << take) - 1));
+      r->pos += take;
+      n -= take;
+   }
+   *val = v;
+   return 0;
+}
+
+/* ------------------------------------------------------------ *
+ * Prefix codes: ts delta-of-delta is signed, in 5 size classes *
+ * 0 | 10+7 | 110+9 | 1110+12 | 1111+32 bits. The adc deltas    *
+ * are zigzag mapped to unsigned, classes 0 | 10+2 | 110+5 |    *
+ * 1110+9 | 1111+21 bits, enough for any 20-bit delta.          *
+ * ------------------------------------------------------------ */
+static const int ts_bits[]  = { 0, 7, 9, 12, 32 };
+static const int adc_bits[] = { 0, 2, 5, 9, 21 };
+
+static void put_class(struct bmezw *w, int cls, uint32_t val, const int *bits) {
+   if(cls < 4) put_bits(w, ((1 << cls) - 1) << 1, cls + 1);
+   else put_bits(w, 0x0F, 4);
+   if(bits[cls] > 0) put_bits(w, val, bits[cls]);
+}
+
+static int get_class(struct bitrd *r, uint32_t *val, const int *bits) {
+   int cls = 0;
+   uint32_t bit;
+   while(cls < 4) {
+      if(get_bits(r, 1, &bit) != 0) return -1;
+      if(bit == 0) break;
+      cls++;
+   }
+   *val = 0;
+   if(bits[cls] > 0 && get_bits(r, bits[cls], val) != 0) return -1;
+   return cls;
+}
+
+static void put_dod(struct bmezw *w, int64_t dod) {
+   int cls;
+   if(dod == 0) cls = 0;
+   else if(dod >= -64 && dod < 64) cls = 1;
+   else if(dod >= -256 && dod < 256) cls = 2;
+   else if(dod >= -2048 && dod < 2048) cls = 3;
+   else cls = 4;
+   put_class(w, cls, (uint32_t) dod & (cls == 4 ? 0xFFFFFFFF : (1u << ts_bits[cls]) - 1), ts_bits);
+}
+
+static int get_dod(struct bitrd *r, int64_t *dod) {
+   uint32_t val;
+   int cls = get_class(r, &val, ts_bits);
+   if(cls < 0) return -1;
+   if(cls == 0) { *dod = 0; return 0; }
+   if(cls == 4) { *dod = (int32_t) val; return 0; }
+   int n = ts_bits[cls];
+   *dod = (val & (1u << (n - 1))) ? (int64_t) val - (1 << n) : (int64_t) val;
+   return 0;
+}
+
+static void put_delta(struct bmezw *w, int32_t delta) {
+   uint32_t zz = ((uint32_t) delta << 1) ^ (uint32_t) (delta >> 31);
+   int cls;
+   if(zz == 0) cls = 0;
+   else if(zz < 4) cls = 1;
+   else if(zz < 32) cls = 2;
+   else if(zz < 512) cls = 3;
+   else cls = 4;
+   put_class(w, cls, zz, adc_bits);
+}
+
+static int get_delta(struct bitrd *r, int32_t *delta) {
+   uint32_t zz;
+   if(get_class(r, &zz, adc_bits) < 0) return -1;
+   *delta = (int32_t) (zz >> 1) ^ -(int32_t) (zz & 1);
+   return 0;
+}
+
+/* ------------------------------------------------------------ *
+ * Calibration data is serialized field by field, 33 bytes      *
+ * ------------------------------------------------------------ */
+static void put_calib(uint8_t *p, struct bmecal *bmec) {
+   put_le(p +  0, bmec->dig_T1, 2); put_le(p +  2, bmec->dig_T2, 2);
+   put_le(p +  4, bmec->dig_T3, 2); put_le(p +  6, bmec->dig_P1, 2);
+   put_le(p +  8, bmec->dig_P2, 2); put_le(p + 10, bmec->dig_P3, 2);
+   put_le(p + 12, bmec->dig_P4, 2); put_le(p + 14, bmec->dig_P5, 2);
+   put_le(p + 16, bmec->dig_P6, 2); put_le(p + 18, bmec->dig_P7, 2);
+   put_le(p + 20, bmec->dig_P8, 2); put_le(p + 22, bmec->dig_P9, 2);
+   put_le(p + 24, bmec->dig_H1, 1); put_le(p + 25, bmec->dig_H2, 2);
+   put_le(p + 27, bmec->dig_H3, 1); put_le(p + 28, bmec->dig_H4, 2);
+   put_le(p + 30, bmec->dig_H5, 2); put_le(p + 32, bmec->dig_H6, 1);
+}
+
+/* ------------------------------------------------------------ *
+ * bmez_calib() reads the calibration from a store file header. *
+ * Returns 0 on success, -1 if the header is not a BMEZ header. *
+ * ------------------------------------------------------------ */
+int bmez_calib(const uint8_t *hdr, size_t len, struct bmecal *bmec) {
+   if(len < BMEZ_HDRSIZE || memcmp(hdr, BMEZ_MAGIC, 4) != 0) return -1;
+   if(hdr[4] != BMEZ_VERSION) return -1;
+   const uint8_t *p = hdr + 8;
+   bmec->dig_T1 = get_le(p +  0, 2); bmec->dig_T2 = get_le(p +  2, 2);
+   bmec->dig_T3 = get_le(p +  4, 2); bmec->dig_P1 = get_le(p +  6, 2);
+   bmec->dig_P2 = get_le(p +  8, 2); bmec->dig_P3 = get_le(p + 10, 2);
+   bmec->dig_P4 = get_le(p + 12, 2); bmec->dig_P5 = get_le(p + 14, 2);
+   bmec->dig_P6 = get_le(p + 16, 2); bmec->dig_P7 = get_le(p + 18, 2);
+   bmec->dig_P8 = get_le(p + 20, 2); bmec->dig_P9 = get_le(p + 22, 2);
+   bmec->dig_H1 = get_le(p + 24, 1); bmec->dig_H2 = get_le(p + 25, 2);
+   bmec->dig_H3 = get_le(p + 27, 1); bmec->dig_H4 = get_le(p + 28, 2);
+   bmec->dig_H5 = get_le(p + 30, 2); bmec->dig_H6 = get_le(p + 32, 1);
+   return 0;
+}
+
+/* ------------------------------------------------------------ *
+ * bmez_block() decodes a block header. Returns the total block *
+ * length in bytes, or 0 if blk holds no valid block header.    *
+ * The caller checks that the returned length is available.     *
+ * ------------------------------------------------------------ */
+size_t bmez_block(const uint8_t *blk, size_t avail, struct bmezb *bmeb) {
+   if(avail < BMEZ_BLKHDR || blk[0] != 'Z' || blk[1] != 'B') return 0;
+   bmeb->count    = get_le(blk +  2, 2);
+   bmeb->nbits    = get_le(blk +  4, 4);
+   bmeb->first_ts = get_le(blk +  8, 8);
+   bmeb->last_ts  = get_le(blk + 16, 8);
+   if(bmeb->count == 0 || bmeb->count > BMEZ_BLKSAMPLES) return 0;
+   if(bmeb->nbits > BMEZ_BLKBYTES * 8) return 0;
+   return BMEZ_BLKHDR + (bmeb->nbits + 7) / 8;
+}
+
+/* ------------------------------------------------------------ *
+ * bmez_decode() decodes all samples of a block into bmes,      *
+ * which must hold BMEZ_BLKSAMPLES entries. Returns the sample  *
+ * count, or -1 if the block is incomplete or corrupt.          *
+ * ------------------------------------------------------------ */
+int bmez_decode(const uint8_t *blk, size_t avail, struct bmezs *bmes) {
+   struct bmezb bmeb;
+   size_t len = bmez_block(blk, avail, &bmeb);
+   if(len == 0 || len > avail) return -1;
+
+   bmes[0].ts    = bmeb.first_ts;
+   bmes[0].adc_t = get_le(blk + 24, 4);
+   bmes[0].adc_p = get_le(blk + 28, 4);
+   bmes[0].adc_h = get_le(blk + 32, 4);
+
+   struct bitrd r = { blk + BMEZ_BLKHDR, 0, bmeb.nbits };
+   int64_t delta = 0, dod;
+   int32_t dt, dp, dh;
+   for(int i = 1; i < bmeb.count; i++) {
+      if(get_dod(&r, &dod) != 0 || get_delta(&r, &dt) != 0 ||
+         get_delta(&r, &dp) != 0 || get_delta(&r, &dh) != 0) return -1;
+      delta += dod;
+      bmes[i].ts    = bmes[i-1].ts + delta;
+      bmes[i].adc_t = bmes[i-1].adc_t + dt;
+      bmes[i].adc_p = bmes[i-1].adc_p + dp;
+      bmes[i].adc_h = bmes[i-1].adc_h + dh;
+   }
+   return bmeb.count;
+}
+
+/* ------------------------------------------------------------ *
+ * bmez_resume() reloads the last block of an existing store if *
+ * it still has room, so that repeated "-t -z" runs or restarts *
+ * of "-c -z" keep filling it instead of starting a new block.  *
+ * ------------------------------------------------------------ */
+static int bmez_resume(struct bmezw *w, off_t off, size_t len) {
+   static struct bmezs bmes[BMEZ_BLKSAMPLES];
+   if(pread(w->fd, w->blk, len, off) != (ssize_t) len) return -1;
+   int n = bmez_decode(w->blk, len, bmes);
+   if(n < 0) return -1;
+
+   w->blkoff     = off;
+   w->count      = n;
+   w->nbits      = get_le(w->blk + 4, 4);
+   w->first_ts   = bmes[0].ts;
+   w->last_delta = n > 1 ? bmes[n-1].ts - bmes[n-2].ts : 0;
+   w->last.ts    = bmes[n-1].ts;
+   w->last.adc_t = bmes[n-1].adc_t;
+   w->last.adc_p = bmes[n-1].adc_p;
+   w->last.adc_h = bmes[n-1].adc_h;
+   return 0;
+}
+
+/* ------------------------------------------------------------ *
+ * bmez_open() opens or creates a store file for appending. An  *
+ * existing file must hold the same sensor calibration. Returns *
+ * 0 on success, -1 on errors.                                  *
+ * ------------------------------------------------------------ */
+int bmez_open(struct bmezw *w, char *file, struct bmecal *bmec) {
+   uint8_t hdr[BMEZ_HDRSIZE] = {0};
+   struct stat st;
+
+   memset(w, 0, sizeof(*w));
+   if((w->fd = open(file, O_RDWR | O_CREAT, 0644)) < 0) {
+      printf("Error open %s for writing.\n", file);
+      return(-1);
+   }
+   if(fstat(w->fd, &st) != 0) {
+      printf("Error: cannot stat %s.\n", file);
+      close(w->fd);
+      return(-1);
+   }
+
+   /* ---------------------------------------------------------- *
+    * New file: write the header with the sensor calibration     *
+    * ---------------------------------------------------------- */
+   if(st.st_size == 0) {
+      memcpy(hdr, BMEZ_MAGIC, 4);
+      hdr[4] = BMEZ_VERSION;
+      put_calib(hdr + 8, bmec);
+      if(pwrite(w->fd, hdr, BMEZ_HDRSIZE, 0) != BMEZ_HDRSIZE) {
+         printf("Error: write failure for %s.\n", file);
+         close(w->fd);
+         return(-1);
+      }
+      w->blkoff = BMEZ_HDRSIZE;
+      if(verbose == 1) printf("Debug: New store file: [%s]\n", file);
+      return(0);
+   }
+
+   /* ---------------------------------------------------------- *
+    * Existing file: samples must come from the same sensor      *
+    * ---------------------------------------------------------- */
+   uint8_t cal[33];
+   put_calib(cal, bmec);
+   if(pread(w->fd, hdr, BMEZ_HDRSIZE, 0) != BMEZ_HDRSIZE
+      || memcmp(hdr, BMEZ_MAGIC, 4) != 0 || hdr[4] != BMEZ_VERSION) {
+      printf("Error: %s is not a BME280 store file.\n", file);
+      close(w->fd);
+      return(-1);
+   }
+   if(memcmp(hdr + 8, cal, sizeof(cal)) != 0) {
+      printf("Error: %s holds data from a different sensor.\n", file);
+      close(w->fd);
+      return(-1);
+   }
+
+   /* ---------------------------------------------------------- *
+    * Walk the block headers to the end of the valid data        *
+    * ---------------------------------------------------------- */
+   off_t off = BMEZ_HDRSIZE, last = -1;
+   size_t lastlen = 0;
+   int lastcount = 0;
+   struct bmezb bmeb;
+   uint8_t bh[BMEZ_BLKHDR];
+   while(off + BMEZ_BLKHDR <= st.st_size) {
+      if(pread(w->fd, bh, BMEZ_BLKHDR, off) != BMEZ_BLKHDR) break;
+      size_t len = bmez_block(bh, BMEZ_BLKHDR, &bmeb);
+      if(len == 0 || off + (off_t) len > st.st_size) break;
+      last = off;
+      lastlen = len;
+      lastcount = bmeb.count;
+      off += len;
+   }
+   w->blkoff = off;
+   if(off < st.st_size) {
+      if(verbose == 1) printf("Debug: Drop incomplete tail: [%lld bytes]\n",
+                              (long long) (st.st_size - off));
+      if(ftruncate(w->fd, off) != 0) {
+         printf("Error: cannot truncate %s.\n", file);
+         close(w->fd);
+         return(-1);
+      }
+   }
+   if(last >= 0 && lastcount < BMEZ_BLKSAMPLES) {
+      if(bmez_resume(w, last, lastlen) != 0) {
+         memset(w->blk, 0, sizeof(w->blk));
+         w->blkoff = off;
+         w->count = 0;
+      }
+   }
+   if(verbose == 1) printf("Debug: Store block offset: [%lld] samples [%d]\n",
+                           (long long) w->blkoff, w->count);
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * bmez_next() closes the written open block, the next sample   *
+ * starts a new block behind it.                                *
+ * ------------------------------------------------------------ */
+static void bmez_next(struct bmezw *w) {
+   w->blkoff += BMEZ_BLKHDR + (w->nbits + 7) / 8;
+   w->count = 0;
+   w->nbits = 0;
+   memset(w->blk, 0, sizeof(w->blk));
+}
+
+/* ------------------------------------------------------------ *
+ * bmez_flush() writes the open block to its place in the file. *
+ * A full block is closed and the next one starts after it.     *
+ * The bitstream goes first and the block header last: samples  *
+ * are only appended to the bitstream, so after a crash between *
+ * the two writes the old header still describes valid data. A  *
+ * sync policy orders the two writes on the storage as well.    *
+ * ------------------------------------------------------------ */
+int bmez_flush(struct bmezw *w) {
+   if(w->count == 0) return(0);
+
+   w->blk[0] = 'Z';
+   w->blk[1] = 'B';
+   put_le(w->blk +  2, w->count, 2);
+   put_le(w->blk +  4, w->nbits, 4);
+   put_le(w->blk +  8, w->first_ts, 8);
+   put_le(w->blk + 16, w->last.ts, 8);
+
+   size_t len = BMEZ_BLKHDR + (w->nbits + 7) / 8;
+   size_t bits = len - BMEZ_BLKHDR;
+   if(bits > 0 && pwrite(w->fd, w->blk + BMEZ_BLKHDR, bits, w->blkoff + BMEZ_BLKHDR) != (ssize_t) bits) {
+      printf("Error: store write failure at offset %lld\n", (long long) w->blkoff);
+      return(-1);
+   }
+   if(bits > 0 && w->sync != SYNC_NONE && bme_sync(w->fd, w->sync) != 0) return(-1);
+   if(pwrite(w->fd, w->blk, BMEZ_BLKHDR, w->blkoff) != BMEZ_BLKHDR) {
+      printf("Error: store write failure at offset %lld\n", (long long) w->blkoff);
+      return(-1);
+   }
+   if(w->count == BMEZ_BLKSAMPLES) bmez_next(w);
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * bmez_commit() writes the open block and syncs the store with *
+ * its sync policy, for the group commit of "-c".               *
+ * ------------------------------------------------------------ */
+int bmez_commit(struct bmezw *w) {
+   if(bmez_flush(w) != 0) return(-1);
+   return bme_sync(w->fd, w->sync);
+}
+
+/* ------------------------------------------------------------ *
+ * bmez_put() appends one sample to the open block. The block   *
+ * goes to disk when it is full, or with bmez_flush/bmez_close. *
+ * ------------------------------------------------------------ */
+int bmez_put(struct bmezw *w, int64_t ts, struct bmedata *bmed) {
+   int64_t delta = ts - w->last.ts;
+   int64_t dod = delta - w->last_delta;
+
+   /* ---------------------------------------------------------- *
+    * The store has no skip flags, a skip value means a skipped  *
+    * channel. A real reading of that value is stored 1 LSB off. *
+    * ---------------------------------------------------------- */
+   int32_t adc_t = bmed->adc_t, adc_p = bmed->adc_p, adc_h = bmed->adc_h;
+   int real = CHAN_ALL & ~bmed->skip;
+   if((real & CHAN_T) && adc_t == ADC_T_SKIPPED) adc_t++;
+   if((real & CHAN_P) && adc_p == ADC_P_SKIPPED) adc_p++;
+   if((real & CHAN_H) && adc_h == ADC_H_SKIPPED) adc_h++;
+
+   /* ---------------------------------------------------------- *
+    * Timestamp jumps beyond 32 bit, e.g. a wrong system clock,  *
+    * start a new block which keeps the full 64 bit timestamp.   *
+    * ---------------------------------------------------------- */
+   if(w->count > 0 && (dod < INT32_MIN || dod > INT32_MAX)) {
+      if(bmez_flush(w) != 0) return(-1);
+      bmez_next(w);
+   }
+
+   if(w->count == 0) {
+      w->first_ts = ts;
+      w->last_delta = 0;
+      put_le(w->blk + 24, adc_t, 4);
+      put_le(w->blk + 28, adc_p, 4);
+      put_le(w->blk + 32, adc_h, 4);
+   }
+   else {
+      put_dod(w, dod);
+      put_delta(w, adc_t - w->last.adc_t);
+      put_delta(w, adc_p - w->last.adc_p);
+      put_delta(w, adc_h - w->last.adc_h);
+      w->last_delta = delta;
+   }
+   w->last.ts    = ts;
+   w->last.adc_t = adc_t;
+   w->last.adc_p = adc_p;
+   w->last.adc_h = adc_h;
+   w->count++;
+
+   if(w->count == BMEZ_BLKSAMPLES) return bmez_flush(w);
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * bmez_close() commits the open block and closes the store.    *
+ * ------------------------------------------------------------ */
+int bmez_close(struct bmezw *w) {
+   int res = bmez_commit(w);
+   if(close(w->fd) != 0) res = -1;
+   w->fd = -1;
+   return(res);
+}
@@ -0,0 +1,478 @@
+/* ------------------------------------------------------------ *
+ * file:        sweep_bme280.c                                  *
+ * purpose:     Characterization sweep, the "sweep" subcommand. *
+ *              It steps the sensor through all oversampling,   *
+ *              IIR filter and standby combinations, and takes  *
+ *              N samples of each one. Per combination it       *
+ *              reports the conversion time from the status     *
+ *              register, the sample interval, the I2C latency  *
+ *              of the data read and the status poll, and per   *
+ *              channel the RMS noise and the Allan deviation.  *
+ *              The report is CSV, one line per combination, or *
+ *              JSON with the Allan deviation over all tau.     *
+ *                                                              *
+ *              forced mode: trigger, poll the measuring bit    *
+ *              back-to-back until it clears, read.             *
+ *              normal mode: sleep for most of the standby,     *
+ *              poll for the next measuring bit 1 -> 0 edge,    *
+ *              read. No edge within two periods counts as no   *
+ *              conversion time, and the data is read anyway.   *
+ *                                                              *
+ * example:	./getbme280 sweep -n 64 -o units/node17.csv     *
+ *                                                              *
+ * author:      10/18/2026 agent                                *
+ * ------------------------------------------------------------ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "getbme280.h"
+
+extern int verbose;
+extern struct bmesensor sensors[];
+extern int nsensors;
+
+#define SW_SAMPLES        32    // default samples per combination
+#define SW_SAMPLES_MAX  10000   // max. samples per combination
+#define SW_LISTMAX         16   // max. values per -T/-P/-H/-F/-S list
+#define SW_TAUS            14   // max. Allan deviation points, tau = 2^k samples
+
+struct swstat{       // the results of one combination
+   int n;            // samples
+   double interval;  // mean sample interval in ms
+   double conv;      // mean conversion time in ms, NAN = no edge seen
+   double conv_max;  // max. conversion time in ms
+   double read_us;   // mean data read latency in us
+   double read_max;  // max. data read latency in us
+   double poll_us;   // mean status poll latency in us
+   float rms[3];     // RMS noise temp, pres, humi, NAN = skipped
+   int ntau;         // Allan deviation points
+   float adev[3][SW_TAUS]; // Allan deviation at tau = 2^k samples
+};
+
+static const struct { char *name; char *unit; } sw_chans[] = {
+   { "temp", "*C" },
+   { "pres", "Pa" },
+   { "humi", "%" },
+};
+
+static int sverbose = 0;  // -v, the per-sample debug output stays off
+
+/* ------------------------------------------------------------ *
+ * sweep_usage() prints the sweep subcommand instructions.      *
+ * ------------------------------------------------------------ */
+static void sweep_usage() {
+   printf("Usage: getbme280 sweep [-a i2c-addr] [-b i2c-bus] [-n samples] [-o file] [-j] [-T list] [-P list] [-H list] [-F list] [-S list] [-v]\n\
+\n\
+   -n        samples per combination, default: %d\n\
+   -o        write the report to a file, and the progress to stdout\n\
+   -j        JSON report, with the Allan deviation over all tau, default: CSV\n\
+   -T        temperature oversampling list, default: 1,2,4,8,16\n\
+   -P        pressure oversampling list, default: 1,2,4,8,16, can include skip\n\
+   -H        humidity oversampling list, default: 1,2,4,8,16, can include skip\n\
+   -F        IIR filter list, default: off,2,4,8,16\n\
+   -S        power mode and standby list, forced or the normal mode standby\n\
+             in ms, default: forced,0.5,10,20,62.5,125,250,500,1000\n\
+   -v        enable debug output\n\
+\n\
+Usage examples:\n\
+./getbme280 sweep -o node17.csv\n\
+./getbme280 sweep -n 256 -S forced -F off -j -o node17.json\n\
+./getbme280 sweep -b /dev/i2c-1:mux@0x70:2 -T 1 -P 1,16 -H skip -S forced,0.5 -o mux2.csv\n\n", SW_SAMPLES);
+}
+
+/* ------------------------------------------------------------ *
+ * sw_now() returns the monotonic time in ms                    *
+ * ------------------------------------------------------------ */
+static double sw_now() {
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+/* ------------------------------------------------------------ *
+ * sw_list() splits a -T/-P/-H/-F/-S list into its values, and  *
+ * checks them against the valid names. Returns the number of   *
+ * values, or -1 on errors.                                     *
+ * ------------------------------------------------------------ */
+static int sw_list(char *spec, char **names, int nnames, char *extra, char **list) {
+   int n = 0;
+   for(char *tok = strtok(spec, ","); tok != NULL; tok = strtok(NULL, ",")) {
+      int ok = (extra != NULL && strcmp(tok, extra) == 0);
+      for(int i = 0; i < nnames; i++) if(strcmp(tok, names[i]) == 0) ok = 1;
+      if(ok == 0 || n == SW_LISTMAX) return(-1);
+      list[n++] = tok;
+   }
+   return(n);
+}
+
+/* ------------------------------------------------------------ *
+ * sw_poll() reads the status register, and adds its latency.   *
+ * Returns the measuring bit, or -1 on errors.                  *
+ * ------------------------------------------------------------ */
+static int sw_poll(double *poll_sum, long *polls) {
+   double start = sw_now();
+   char st = get_status();
+   *poll_sum += sw_now() - start;
+   (*polls)++;
+   if((st & ~0x09) != 0) {
+      printf("Error: I2C read failure for the status register.\n");
+      return(-1);
+   }
+   return((st & 0x08) != 0);
+}
+
+/* ------------------------------------------------------------ *
+ * sw_sample() takes one sample in the configuration bmei, with *
+ * the calibration bmec. conv gets the conversion time in ms,   *
+ * NAN if no measuring edge was seen. Returns 0 or -1 on errors *
+ * ------------------------------------------------------------ */
+static int sw_sample(struct bmeinf *bmei, struct bmetime *bmet, struct bmecal *bmec,
+                     struct bmedata *bmed, double *conv, double *poll_sum, long *polls) {
+   int m;
+   *conv = NAN;
+   if(bmei->power_mode != normal) {
+      if(bme_trigger(bmei) != 0) return(-1);
+      double start = sw_now();
+      double deadline = start + 2 * bmet->meas_max + 10;
+      while((m = sw_poll(poll_sum, polls)) == 1 && sw_now() < deadline);
+      if(m != 0) {
+         if(m == 1) printf("Error: sensor conversion timeout.\n");
+         return(-1);
+      }
+      *conv = sw_now() - start;
+   }
+   else {
+      double period = 1000.0 / bmet->odr;
+      double idle = 0.9 * (period - bmet->meas_max);
+      if(idle > 1) usleep(idle * 1000);
+      double deadline = sw_now() + 2 * period + 10;
+      /* ------------------------------------------------------- *
+       * The first poll may land inside a conversion, so only a  *
+       * 0 -> 1 edge starts the timing: low is set by a poll     *
+       * with the measuring bit clear, before the rise.          *
+       * ------------------------------------------------------- */
+      double rise = 0;
+      int low = 0;
+      while(sw_now() < deadline) {
+         if((m = sw_poll(poll_sum, polls)) < 0) return(-1);
+         if(m == 0 && rise == 0) low = 1;
+         if(m == 1 && low == 1 && rise == 0) rise = sw_now();
+         if(m == 0 && rise > 0) {
+            *conv = sw_now() - rise;
+            break;
+         }
+      }
+   }
+   get_data(bmec, bmed);
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * sw_adev() returns the Allan deviation of n values at tau = m *
+ * samples, from the means of the n/m non-overlapping clusters  *
+ * ------------------------------------------------------------ */
+static float sw_adev(float *x, int n, int m) {
+   int k = n / m;
+   double prev = 0, sum = 0;
+   if(k < 2) return(NAN);
+   for(int c = 0; c < k; c++) {
+      double mean = 0;
+      for(int i = 0; i < m; i++) mean += x[c * m + i];
+      mean /= m;
+      if(c > 0) sum += (mean - prev) * (mean - prev);
+      prev = mean;
+   }
+   return(sqrt(sum / (2 * (k - 1))));
+}
+
+/* ------------------------------------------------------------ *
+ * sw_run() writes one combination, and measures it. buf holds  *
+ * 3 * n values. Returns 0 or -1 on errors.                     *
+ * ------------------------------------------------------------ */
+static int sw_run(struct bmepreset *bmpr, int n, float *buf, struct bmeinf *bmei,
+                  struct bmetime *bmet, struct swstat *sws) {
+   struct bmecal bmec;
+   struct bmedata bmed;
+   double poll_sum = 0, conv_sum = 0, read_sum = 0, first = 0, last = 0;
+   long polls = 0;
+   int nconv = 0;
+
+   if(set_preset(bmpr) != 0 || bme_snapshot(bmei) != 0) return(-1);
+   bme_timing(bmei, 1.0, bmet);
+   get_calib(&bmec);
+   memset(sws, 0, sizeof(*sws));
+
+   /* -- The samples until the IIR filter has settled are dropped -- */
+   int settle = bmei->filter_mode ? 2 << (bmei->filter_mode > 4 ? 4 : bmei->filter_mode) : 0;
+   for(int s = 0; s < settle + n; s++) {
+      double conv;
+      if(sw_sample(bmei, bmet, &bmec, &bmed, &conv, &poll_sum, &polls) != 0) return(-1);
+      if(s < settle) continue;
+
+      int i = s - settle;
+      buf[i] = bmed.temp_c;
+      buf[n + i] = bmed.pres_p;
+      buf[2 * n + i] = bmed.humi_p;
+      if(!isnan(conv)) {
+         conv_sum += conv;
+         if(conv > sws->conv_max) sws->conv_max = conv;
+         nconv++;
+      }
+      double lat = bmed.st.lat_ns / 1000.0;
+      read_sum += lat;
+      if(lat > sws->read_max) sws->read_max = lat;
+      last = bmed.st.mono_ns / 1e6;
+      if(i == 0) first = last;
+      if(sverbose == 1) printf("Debug: Sample [%d] conv [%.3fms] read [%.1fus]\n", i, conv, lat);
+   }
+   sws->n = n;
+   sws->interval = n > 1 ? (last - first) / (n - 1) : NAN;
+   sws->conv = nconv > 0 ? conv_sum / nconv : NAN;
+   if(nconv == 0) sws->conv_max = NAN;
+   sws->read_us = read_sum / n;
+   sws->poll_us = polls > 0 ? poll_sum * 1000 / polls : NAN;
+
+   int chans[3] = { bmei->osrs_t_mode, bmei->osrs_p_mode, bmei->osrs_h_mode };
+   for(int c = 0; c < 3; c++) {
+      sws->rms[c] = chans[c] ? bme_rms(buf + c * n, n) : NAN;
+      sws->ntau = 0;
+      for(int m = 1; m <= n / 2 && sws->ntau < SW_TAUS; m *= 2) {
+         sws->adev[c][sws->ntau++] = chans[c] ? sw_adev(buf + c * n, n, m) : NAN;
+      }
+   }
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * sw_num() prints a value for the report, NAN as an empty CSV  *
+ * field or JSON null                                           *
+ * ------------------------------------------------------------ */
+static void sw_num(FILE *fp, const char *fmt, double val, int json) {
+   if(isnan(val)) fputs(json ? "null" : "", fp);
+   else fprintf(fp, fmt, val);
+}
+
+/* ------------------------------------------------------------ *
+ * sw_report() writes one combination as CSV line or JSON       *
+ * object. The CSV has the Allan deviation at one sample.       *
+ * ------------------------------------------------------------ */
+static void sw_report(FILE *fp, int json, int count, struct bmepreset *bmpr,
+                      struct bmetime *bmet, struct swstat *sws) {
+   int nmode = (bmpr->mode == normal);
+   if(json == 0) {
+      fprintf(fp, "%s,%s,%s,%s,%s,%s,%d,", nmode ? "normal" : "forced", nmode ? bmpr->stby : "",
+              bmpr->osrs_t, bmpr->osrs_p, bmpr->osrs_h, bmpr->filter, sws->n);
+      double vals[] = { sws->interval, sws->conv, sws->conv_max, bmet->meas_typ, bmet->meas_max,
+                        sws->read_us, sws->read_max, sws->poll_us };
+      for(int i = 0; i < 8; i++) {
+         sw_num(fp, i < 5 ? "%.3f" : "%.1f", vals[i], 0);
+         fputc(',', fp);
+      }
+      for(int c = 0; c < 3; c++) {
+         sw_num(fp, "%.6g", sws->rms[c], 0);
+         fputc(',', fp);
+         sw_num(fp, "%.6g", sws->adev[c][0], 0);
+         fputs(c < 2 ? "," : "\n", fp);
+      }
+      return;
+   }
+
+   fprintf(fp, "%s\n  {\"mode\": \"%s\", \"standby_ms\": ", count > 0 ? "," : "", nmode ? "normal" : "forced");
+   if(nmode) fprintf(fp, "%s", bmpr->stby);
+   else fputs("null", fp);
+   fprintf(fp, ", \"osrs_t\": \"%s\", \"osrs_p\": \"%s\", \"osrs_h\": \"%s\", \"filter\": \"%s\", \"samples\": %d,\n   ",
+           bmpr->osrs_t, bmpr->osrs_p, bmpr->osrs_h, bmpr->filter, sws->n);
+   const char *keys[] = { "interval_ms", "conv_ms", "conv_max_ms", "model_typ_ms", "model_max_ms",
+                          "read_us", "read_max_us", "poll_us" };
+   double vals[] = { sws->interval, sws->conv, sws->conv_max, bmet->meas_typ, bmet->meas_max,
+                     sws->read_us, sws->read_max, sws->poll_us };
+   for(int i = 0; i < 8; i++) {
+      fprintf(fp, "\"%s\": ", keys[i]);
+      sw_num(fp, i < 5 ? "%.3f" : "%.1f", vals[i], 1);
+      fputs(", ", fp);
+   }
+   fputs("\n   \"tau_ms\": [", fp);
+   for(int k = 0; k < sws->ntau; k++) {
+      fputs(k > 0 ? ", " : "", fp);
+      sw_num(fp, "%.1f", sws->interval * (1 << k), 1);
+   }
+   fputs("]", fp);
+   for(int c = 0; c < 3; c++) {
+      fprintf(fp, ",\n   \"%s\": {\"rms\": ", sw_chans[c].name);
+      sw_num(fp, "%.6g", sws->rms[c], 1);
+      fputs(", \"adev\": [", fp);
+      for(int k = 0; k < sws->ntau; k++) {
+         fputs(k > 0 ? ", " : "", fp);
+         sw_num(fp, "%.6g", sws->adev[c][k], 1);
+      }
+      fputs("]}", fp);
+   }
+   fputs("}", fp);
+}
+
+/* ------------------------------------------------------------ *
+ * bme_sweep() is the "sweep" subcommand, argv[0] is the        *
+ * subcommand name. Returns 0 on success, -1 on errors.         *
+ * ------------------------------------------------------------ */
+int bme_sweep(int argc, char *argv[]) {
+   char i2c_bus[SENSOR_LISTLEN] = I2CBUS;
+   char senaddr[256] = BME280_ADDR;
+   char spec[5][256] = { "1,2,4,8,16", "1,2,4,8,16", "1,2,4,8,16", "off,2,4,8,16",
+                         "forced,0.5,10,20,62.5,125,250,500,1000" };
+   char *outfile = NULL;
+   int samples = SW_SAMPLES, json = 0;
+   int arg;
+
+   opterr = 0;
+   while ((arg = (int) getopt (argc, argv, "a:b:n:o:jT:P:H:F:S:hv")) != -1) {
+      char *opt = strchr("TPHFS", arg);
+      if(opt != NULL) {
+         if(strlen(optarg) >= sizeof(spec[0])) {
+            printf("Error: -%c list to long.\n", arg);
+            return(-1);
+         }
+         strcpy(spec[opt - "TPHFS"], optarg);
+         continue;
+      }
+      switch (arg) {
+         case 'a':
+         case 'b':
+            if(strlen(optarg) >= (arg == 'a' ? sizeof(senaddr) : sizeof(i2c_bus))) {
+               printf("Error: -%c argument to long.\n", arg);
+               return(-1);
+            }
+            strcpy(arg == 'a' ? senaddr : i2c_bus, optarg);
+            break;
+         case 'n':
+            samples = (int) strtol(optarg, NULL, 10);
+            if(samples < 3 || samples > SW_SAMPLES_MAX) {
+               printf("Error: invalid sample count %s, use 3..%d.\n", optarg, SW_SAMPLES_MAX);
+               return(-1);
+            }
+            break;
+         case 'o':
+            outfile = optarg; break;
+         case 'j':
+            json = 1; break;
+         case 'v':
+            sverbose = 1; break;
+         case 'h':
+            sweep_usage(); return(0);
+         default:
+            sweep_usage(); return(-1);
+      }
+   }
+   if(optind != argc) { sweep_usage(); return(-1); }
+
+   /* ---------------------------------------------------------- *
+    * The value lists, checked before the sweep starts. The      *
+    * other channels need the temperature, it has no skip.       *
+    * ---------------------------------------------------------- */
+   char *list[5][SW_LISTMAX];
+   int nlist[5];
+   for(int l = 0; l < 5; l++) {
+      if(l == 0) nlist[l] = sw_list(spec[l], osrs_args + 1, 5, NULL, list[l]);
+      else if(l < 3) nlist[l] = sw_list(spec[l], osrs_args, 6, NULL, list[l]);
+      else if(l == 3) nlist[l] = sw_list(spec[l], filter_args, 5, NULL, list[l]);
+      else nlist[l] = sw_list(spec[l], stby_args, 8, "forced", list[l]);
+      if(nlist[l] < 1) {
+         printf("Error: invalid -%c list, see getbme280 sweep -h.\n", "TPHFS"[l]);
+         return(-1);
+      }
+   }
+
+   get_i2cbus(i2c_bus, senaddr);
+   if(nsensors > 1) {
+      printf("Error: sweep supports one sensor, -b lists %d.\n", nsensors);
+      return(-1);
+   }
+   if(bmep->humidity == 0) {
+      list[2][0] = "skip";
+      nlist[2] = 1;
+   }
+
+   /* ---------------------------------------------------------- *
+    * Estimate the run time from the timing model                *
+    * ---------------------------------------------------------- */
+   long total = 0;
+   double estimate = 0;
+   for(int t = 0; t < nlist[0]; t++)
+   for(int p = 0; p < nlist[1]; p++)
+   for(int h = 0; h < nlist[2]; h++)
+   for(int f = 0; f < nlist[3]; f++)
+   for(int s = 0; s < nlist[4]; s++) {
+      struct bmeinf bmei;
+      struct bmetime bmet;
+      memset(&bmei, 0, sizeof(bmei));
+      for(int i = 0; i < 6; i++) {
+         if(strcmp(list[0][t], osrs_args[i]) == 0) bmei.osrs_t_mode = i;
+         if(strcmp(list[1][p], osrs_args[i]) == 0) bmei.osrs_p_mode = i;
+         if(strcmp(list[2][h], osrs_args[i]) == 0) bmei.osrs_h_mode = i;
+      }
+      for(int i = 0; i < 8; i++) if(strcmp(list[4][s], stby_args[i]) == 0) bmei.stby_time = i;
+      for(int i = 0; i < 5; i++) if(strcmp(list[3][f], filter_args[i]) == 0) bmei.filter_mode = i;
+      bmei.power_mode = strcmp(list[4][s], "forced") == 0 ? forced : normal;
+      bme_timing(&bmei, 1.0, &bmet);
+      int settle = bmei.filter_mode ? 2 << bmei.filter_mode : 0;
+      estimate += (samples + settle) * (bmet.normal ? 1000.0 / bmet.odr : bmet.meas_typ + 1);
+      total++;
+   }
+
+   FILE *fp = stdout;
+   if(outfile != NULL && (fp = fopen(outfile, "w")) == NULL) {
+      printf("Error: cannot create report file %s.\n", outfile);
+      return(-1);
+   }
+   if(fp != stdout) printf("Sweep: %ld combinations, %d samples each, about %.0f minutes\n",
+                           total, samples, estimate / 60000);
+   if(json == 1) {
+      fprintf(fp, "{\"sensor\": \"%s\", \"chip\": \"%s\", \"samples\": %d, \"results\": [",
+              sensors[0].spec, bmep->name, samples);
+   }
+   else fprintf(fp, "mode,standby_ms,osrs_t,osrs_p,osrs_h,filter,samples,interval_ms,conv_ms,conv_max_ms,"
+                    "model_typ_ms,model_max_ms,read_us,read_max_us,poll_us,temp_rms,temp_adev,"
+                    "pres_rms,pres_adev,humi_rms,humi_adev\n");
+
+   /* ---------------------------------------------------------- *
+    * The sweep, the sensor gets its settings back at the end    *
+    * ---------------------------------------------------------- */
+   struct bmeinf orig;
+   if(bme_snapshot(&orig) != 0) return(-1);
+   float *buf = malloc(3 * samples * sizeof(float));
+   if(buf == NULL) return(-1);
+
+   int res = 0, count = 0;
+   double start = sw_now();
+   for(int t = 0; t < nlist[0] && res == 0; t++)
+   for(int p = 0; p < nlist[1] && res == 0; p++)
+   for(int h = 0; h < nlist[2] && res == 0; h++)
+   for(int f = 0; f < nlist[3] && res == 0; f++)
+   for(int s = 0; s < nlist[4] && res == 0; s++) {
+      int normal_mode = strcmp(list[4][s], "forced") != 0;
+      struct bmepreset bmpr = { "sweep", list[0][t], list[1][p], list[2][h], list[3][f],
+                                normal_mode ? list[4][s] : "0.5", normal_mode ? normal : psleep, 0 };
+      struct bmeinf bmei;
+      struct bmetime bmet;
+      static struct swstat sws;
+
+      if((res = sw_run(&bmpr, samples, buf, &bmei, &bmet, &sws)) != 0) break;
+      sw_report(fp, json, count++, &bmpr, &bmet, &sws);
+      if(fp != stdout) {
+         printf("\r%d/%ld done, %.0fs", count, total, (sw_now() - start) / 1000);
+         fflush(stdout);
+      }
+   }
+   free(buf);
+   if(fp != stdout) printf("\n");
+   if(json == 1) fprintf(fp, "\n]}\n");
+   if(fp != stdout && fclose(fp) != 0) {
+      printf("Error: cannot write report file %s.\n", outfile);
+      res = -1;
+   }
+   if(set_config(&orig) != 0) return(-1);
+   return(res);
+}
@@ -0,0 +1,358 @@
+/* ------------------------------------------------------------ *
+ * file:        sweepcheck.c                                    *
+ * purpose:     Runs a short "sweep" without hardware, against  *
+ *              an emulated BME280 behind busops: the register  *
+ *              file with the calibration data, ctrl_meas and   *
+ *              config writes, the soft reset, the measuring    *
+ *              bit of the status register in forced and normal *
+ *              mode, the IIR filter, and adc values with noise *
+ *              that falls with the oversampling. It checks the *
+ *              columns of the CSV report and the keys of the   *
+ *              JSON report, and that the sensor gets its       *
+ *              settings back after the sweep.                  *
+ *                                                              *
+ * return:      0 if all checks pass, and -1 on failures.       *
+ *                                                              *
+ * example:	make check                                      *
+ *                                                              *
+ * author:      10/18/2026 agent                                *
+ * ------------------------------------------------------------ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <linux/i2c.h>
+#include "getbme280.h"
+
+/* ------------------------------------------------------------ *
+ * Global variables and defaults                                *
+ * ------------------------------------------------------------ */
+int verbose = 0;           // debug output of the driver, stays off
+extern struct bmebusops busops;
+
+#define EMU_FD           100   // file descriptor of the emulated bus
+#define EMU_ADDR        0x76   // address of the emulated sensor
+#define EMU_SAMPLES        8   // samples per combination of the sweep
+#define EMU_COMBOS         8   // combinations of the sweep below
+
+static int failed = 0;     // number of failed checks
+
+/* ------------------------------------------------------------ *
+ * The emulated sensor. The calibration data is from a BME280,  *
+ * the base adc values give about 25*C, 1000hPa and 45%.        *
+ * ------------------------------------------------------------ */
+static const uint8_t emu_cal88[26] = {
+   0xA5, 0x6E, 0x8C, 0x67, 0x32, 0x00, 0x6B, 0x92, 0x7E, 0xD6, 0xD0, 0x0B, 0xEE,
+   0x22, 0x3B, 0xFF, 0xF9, 0xFF, 0xAC, 0x26, 0x0A, 0xD8, 0xBD, 0x10, 0x00, 0x4B };
+static const uint8_t emu_cale1[7] = { 0x6F, 0x01, 0x00, 0x13, 0x24, 0x03, 0x1E };
+static const double emu_stby[8] = { 0.5, 62.5, 125, 250, 500, 1000, 10, 20 };
+static const int emu_osrs[8] = { 0, 1, 2, 4, 8, 16, 16, 16 };
+
+static struct {
+   uint8_t regs[256];      // register file
+   int addr;               // current I2C_SLAVE address
+   int ptr;                // register pointer
+   double start;           // ms, forced: trigger, normal: mode switch
+   double meas;            // ms, measurement time of the last start
+   long convs;             // conversions in the data registers
+   double adc[3];          // filtered adc values p, t, h
+   unsigned int seed;      // noise generator
+} emu;
+
+static double emu_now() {
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+/* ------------------------------------------------------------ *
+ * emu_reset() sets the power-on register values, as the 0xB6   *
+ * soft reset does                                              *
+ * ------------------------------------------------------------ */
+static void emu_reset() {
+   memset(emu.regs, 0, sizeof(emu.regs));
+   memcpy(emu.regs + 0x88, emu_cal88, sizeof(emu_cal88));
+   memcpy(emu.regs + 0xE1, emu_cale1, sizeof(emu_cale1));
+   emu.regs[0xD0] = 0x60;
+   emu.regs[0xF7] = emu.regs[0xFA] = 0x80;
+   emu.regs[0xFD] = 0x80;
+   emu.convs = 0;
+}
+
+/* ------------------------------------------------------------ *
+ * emu_convert() puts one conversion into the data registers:   *
+ * the noise falls with the square root of the oversampling,    *
+ * and the IIR filter runs on pressure and temperature.         *
+ * ------------------------------------------------------------ */
+static void emu_convert() {
+   static const double base[3] = { 0x5A000, 0x82000, 0x6C00 };
+   static const double noise[3] = { 48, 12, 8 };
+   int osrs[3] = { emu_osrs[(emu.regs[0xF4] >> 2) & 7], emu_osrs[(emu.regs[0xF4] >> 5) & 7],
+                   emu_osrs[emu.regs[0xF2] & 7] };
+   int coef = 1 << ((emu.regs[0xF5] >> 2) & 7);
+   if(coef > 16) coef = 16;
+
+   for(int c = 0; c < 3; c++) {
+      double n = 0;
+      for(int i = 0; i < 4; i++) n += rand_r(&emu.seed) / (double) RAND_MAX - 0.5;
+      double val = base[c] + n * noise[c] / sqrt(osrs[c] ? osrs[c] : 1);
+      if(emu.convs == 0 || c == 2 || coef == 1) emu.adc[c] = val;
+      else emu.adc[c] = (emu.adc[c] * (coef - 1) + val) / coef;
+   }
+   long p = osrs[0] ? (long) emu.adc[0] : 0x80000;
+   long t = osrs[1] ? (long) emu.adc[1] : 0x80000;
+   long h = osrs[2] ? (long) emu.adc[2] : 0x8000;
+   uint8_t *r = emu.regs;
+   r[0xF7] = p >> 12; r[0xF8] = p >> 4; r[0xF9] = (p & 0x0F) << 4;
+   r[0xFA] = t >> 12; r[0xFB] = t >> 4; r[0xFC] = (t & 0x0F) << 4;
+   r[0xFD] = h >> 8;  r[0xFE] = h;
+   emu.convs++;
+}
+
+/* ------------------------------------------------------------ *
+ * emu_update() brings the status bit and the data registers up *
+ * to the current time. Forced mode goes back to sleep after    *
+ * its conversion, normal mode converts once per period.        *
+ * ------------------------------------------------------------ */
+static void emu_update() {
+   double el = emu_now() - emu.start;
+   int mode = emu.regs[0xF4] & 3;
+   emu.regs[0xF3] = 0;
+   if(mode == 1 || mode == 2) {
+      if(el < emu.meas) emu.regs[0xF3] = 0x08;
+      else {
+         emu_convert();
+         emu.regs[0xF4] &= ~3;
+      }
+   }
+   else if(mode == 3) {
+      double period = emu.meas + emu_stby[emu.regs[0xF5] >> 5];
+      long done = el < emu.meas ? 0 : (long) ((el - emu.meas) / period) + 1;
+      if(fmod(el, period) < emu.meas) emu.regs[0xF3] = 0x08;
+      while(emu.convs < done) emu_convert();
+   }
+}
+
+/* ------------------------------------------------------------ *
+ * emu_start() starts the measurement of a ctrl_meas write, the *
+ * time is the typical one of the datasheet chapter 9.1         *
+ * ------------------------------------------------------------ */
+static void emu_start() {
+   int t = emu_osrs[(emu.regs[0xF4] >> 5) & 7];
+   int p = emu_osrs[(emu.regs[0xF4] >> 2) & 7];
+   int h = emu_osrs[emu.regs[0xF2] & 7];
+   emu.meas = 1.0 + 2.0 * t + (p ? 2.0 * p + 0.5 : 0) + (h ? 2.0 * h + 0.5 : 0);
+   emu.start = emu_now();
+   emu.convs = (emu.regs[0xF4] & 3) == 3 ? 0 : emu.convs;
+}
+
+/* ------------------------------------------------------------ *
+ * The emulated bus. A write sets the register pointer, or      *
+ * writes register and value pairs, a read auto-increments.     *
+ * ------------------------------------------------------------ */
+static int emu_open(const char *bus) {
+   return(EMU_FD);
+}
+
+static int emu_slave(int fd, int addr) {
+   emu.addr = addr;
+   return(0);
+}
+
+static int emu_write(int fd, void *buf, int len) {
+   uint8_t *b = buf;
+   if(fd != EMU_FD || emu.addr != EMU_ADDR || len < 1) return(-1);
+   emu_update();
+   emu.ptr = b[0];
+   for(int i = 0; i + 1 < len; i += 2) {
+      int reg = b[i];
+      if(reg == 0xE0) {
+         if(b[i+1] == 0xB6) emu_reset();
+         continue;
+      }
+      if(reg < 0xF2 || reg == 0xF3 || reg > 0xF5) continue;
+      emu.regs[reg] = b[i+1];
+      if(reg == 0xF4 && (b[i+1] & 3) != 0) emu_start();
+   }
+   return(len);
+}
+
+static int emu_read(int fd, void *buf, int len) {
+   if(fd != EMU_FD || emu.addr != EMU_ADDR) return(-1);
+   emu_update();
+   for(int i = 0; i < len; i++) ((uint8_t *) buf)[i] = emu.regs[(emu.ptr + i) & 0xFF];
+   return(len);
+}
+
+static int emu_rdwr(int fd, struct i2c_msg *msgs, int n) {
+   for(int i = 0; i < n; i++) {
+      emu.addr = msgs[i].addr;
+      int len = (msgs[i].flags & I2C_M_RD) ? emu_read(fd, msgs[i].buf, msgs[i].len)
+                                           : emu_write(fd, msgs[i].buf, msgs[i].len);
+      if(len != msgs[i].len) return(-1);
+   }
+   return(n);
+}
+
+/* ------------------------------------------------------------ *
+ * check() counts and prints a failed check                     *
+ * ------------------------------------------------------------ */
+static void check(int ok, const char *what) {
+   if(ok) return;
+   printf("FAIL: %s\n", what);
+   failed++;
+}
+
+/* ------------------------------------------------------------ *
+ * run_sweep() runs the sweep subcommand into the report file.  *
+ * 2 x osrs_t, pressure on and skipped, forced and normal mode. *
+ * ------------------------------------------------------------ */
+static int run_sweep(char *file, int json) {
+   char *argv[] = { "sweep", "-b", "/dev/i2c-emu", "-n", "8", "-T", "1,2", "-P", "1,skip",
+                    "-H", "1", "-F", "off", "-S", "forced,0.5", "-o", file, json ? "-j" : NULL, NULL };
+   int argc = json ? 18 : 17;
+   optind = 0;
+   int res = bme_sweep(argc, argv);
+   printf("\n");
+   return(res);
+}
+
+/* ------------------------------------------------------------ *
+ * csv_fields() splits one CSV line in place, returns the count *
+ * ------------------------------------------------------------ */
+static int csv_fields(char *line, char **field, int max) {
+   int n = 0;
+   line[strcspn(line, "\n")] = '\0';
+   field[n++] = line;
+   for(char *c = line; *c != '\0'; c++) {
+      if(*c != ',') continue;
+      *c = '\0';
+      if(n == max) return(-1);
+      field[n++] = c + 1;
+   }
+   return(n);
+}
+
+/* ------------------------------------------------------------ *
+ * check_csv() checks the header, the field count and the       *
+ * values of each combination line                              *
+ * ------------------------------------------------------------ */
+static void check_csv(char *file) {
+   static const char header[] = "mode,standby_ms,osrs_t,osrs_p,osrs_h,filter,samples,"
+      "interval_ms,conv_ms,conv_max_ms,model_typ_ms,model_max_ms,read_us,read_max_us,poll_us,"
+      "temp_rms,temp_adev,pres_rms,pres_adev,humi_rms,humi_adev\n";
+   char line[1024], what[1200];
+   char *f[32];
+
+   FILE *fp = fopen(file, "r");
+   check(fp != NULL, "open the CSV report");
+   if(fp == NULL) return;
+   check(fgets(line, sizeof(line), fp) != NULL && strcmp(line, header) == 0, "CSV header");
+
+   int rows = 0;
+   while(fgets(line, sizeof(line), fp) != NULL) {
+      rows++;
+      snprintf(what, sizeof(what), "CSV line %d: %s", rows, line);
+      int n = csv_fields(line, f, 32);
+      check(n == 21, what);
+      if(n != 21) continue;
+      int forced = strcmp(f[0], "forced") == 0;
+      check(forced || (strcmp(f[0], "normal") == 0 && strcmp(f[1], "0.5") == 0), what);
+      check(atoi(f[6]) == EMU_SAMPLES, what);
+      /* -- the measuring bit gives a conversion time in both modes -- */
+      check(*f[8] != '\0' && atof(f[8]) > 0, what);
+      if(forced) check(atof(f[8]) >= atof(f[10]), what);
+      check(atof(f[7]) > 0 && atof(f[11]) > atof(f[10]), what);
+      /* -- noise on the enabled channels, skipped ones are empty -- */
+      int skip = strcmp(f[3], "skip") == 0;
+      check(atof(f[15]) > 0 && *f[16] != '\0', what);
+      check(skip ? (*f[17] == '\0' && *f[18] == '\0') : atof(f[17]) > 0, what);
+      check(atof(f[19]) > 0 && *f[20] != '\0', what);
+   }
+   fclose(fp);
+   check(rows == EMU_COMBOS, "CSV has one line per combination");
+}
+
+/* ------------------------------------------------------------ *
+ * check_json() checks the top level keys, and the keys of each *
+ * combination object                                           *
+ * ------------------------------------------------------------ */
+static void check_json(char *file) {
+   static const char *keys[] = {
+      "\"mode\": ", "\"standby_ms\": ", "\"osrs_t\": ", "\"osrs_p\": ", "\"osrs_h\": ",
+      "\"filter\": ", "\"samples\": ", "\"interval_ms\": ", "\"conv_ms\": ", "\"conv_max_ms\": ",
+      "\"model_typ_ms\": ", "\"model_max_ms\": ", "\"read_us\": ", "\"read_max_us\": ",
+      "\"poll_us\": ", "\"tau_ms\": [", "\"temp\": {\"rms\": ", "\"pres\": {\"rms\": ",
+      "\"humi\": {\"rms\": ", "\"adev\": [" };
+   static char doc[65536];
+   char what[256];
+
+   FILE *fp = fopen(file, "r");
+   check(fp != NULL, "open the JSON report");
+   if(fp == NULL) return;
+   size_t len = fread(doc, 1, sizeof(doc) - 1, fp);
+   doc[len] = '\0';
+   fclose(fp);
+
+   static const char top[] = "{\"sensor\": \"/dev/i2c-emu\", \"chip\": \"BME280\", \"samples\": 8, \"results\": [";
+   check(strncmp(doc, top, strlen(top)) == 0, "JSON top level keys");
+   check(len > 4 && strcmp(doc + len - 4, "\n]}\n") == 0, "JSON ends the results");
+
+   int rows = 0;
+   for(char *obj = strstr(doc, "\n  {"); obj != NULL; obj = strstr(obj + 1, "\n  {")) {
+      char *end = strchr(obj, '}');
+      while(end != NULL && end[1] != '}') end = strchr(end + 1, '}');
+      if(end == NULL) break;
+      rows++;
+      for(size_t k = 0; k < sizeof(keys) / sizeof(keys[0]); k++) {
+         char *key = strstr(obj, keys[k]);
+         snprintf(what, sizeof(what), "JSON result %d has %s", rows, keys[k]);
+         check(key != NULL && key < end, what);
+      }
+      snprintf(what, sizeof(what), "JSON result %d conv_ms", rows);
+      check(strncmp(strstr(obj, "\"conv_ms\": "), "\"conv_ms\": null", 15) != 0, what);
+   }
+   check(rows == EMU_COMBOS, "JSON has one object per combination");
+}
+
+int main() {
+   busops.open = emu_open;
+   busops.slave = emu_slave;
+   busops.write = emu_write;
+   busops.read = emu_read;
+   busops.rdwr = emu_rdwr;
+
+   /* -- a sensor in normal mode, osrs 1, 1, 1, filter 4, 125ms -- */
+   emu.seed = 280;
+   emu_reset();
+   emu.regs[0xF2] = 0x01;
+   emu.regs[0xF5] = 0x48;
+   emu.regs[0xF4] = 0x27;
+   emu_start();
+
+   char file[] = "/tmp/sweepcheck.XXXXXX";
+   int fd = mkstemp(file);
+   check(fd >= 0, "create the report file");
+   if(fd < 0) exit(-1);
+   close(fd);
+
+   check(run_sweep(file, 0) == 0, "sweep with CSV report");
+   check_csv(file);
+   check(emu.regs[0xF2] == 0x01 && emu.regs[0xF4] == 0x27 && emu.regs[0xF5] == 0x48,
+         "sweep restores the sensor settings");
+
+   check(run_sweep(file, 1) == 0, "sweep with JSON report");
+   check_json(file);
+   unlink(file);
+
+   if(failed > 0) {
+      printf("Error: %d sweep checks failed.\n", failed);
+      exit(-1);
+   }
+   printf("All sweep checks passed.\n");
+   exit(0);
+}
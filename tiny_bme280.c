@@ -0,0 +1,203 @@
+/* ------------------------------------------------------------ *
+ * file:        tiny_bme280.c                                   *
+ * purpose:     Minimal footprint "-t" for small boards, where  *
+ *              cron starts a reading every few seconds. It has *
+ *              no stdio, getopt or float code: the datasheet   *
+ *              integer compensation (fixed_bme280.c) and a     *
+ *              small integer formatter write the same line as  *
+ *              getbme280 -t. "make tiny" links it statically.  *
+ *                                                              *
+ *              A sleeping sensor gets one forced conversion    *
+ *              with its current settings, a sensor in normal   *
+ *              mode is read right away. Skipped measurements   *
+ *              are left out of the line, like in getbme280.    *
+ *                                                              *
+ * return:      0 on success, and -1 on errors.                 *
+ *                                                              *
+ * example:	./tinybme280 -b /dev/i2c-1 -a 0x77              *
+ *                                                              *
+ * author:      10/18/2026 agent                                *
+ * ------------------------------------------------------------ */
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <linux/i2c-dev.h>
+#include <sys/ioctl.h>
+#include "getbme280.h"
+
+static int fd = -1;        // I2C bus file descriptor
+static char line[160];     // the output line
+static int len = 0;        // length of the output line
+
+/* ------------------------------------------------------------ *
+ * put_str() and put_num() build the output line. put_num()     *
+ * prints val with dec decimals, e.g. 2506, 2 as "25.06"        *
+ * ------------------------------------------------------------ */
+static void put_str(const char *str) {
+   while(*str != '\0' && len < (int) sizeof(line) - 1) line[len++] = *str++;
+}
+
+static void put_num(int64_t val, int dec) {
+   char buf[24];
+   int n = sizeof(buf);
+   uint64_t u = val < 0 ? -val : val;
+
+   buf[--n] = '\0';
+   for(int i = 0; i < dec; i++, u /= 10) buf[--n] = '0' + u % 10;
+   if(dec > 0) buf[--n] = '.';
+   do { buf[--n] = '0' + u % 10; u /= 10; } while(u > 0);
+   if(val < 0) buf[--n] = '-';
+   put_str(buf + n);
+}
+
+/* ------------------------------------------------------------ *
+ * fail() prints an error message with an optional register or  *
+ * address, and exits with -1. A NULL msg prints the usage.     *
+ * ------------------------------------------------------------ */
+static void fail(const char *msg, int reg) {
+   len = 0;
+   put_str(msg == NULL ? "Usage: tinybme280 [-b i2c-bus] [-a hex i2c-addr]" : "Error: ");
+   if(msg != NULL) put_str(msg);
+   if(reg >= 0) {
+      put_str(" 0x");
+      line[len++] = "0123456789ABCDEF"[reg >> 4];
+      line[len++] = "0123456789ABCDEF"[reg & 0x0F];
+   }
+   put_str("\n");
+   if(write(1, line, len) != len) exit(-1);
+   exit(-1);
+}
+
+/* ------------------------------------------------------------ *
+ * reg_read() reads len registers starting at reg               *
+ * ------------------------------------------------------------ */
+static void reg_read(uint8_t reg, uint8_t *buf, int len) {
+   if(write(fd, &reg, 1) != 1 || read(fd, buf, len) != len)
+      fail("I2C read failure for register", reg);
+}
+
+/* ------------------------------------------------------------ *
+ * get_cal() reads the calibration data, the humidity part only *
+ * if the chip has humidity                                     *
+ * ------------------------------------------------------------ */
+#define LE16(b, i) ((b)[i] | (b)[(i)+1] << 8)
+
+static void get_cal(struct bmecal *bmec, int humidity) {
+   uint8_t buf[24];
+
+   reg_read(BME280_CALIB_00_ADDR, buf, 24);
+   bmec->dig_T1 = LE16(buf, 0);
+   bmec->dig_T2 = LE16(buf, 2);
+   bmec->dig_T3 = LE16(buf, 4);
+   bmec->dig_P1 = LE16(buf, 6);
+   bmec->dig_P2 = LE16(buf, 8);
+   bmec->dig_P3 = LE16(buf, 10);
+   bmec->dig_P4 = LE16(buf, 12);
+   bmec->dig_P5 = LE16(buf, 14);
+   bmec->dig_P6 = LE16(buf, 16);
+   bmec->dig_P7 = LE16(buf, 18);
+   bmec->dig_P8 = LE16(buf, 20);
+   bmec->dig_P9 = LE16(buf, 22);
+   if(humidity == 0) return;
+
+   reg_read(BME280_CALIB_25_ADDR, buf, 1);
+   bmec->dig_H1 = buf[0];
+   reg_read(BME280_CALIB_26_ADDR, buf, 7);
+   bmec->dig_H2 = LE16(buf, 0);
+   bmec->dig_H3 = buf[2];
+   bmec->dig_H4 = (int8_t) buf[3] * 16 + (buf[4] & 0x0F);
+   bmec->dig_H5 = (int8_t) buf[5] * 16 + (buf[4] >> 4);
+   bmec->dig_H6 = (int8_t) buf[6];
+}
+
+/* ------------------------------------------------------------ *
+ * wait_data() triggers a forced conversion and waits for its   *
+ * end: the datasheet typical time, then the measuring bit      *
+ * ------------------------------------------------------------ */
+static void wait_data(uint8_t ctrl_meas, int osrs_h) {
+   static const int osf[8] = { 0, 1, 2, 4, 8, 16, 16, 16 };
+   uint8_t buf[2] = { BME280_CTRL_MEAS_ADDR, (ctrl_meas & 0xFC) | 0x01 };
+   if(write(fd, buf, 2) != 2) fail("I2C write failure for register", buf[0]);
+
+   int us = 1000 + 2000 * osf[ctrl_meas >> 5] + 2000 * osf[(ctrl_meas >> 2) & 0x07]
+          + 2000 * osf[osrs_h];
+   struct timespec ts = { 0, us * 1000L };
+   nanosleep(&ts, NULL);
+
+   uint8_t status = 0x08;
+   for(int i = 0; i < 100 && (status & 0x08); i++) {
+      reg_read(BME280_STATUS_ADDR, &status, 1);
+      if(status & 0x08) {
+         ts.tv_nsec = 500000;
+         nanosleep(&ts, NULL);
+      }
+   }
+}
+
+int main(int argc, char *argv[]) {
+   char *bus = "/dev/i2c-1";
+   int addr = (int) strtol(BME280_ADDR, NULL, 16);
+
+   /* ---------------------------------------------------------- *
+    * Arguments: [-b i2c-bus] [-a hex i2c-addr]                  *
+    * ---------------------------------------------------------- */
+   for(int i = 1; i < argc; i += 2) {
+      if(i + 1 < argc && strcmp(argv[i], "-b") == 0) bus = argv[i+1];
+      else if(i + 1 < argc && strcmp(argv[i], "-a") == 0) addr = (int) strtol(argv[i+1], NULL, 16);
+      else fail(NULL, -1);
+   }
+
+   if((fd = open(bus, O_RDWR)) < 0) fail("Failed to open I2C bus", -1);
+   if(ioctl(fd, I2C_SLAVE, addr) != 0) fail("can't find sensor at address", addr);
+
+   uint8_t id;
+   reg_read(BME280_CHIP_ID_ADDR, &id, 1);
+   int humidity = (id == 0x56 || id == 0x57 || id == 0x58) ? 0 : 1;
+
+   struct bmecal bmec;
+   memset(&bmec, 0, sizeof(bmec));
+   get_cal(&bmec, humidity);
+
+   /* ---------------------------------------------------------- *
+    * ctrl_hum and ctrl_meas, read 0xF2..0xF4                    *
+    * ---------------------------------------------------------- */
+   uint8_t ctrl[3];
+   reg_read(BME280_CTRL_HUM_ADDR, ctrl, 3);
+   int osrs_h = humidity ? ctrl[0] & 0x07 : 0;
+   if((ctrl[2] & 0x03) != 0x03) wait_data(ctrl[2], osrs_h);
+
+   uint8_t buf[8] = {0};
+   reg_read(BME280_PRES_DATA_MSB_ADDR, buf, humidity ? 8 : 6);
+   int32_t adc_p = (buf[0] << 12) | (buf[1] << 4) | (buf[2] >> 4);
+   int32_t adc_t = (buf[3] << 12) | (buf[4] << 4) | (buf[5] >> 4);
+   int32_t adc_h = (buf[6] << 8) | buf[7];
+
+   /* ---------------------------------------------------------- *
+    * The line of getbme280 -t, skipped measurements left out    *
+    * ---------------------------------------------------------- */
+   put_num(time(NULL), 0);
+   if((ctrl[2] >> 5) == 0) put_str(" Temp=skipped");
+   else {
+      int32_t t_fine;
+      put_str(" Temp=");
+      put_num(comp_t_int32(&bmec, adc_t, &t_fine), 2);
+      put_str("*C");
+      if(osrs_h != 0) {
+         put_str(" Humidity=");
+         put_num((comp_h_int32(&bmec, adc_h, t_fine) * 100 + 512) >> 10, 2);
+         put_str("%");
+      }
+      if(((ctrl[2] >> 2) & 0x07) != 0) {
+         put_str(" Pressure=");
+         put_num((comp_p_int64(&bmec, adc_p, t_fine) + 128) >> 8, 2);
+         put_str("hPa");
+      }
+   }
+   put_str("\n");
+   close(fd);
+   if(write(1, line, len) != len) exit(-1);
+   exit(0);
+}
@@ -0,0 +1,415 @@
+/* ------------------------------------------------------------ *
+ * file:        tune_bme280.c                                   *
+ * purpose:     Configuration optimizer, the "tune" subcommand. *
+ *              It evaluates all combinations of oversampling,  *
+ *              IIR filter, power mode and standby time against *
+ *              a target output data rate and a maximum RMS     *
+ *              noise per channel. Time and current come from   *
+ *              the timing model in preset_bme280.c, the noise  *
+ *              from the model below. Of the combinations that  *
+ *              meet the target, the one with the lowest supply *
+ *              current wins, then the lowest bus time.         *
+ *                                                              *
+ *              -M measures the noise of the best combinations  *
+ *              on the sensor, and takes the first that meets   *
+ *              the target. -w writes the result to the sensor. *
+ *                                                              *
+ * example:	./getbme280 tune -r 1 -n temp:0.01,pres:2 -M 50 *
+ *                                                              *
+ * author:      10/18/2026 agent                                *
+ * ------------------------------------------------------------ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+#include "getbme280.h"
+
+extern int verbose;
+extern struct bmesensor sensors[];
+extern int nsensors;
+
+/* ------------------------------------------------------------ *
+ * Noise model: RMS noise of one conversion at oversampling x1  *
+ * and filter off. Pressure and humidity are the datasheet      *
+ * values at x16 (table 1: 1.3Pa, 0.02%RH), scaled back by      *
+ * sqrt(16). The datasheet has no temperature noise, the 16 bit *
+ * step at x1 is used. Oversampling n averages the noise down   *
+ * by sqrt(n), the IIR filter with coefficient c by             *
+ * sqrt(2c - 1), and the result step adds step^2/12. The filter *
+ * only works on temperature and pressure.                      *
+ * ------------------------------------------------------------ */
+#define TUNE_NOISE_T    0.005   // *C at x1
+#define TUNE_NOISE_P    5.2     // Pa at x1
+#define TUNE_NOISE_H    0.08    // %RH at x1
+#define TUNE_STEP_T     0.005   // *C at x1, 16 bit, 20 bit with filter
+#define TUNE_STEP_P     2.62    // Pa at x1, 16 bit, 20 bit with filter
+#define TUNE_STEP_H     0.008   // %RH, always 16 bit
+#define TUNE_BUS_HZ     100000  // I2C clock, standard mode
+#define TUNE_TRIES      8       // combinations measured with -M
+#define TUNE_SAMPLES    10000   // max. -M samples
+
+/* -- Register codes of the combinations to sample counts and coefficients -- */
+static const int osrs_n[]       = { 0, 1, 2, 4, 8, 16 };
+static const int filter_c[]     = { 1, 2, 4, 8, 16 };
+
+static const struct { char *name; char *unit; } tune_chans[] = {
+   { "temp", "*C" },
+   { "pres", "Pa" },
+   { "humi", "%" },
+};
+
+struct tunecfg{      // one combination
+   int osrs[3];      // osrs codes temp, pres, humi, 0 = skip
+   int filter;       // filter code
+   int stby;         // standby code, -1 = forced mode
+   struct bmetime bmet; // timing model
+   float noise[3];   // model RMS noise, temp *C, pres Pa, humi %
+   float meas[3];    // measured RMS noise, -M
+   float bus;        // bus time per sample in ms
+};
+
+static int tverbose = 0;  // -v, the per-sample debug output stays off
+
+/* ------------------------------------------------------------ *
+ * tune_usage() prints the tune subcommand instructions.        *
+ * ------------------------------------------------------------ */
+static void tune_usage() {
+   printf("Usage: getbme280 tune -r rate -n chan:rms[,chan:rms] [-a i2c-addr] [-b i2c-bus] [-M samples] [-k count] [-w] [-v]\n\
+\n\
+   -r        target output data rate in Hz, example: -r 0.0167 for 1/min\n\
+   -n        max. RMS noise per channel temp (*C), pres (Pa) and humi (%%),\n\
+             channels without a target are skipped, example: -n temp:0.01,pres:2\n\
+   -a        sensor I2C address for -M and -w, default: 0x76\n\
+   -b        I2C bus for -M and -w, default: /dev/i2c-1\n\
+   -M        measure the noise on the sensor with this many samples, in the\n\
+             order of the model, until a combination meets the target\n\
+   -k        print the best count combinations of the model, default: 1\n\
+   -w        write the best combination to the sensor\n\
+   -v        enable debug output\n\
+\n\
+Usage examples:\n\
+./getbme280 tune -r 1 -n temp:0.01,pres:2\n\
+./getbme280 tune -r 25 -n pres:0.5 -k 5\n\
+./getbme280 tune -r 0.1 -n temp:0.005,humi:0.05,pres:1 -M 100 -w\n\n");
+}
+
+/* ------------------------------------------------------------ *
+ * tune_target() parses the -n noise targets into target[],     *
+ * NAN = no target. Returns 0 or -1 on errors.                  *
+ * ------------------------------------------------------------ */
+static int tune_target(char *spec, float *target) {
+   char list[256], *tok, *save;
+   if(strlen(spec) >= sizeof(list)) return(-1);
+   strcpy(list, spec);
+   for(tok = strtok_r(list, ",", &save); tok != NULL; tok = strtok_r(NULL, ",", &save)) {
+      char *val = strchr(tok, ':');
+      if(val == NULL) return(-1);
+      *val++ = '\0';
+      int c = -1;
+      for(int i = 0; i < 3; i++) if(strcmp(tok, tune_chans[i].name) == 0) c = i;
+      char *end;
+      if(c < 0 || (target[c] = strtof(val, &end)) <= 0 || *end != '\0') return(-1);
+   }
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * tune_model() returns the model RMS noise for a channel with  *
+ * oversampling n and IIR filter coefficient c                  *
+ * ------------------------------------------------------------ */
+static float tune_model(float noise, float step, int n, int c) {
+   float white = noise * noise / n / (2 * c - 1);
+   float q = c > 1 ? step / 16 : step / n;
+   return sqrtf(white + q * q / 12);
+}
+
+/* ------------------------------------------------------------ *
+ * tune_eval() fills in the models of one combination. Returns  *
+ * 1 if it meets the rate and noise target, else 0.             *
+ * ------------------------------------------------------------ */
+static int tune_eval(struct tunecfg *cfg, float rate, float *target) {
+   struct bmeinf bmei;
+   memset(&bmei, 0, sizeof(bmei));
+   bmei.osrs_t_mode = cfg->osrs[0];
+   bmei.osrs_p_mode = cfg->osrs[1];
+   bmei.osrs_h_mode = cfg->osrs[2];
+   bmei.filter_mode = cfg->filter;
+   bmei.power_mode = cfg->stby < 0 ? forced : normal;
+   bmei.stby_time = cfg->stby < 0 ? 0 : cfg->stby;
+   bme_timing(&bmei, rate, &cfg->bmet);
+   if(cfg->bmet.normal ? cfg->bmet.odr < rate : rate > cfg->bmet.odr_max) return(0);
+
+   int c = filter_c[cfg->filter];
+   cfg->noise[0] = tune_model(TUNE_NOISE_T, TUNE_STEP_T, osrs_n[cfg->osrs[0]], c);
+   cfg->noise[1] = cfg->osrs[1] ? tune_model(TUNE_NOISE_P, TUNE_STEP_P, osrs_n[cfg->osrs[1]], c) : NAN;
+   cfg->noise[2] = cfg->osrs[2] ? tune_model(TUNE_NOISE_H, TUNE_STEP_H, osrs_n[cfg->osrs[2]], 1) : NAN;
+   for(int i = 0; i < 3; i++) cfg->meas[i] = NAN;
+
+   /* ---------------------------------------------------------- *
+    * Bus time: the data burst read of the enabled span, address *
+    * and register byte, plus trigger write and one status poll  *
+    * in forced mode. 9 clocks per byte.                         *
+    * ---------------------------------------------------------- */
+   int bytes = 3 + (cfg->osrs[2] ? 8 : 6) - (cfg->osrs[1] ? 0 : 3);
+   if(cfg->stby < 0) bytes += 3 + 4;
+   cfg->bus = bytes * 9 * 1000.0 / TUNE_BUS_HZ;
+
+   for(int i = 0; i < 3; i++) {
+      if(!isnan(target[i]) && !(cfg->noise[i] <= target[i])) return(0);
+   }
+   return(1);
+}
+
+/* ------------------------------------------------------------ *
+ * tune_cmp() orders the combinations by supply current, bus    *
+ * time, and the smaller filter, it follows steps faster. The   *
+ * host reads at the target rate in both modes, so the bus time *
+ * per sample orders the bus time per second as well.           *
+ * ------------------------------------------------------------ */
+static int tune_cmp(const void *a, const void *b) {
+   const struct tunecfg *x = a, *y = b;
+   if(x->bmet.current != y->bmet.current) return(x->bmet.current < y->bmet.current ? -1 : 1);
+   if(x->bus != y->bus) return(x->bus < y->bus ? -1 : 1);
+   return(x->filter - y->filter);
+}
+
+/* ------------------------------------------------------------ *
+ * tune_preset() turns a combination into a preset, to write it *
+ * with set_preset()                                            *
+ * ------------------------------------------------------------ */
+static void tune_preset(struct tunecfg *cfg, struct bmepreset *bmpr) {
+   bmpr->name = "tune";
+   bmpr->osrs_t = osrs_args[cfg->osrs[0]];
+   bmpr->osrs_p = osrs_args[cfg->osrs[1]];
+   bmpr->osrs_h = osrs_args[cfg->osrs[2]];
+   bmpr->filter = filter_args[cfg->filter];
+   bmpr->stby = stby_args[cfg->stby < 0 ? 0 : cfg->stby];
+   bmpr->mode = cfg->stby < 0 ? forced : normal;
+   bmpr->rate = cfg->bmet.odr;
+}
+
+/* ------------------------------------------------------------ *
+ * tune_print() prints one combination in the -i layout         *
+ * ------------------------------------------------------------ */
+static void tune_print(int rank, struct tunecfg *cfg, float rate) {
+   printf("Config %d: %s mode, osrs_t x%s, osrs_p %s%s, osrs_h %s%s, filter %s",
+          rank, cfg->stby < 0 ? "forced" : "normal", osrs_args[cfg->osrs[0]],
+          cfg->osrs[1] ? "x" : "", osrs_args[cfg->osrs[1]],
+          cfg->osrs[2] ? "x" : "", osrs_args[cfg->osrs[2]], filter_args[cfg->filter]);
+   if(cfg->stby >= 0) printf(", standby %sms", stby_args[cfg->stby]);
+   printf("\n");
+
+   for(int m = 0; m < 2; m++) {
+      float *noise = m == 0 ? cfg->noise : cfg->meas;
+      if(m == 1 && isnan(noise[0])) break;
+      printf(m == 0 ? "       Model Noise =" : "    Measured Noise =");
+      for(int i = 0; i < 3; i++) {
+         if(!isnan(noise[i])) printf(" %s %.3g%s", tune_chans[i].name, noise[i], tune_chans[i].unit);
+      }
+      printf("\n");
+   }
+   print_timing(&cfg->bmet);
+   printf("          Bus Time = %.2fms per sample, %.3gms/s\n", cfg->bus, cfg->bus * rate);
+   printf("         Registers = ctrl_hum 0x%02X ctrl_meas 0x%02X config 0x%02X\n",
+          cfg->osrs[2], (cfg->osrs[0] << 5) | (cfg->osrs[1] << 2) | (cfg->stby < 0 ? psleep : normal),
+          ((cfg->stby < 0 ? 0 : cfg->stby) << 5) | (cfg->filter << 2));
+}
+
+/* ------------------------------------------------------------ *
+ * bme_rms() returns the RMS deviation of n values from their   *
+ * least squares line, so a slow drift during the measurement   *
+ * does not count as noise                                      *
+ * ------------------------------------------------------------ */
+float bme_rms(float *x, int n) {
+   double sx = 0, sy = 0, sxx = 0, sxy = 0, ss = 0;
+   if(n < 3) return(NAN);
+   for(int i = 0; i < n; i++) {
+      sx += i; sy += x[i]; sxx += (double) i * i; sxy += i * x[i];
+   }
+   double b = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+   double a = (sy - b * sx) / n;
+   for(int i = 0; i < n; i++) ss += (x[i] - a - b * i) * (x[i] - a - b * i);
+   return(sqrt(ss / (n - 2)));
+}
+
+/* ------------------------------------------------------------ *
+ * tune_measure() writes a combination in forced mode, and      *
+ * measures its noise with n back-to-back samples. The noise    *
+ * per sample does not depend on the standby time, so normal    *
+ * mode combinations are measured the same way. The samples     *
+ * until the IIR filter has settled are dropped. Returns 0 or   *
+ * -1 on errors.                                                *
+ * ------------------------------------------------------------ */
+static int tune_measure(struct tunecfg *cfg, int n, float *buf) {
+   struct bmepreset bmpr;
+   struct bmecal bmec;
+   struct bmedata bmed;
+
+   tune_preset(cfg, &bmpr);
+   bmpr.mode = forced;
+   if(set_preset(&bmpr) != 0) return(-1);
+   int settle = 2 * filter_c[cfg->filter];
+   for(int s = 0; s < settle + n; s++) {
+      if(bme_batch(sensors, 1, &bmec, &bmed) != 0) return(-1);
+      if(s < settle) continue;
+      buf[s - settle] = bmed.temp_c;
+      buf[n + s - settle] = bmed.pres_p;
+      buf[2 * n + s - settle] = bmed.humi_p;
+   }
+   cfg->meas[0] = bme_rms(buf, n);
+   cfg->meas[1] = cfg->osrs[1] ? bme_rms(buf + n, n) : NAN;
+   cfg->meas[2] = cfg->osrs[2] ? bme_rms(buf + 2 * n, n) : NAN;
+   if(tverbose == 1) printf("Debug: Measured: [%d samples] temp [%.4g] pres [%.4g] humi [%.4g]\n",
+                            n, cfg->meas[0], cfg->meas[1], cfg->meas[2]);
+   return(0);
+}
+
+/* ------------------------------------------------------------ *
+ * bme_tune() is the "tune" subcommand, argv[0] is the          *
+ * subcommand name. Returns 0 on success, -1 on errors.         *
+ * ------------------------------------------------------------ */
+int bme_tune(int argc, char *argv[]) {
+   char i2c_bus[SENSOR_LISTLEN] = I2CBUS;
+   char senaddr[256] = BME280_ADDR;
+   float target[3] = { NAN, NAN, NAN };
+   float rate = 0;
+   int samples = 0, show = 1, apply = 0, ntarget = 0;
+   int arg;
+
+   opterr = 0;
+   while ((arg = (int) getopt (argc, argv, "a:b:k:n:r:M:whv")) != -1) {
+      switch (arg) {
+         case 'a':
+         case 'b':
+            if(strlen(optarg) >= (arg == 'a' ? sizeof(senaddr) : sizeof(i2c_bus))) {
+               printf("Error: -%c argument to long.\n", arg);
+               return(-1);
+            }
+            strcpy(arg == 'a' ? senaddr : i2c_bus, optarg);
+            break;
+         case 'k':
+            show = (int) strtol(optarg, NULL, 10);
+            break;
+         case 'n':
+            if(tune_target(optarg, target) != 0) {
+               printf("Error: invalid noise target %s, use chan:rms[,chan:rms].\n", optarg);
+               return(-1);
+            }
+            break;
+         case 'r':
+            rate = strtof(optarg, NULL);
+            break;
+         case 'M':
+            samples = (int) strtol(optarg, NULL, 10);
+            if(samples < 3 || samples > TUNE_SAMPLES) {
+               printf("Error: invalid sample count %s, use 3..%d.\n", optarg, TUNE_SAMPLES);
+               return(-1);
+            }
+            break;
+         case 'w':
+            apply = 1; break;
+         case 'v':
+            tverbose = 1; break;
+         case 'h':
+            tune_usage(); return(0);
+         default:
+            tune_usage(); return(-1);
+      }
+   }
+   for(int i = 0; i < 3; i++) ntarget += !isnan(target[i]);
+   if(rate <= 0 || ntarget == 0 || show < 1 || optind != argc) { tune_usage(); return(-1); }
+
+   printf("Target: %.4gHz, RMS noise", rate);
+   for(int i = 0; i < 3; i++) {
+      if(!isnan(target[i])) printf(" %s %.3g%s", tune_chans[i].name, target[i], tune_chans[i].unit);
+   }
+   printf("\n");
+
+   /* ---------------------------------------------------------- *
+    * All combinations: channels without a target are skipped,   *
+    * but pressure and humidity need the temperature, at x1 if   *
+    * it has no target of its own                                *
+    * ---------------------------------------------------------- */
+   static struct tunecfg cfgs[5 * 6 * 6 * 5 * 9];
+   int ncfg = 0, total = 0;
+   int lo[3], hi[3];
+   for(int i = 0; i < 3; i++) {
+      lo[i] = isnan(target[i]) ? 0 : 1;
+      hi[i] = isnan(target[i]) ? 0 : 5;
+   }
+   if(lo[0] == 0) lo[0] = hi[0] = 1;
+
+   for(int t = lo[0]; t <= hi[0]; t++)
+   for(int p = lo[1]; p <= hi[1]; p++)
+   for(int h = lo[2]; h <= hi[2]; h++)
+   for(int f = 0; f < 5; f++)
+   for(int s = -1; s < 8; s++) {
+      struct tunecfg *cfg = &cfgs[ncfg];
+      cfg->osrs[0] = t; cfg->osrs[1] = p; cfg->osrs[2] = h;
+      cfg->filter = f;
+      cfg->stby = s;
+      total++;
+      if(tune_eval(cfg, rate, target) == 1) ncfg++;
+   }
+   printf("Combinations: %d, meet the target: %d\n", total, ncfg);
+   if(ncfg == 0) {
+      printf("Error: no combination meets the target, use a lower rate or a higher noise.\n");
+      return(-1);
+   }
+   qsort(cfgs, ncfg, sizeof(cfgs[0]), tune_cmp);
+   if(samples == 0) {
+      for(int i = 0; i < show && i < ncfg; i++) tune_print(i + 1, &cfgs[i], rate);
+   }
+
+   /* ---------------------------------------------------------- *
+    * -M and -w work on the sensor                               *
+    * ---------------------------------------------------------- */
+   if(samples == 0 && apply == 0) return(0);
+   get_i2cbus(i2c_bus, senaddr);
+   if(nsensors > 1) {
+      printf("Error: tune supports one sensor, -b lists %d.\n", nsensors);
+      return(-1);
+   }
+   if(bmep->humidity == 0 && !isnan(target[2])) {
+      printf("Error: %s sensor has no humidity measurement\n", bmep->name);
+      return(-1);
+   }
+
+   int best = 0;
+   if(samples > 0) {
+      struct bmeinf bmei;
+      if(bme_snapshot(&bmei) != 0) return(-1);
+      float *buf = malloc(3 * samples * sizeof(float));
+      if(buf == NULL) return(-1);
+
+      best = -1;
+      for(int i = 0; i < ncfg && i < TUNE_TRIES && best < 0; i++) {
+         if(tune_measure(&cfgs[i], samples, buf) != 0) { free(buf); return(-1); }
+         int ok = 1;
+         for(int c = 0; c < 3; c++) if(!isnan(target[c]) && !(cfgs[i].meas[c] <= target[c])) ok = 0;
+         tune_print(i + 1, &cfgs[i], rate);
+         if(ok == 1) best = i;
+      }
+      free(buf);
+
+      /* -- Without -w, the sensor gets its settings back -- */
+      if((apply == 0 || best < 0) && set_config(&bmei) != 0) return(-1);
+      if(best < 0) {
+         printf("Error: the %d best combinations miss the target on the sensor.\n",
+                ncfg < TUNE_TRIES ? ncfg : TUNE_TRIES);
+         return(-1);
+      }
+      printf("Best: Config %d\n", best + 1);
+   }
+
+   if(apply == 1) {
+      struct bmepreset bmpr;
+      tune_preset(&cfgs[best], &bmpr);
+      if(set_preset(&bmpr) != 0) return(-1);
+      printf("Config %d written to the sensor%s.\n", best + 1,
+             bmpr.mode == forced ? ", host triggered at the target rate" : "");
+   }
+   return(0);
+}